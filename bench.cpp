@@ -0,0 +1,205 @@
+/* Microbenchmarks of the C++ core: scalar and array evaluation, composition depth, derivatives and integrals, over the
+ * random functions that bench.py generates with test.py's generator and writes out in the binary format (see
+ * Serial.h). The timings are written as JSON, for bench.py to merge with its own and compare with the baseline.
+ *
+ * run.sh bench builds and runs it; by hand:
+ *   g++ -std=c++2a -O3 -fno-math-errno -fno-trapping-math -fopenmp -I./include -I./src bench.cpp -o bench_cpp -ldl
+ *   ./bench_cpp WORKLOADS OUTPUT [THREADS ...]
+ * where WORKLOADS holds each function as its size in 8 bytes followed by its data. */
+#include "ThreadPool.cpp"
+#include "Kernels.cpp"
+#include "Tape.cpp"
+#include "Profile.cpp"
+#include "Expr.cpp"
+#include "Taylor.cpp"
+#include "Jit.cpp"
+#include "CFunction.cpp"
+#include "Latex.cpp"
+#include "Contours.cpp"
+#include "CComparison.cpp"
+#include "Serial.cpp"
+#include "CAnalysis.cpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+
+using namespace libcalculus;
+
+namespace {
+    static size_t constexpr REPEATS = 5;
+    static double constexpr MIN_RUN = .02; // Seconds each repeat runs for at least.
+
+    /* Seconds per call of f: the median of REPEATS runs of as many calls as take MIN_RUN seconds. */
+    template<typename F>
+    double measure(F const &f) {
+        using Clock = std::chrono::steady_clock;
+        size_t calls = 1;
+        for (;;) {
+            Clock::time_point const start = Clock::now();
+            for (size_t i = 0; i < calls; ++i) f();
+            if (std::chrono::duration<double>(Clock::now() - start).count() >= MIN_RUN) break;
+            calls *= 2;
+        }
+        std::vector<double> runs;
+        for (size_t r = 0; r < REPEATS; ++r) {
+            Clock::time_point const start = Clock::now();
+            for (size_t i = 0; i < calls; ++i) f();
+            runs.push_back(std::chrono::duration<double>(Clock::now() - start).count() / calls);
+        }
+        std::sort(runs.begin(), runs.end());
+        return runs[REPEATS / 2];
+    }
+
+    struct Workloads {
+        std::vector<CFunction<COMPLEX, COMPLEX>> complex;
+        std::vector<CFunction<REAL, REAL>> real;
+        std::vector<CFunction<REAL, COMPLEX>> contours;
+    };
+
+    Workloads read(char const *path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error(std::string("cannot open ") + path);
+        std::string const data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        Workloads result;
+        for (size_t offset = 0; offset + sizeof(uint64_t) <= data.size();) {
+            uint64_t size;
+            std::memcpy(&size, data.data() + offset, sizeof(uint64_t));
+            offset += sizeof(uint64_t);
+            if (size > data.size() - offset) throw std::invalid_argument("truncated workloads");
+            char const *function = data.data() + offset;
+            switch (Serial::object(function, size)) {
+                case Serial::COMPLEX_FUNCTION: result.complex.push_back(Serial::load_function<COMPLEX, COMPLEX>(function, size)); break;
+                case Serial::REAL_FUNCTION: result.real.push_back(Serial::load_function<REAL, REAL>(function, size)); break;
+                case Serial::CONTOUR: result.contours.push_back(Serial::load_function<REAL, COMPLEX>(function, size)); break;
+                default: break;
+            }
+            offset += size;
+        }
+        return result;
+    }
+
+    template<typename T>
+    std::vector<T> points(size_t const n, REAL const bound) {
+        std::mt19937_64 random(n);
+        std::uniform_real_distribution<REAL> uniform(-bound, bound);
+        std::vector<T> result(n);
+        for (T &x : result) {
+            if constexpr (is_real<T>) x = uniform(random);
+            else x = T{uniform(random), uniform(random)};
+        }
+        return result;
+    }
+
+    /* Evaluation of every function of fs, at a few points one at a time, and over arrays of each size. */
+    template<typename Dom, typename Ran>
+    void evaluation(std::map<std::string, double> &results, std::string const &kind, std::vector<CFunction<Dom, Ran>> const &fs,
+                    std::vector<size_t> const &threads) {
+        if (fs.empty()) return;
+        std::vector<Dom> const scalars = points<Dom>(16, 20.);
+        results["cpp.eval.scalar." + kind] = measure([&] {
+            for (CFunction<Dom, Ran> const &f : fs) {
+                for (Dom const z : scalars) static_cast<void>(f(z));
+            }
+        });
+        for (size_t const n : {size_t{1000}, size_t{100000}}) {
+            std::vector<Dom> const z = points<Dom>(n, 20.);
+            std::vector<Ran> values(n);
+            for (size_t const t : threads) {
+                NUM_THREADS = t;
+                ThreadPool::instance().resize(t);
+                results["cpp.eval.array." + kind + ".n=" + std::to_string(n) + ".threads=" + std::to_string(t)] = measure([&] {
+                    for (CFunction<Dom, Ran> const &f : fs) f(z.data(), values.data(), n);
+                });
+            }
+        }
+        NUM_THREADS = 1;
+        ThreadPool::instance().resize(1);
+    }
+
+    /* Building compositions of the functions, depth of them deep, and evaluating them over an array. */
+    void composition(std::map<std::string, double> &results, std::vector<CFunction<COMPLEX, COMPLEX>> const &fs) {
+        if (fs.empty()) return;
+        std::vector<COMPLEX> const z = points<COMPLEX>(1000, 1.);
+        std::vector<COMPLEX> values(z.size());
+        for (size_t const depth : {size_t{4}, size_t{16}, size_t{64}}) {
+            auto const build = [&] {
+                CFunction<COMPLEX, COMPLEX> f = fs[0];
+                for (size_t i = 1; i < depth; ++i) f = fs[i % fs.size()].compose(f);
+                return f;
+            };
+            results["cpp.compose.build.depth=" + std::to_string(depth)] = measure([&] { static_cast<void>(build().deduplicated()); });
+            CFunction<COMPLEX, COMPLEX> const f = build();
+            results["cpp.compose.eval.depth=" + std::to_string(depth)] = measure([&] { f(z.data(), values.data(), z.size()); });
+        }
+    }
+
+    /* Derivatives of each order of every function, built and evaluated at a few points. */
+    void derivatives(std::map<std::string, double> &results, std::vector<CFunction<COMPLEX, COMPLEX>> const &fs) {
+        if (fs.empty()) return;
+        std::vector<COMPLEX> const z = points<COMPLEX>(16, 2.);
+        for (bool const symbolic : {false, true}) {
+            for (size_t const order : {size_t{1}, size_t{2}, size_t{4}}) {
+                results[std::string("cpp.derivative.") + (symbolic ? "symbolic." : "") + "order=" + std::to_string(order)] = measure([&] {
+                    for (CFunction<COMPLEX, COMPLEX> const &f : fs) {
+                        CFunction<COMPLEX, COMPLEX> const df = Derivative(f, order, 1e-3, 1., symbolic);
+                        for (COMPLEX const x : z) static_cast<void>(df(x));
+                    }
+                });
+            }
+        }
+    }
+
+    /* Integrals of every function along a segment, and of the real ones over an interval. */
+    void integrals(std::map<std::string, double> &results, Workloads const &workloads) {
+        CFunction<REAL, COMPLEX> const line = CFunction<REAL, COMPLEX>::Line(-1. - 1i, 1. + 1i);
+        CFunction<REAL, REAL> const identity;
+        if (!workloads.complex.empty()) {
+            results["cpp.integrate.complex"] = measure([&] {
+                for (CFunction<COMPLEX, COMPLEX> const &f : workloads.complex) static_cast<void>(Integrate(f, line, 0., 1., 1e-6));
+            });
+        }
+        if (!workloads.real.empty()) {
+            results["cpp.integrate.real"] = measure([&] {
+                for (CFunction<REAL, REAL> const &f : workloads.real) static_cast<void>(Integrate(f, identity, -1., 1., 1e-6));
+            });
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: %s WORKLOADS OUTPUT [THREADS ...]\n", argv[0]);
+        return 2;
+    }
+    std::vector<size_t> threads;
+    for (int i = 3; i < argc; ++i) threads.push_back(std::stoul(argv[i]));
+    if (threads.empty()) threads.push_back(1);
+
+    try {
+        Workloads const workloads = read(argv[1]);
+        std::map<std::string, double> results;
+        evaluation(results, "complex", workloads.complex, threads);
+        evaluation(results, "real", workloads.real, threads);
+        evaluation(results, "contour", workloads.contours, threads);
+        composition(results, workloads.complex);
+        derivatives(results, workloads.complex);
+        integrals(results, workloads);
+
+        std::FILE *out = std::fopen(argv[2], "w");
+        if (!out) throw std::runtime_error(std::string("cannot open ") + argv[2]);
+        std::fputs("{", out);
+        for (auto it = results.begin(); it != results.end(); ++it) {
+            std::fprintf(out, "%s\n  \"%s\": %.9g", it == results.begin() ? "" : ",", it->first.c_str(), it->second);
+        }
+        std::fputs("\n}\n", out);
+        std::fclose(out);
+    } catch (std::exception const &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
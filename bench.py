@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+import libcalculus
+from libcalculus import Contour
+from test import ComplexFunctionTester, RealFunctionTester, ContourTester
+
+import numpy as np
+import argparse
+import json
+import multiprocessing as mp
+import os
+import platform
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+class Benchmark:
+    """Times the entry points of the module over random functions from test.py's generator, seeded so that every run
+    gets the same ones; with a C++ harness (bench.cpp), writes the functions out for it and merges its timings."""
+    REPEATS = 5
+    MIN_RUN = .02 # Seconds each repeat runs for at least.
+
+    def __init__(self, n_funcs, n_ops, sizes, threads, seed):
+        self.sizes = sizes
+        self.threads = threads
+        np.random.seed(seed)
+        self.workloads = {"complex": self._generate(ComplexFunctionTester(), n_funcs, n_ops),
+                          "real": self._generate(RealFunctionTester(), n_funcs, n_ops),
+                          "contour": self._generate(ContourTester(), n_funcs, n_ops)}
+        self.results = {}
+
+    def _generate(self, tester, n_funcs, n_ops):
+        return [tester._gen_function(np.random.randint(0, n_ops + 1))[0] for _ in range(n_funcs)]
+
+    def _measure(self, f):
+        """Seconds per call of f: the median of REPEATS runs of as many calls as take MIN_RUN seconds."""
+        calls = 1
+        while True:
+            start = time.perf_counter()
+            for _ in range(calls):
+                f()
+            if time.perf_counter() - start >= self.MIN_RUN:
+                break
+            calls *= 2
+        runs = []
+        for _ in range(self.REPEATS):
+            start = time.perf_counter()
+            for _ in range(calls):
+                f()
+            runs.append((time.perf_counter() - start) / calls)
+        return sorted(runs)[self.REPEATS // 2]
+
+    def _time(self, name, f):
+        self.results[name] = self._measure(f)
+        print(f"{name:<48} {self.results[name] * 1e6:12.2f} us", file=sys.stderr)
+
+    def evaluation(self):
+        rng = np.random.default_rng(0)
+        for kind, fs in self.workloads.items():
+            scalars = [complex(x) if kind == "complex" else float(x.real) for x in rng.uniform(-20, 20, 16) + 1j * rng.uniform(-20, 20, 16)]
+            self._time(f"py.eval.scalar.{kind}", lambda: [f(x) for f in fs for x in scalars])
+            for n in self.sizes:
+                points = rng.uniform(-20, 20, n) + (1j * rng.uniform(-20, 20, n) if kind == "complex" else 0)
+                for dtype in ((np.complex128, np.complex64) if kind == "complex" else (np.float64, np.float32)):
+                    array = points.astype(dtype)
+                    for t in self.threads:
+                        libcalculus.threads(t)
+                        self._time(f"py.eval.array.{kind}.{np.dtype(dtype).name}.n={n}.threads={t}", lambda: [f(array) for f in fs])
+        libcalculus.threads(1)
+
+    def composition(self):
+        fs = self.workloads["complex"]
+        z = np.random.default_rng(1).uniform(-1, 1, 1000) + 0j
+        for depth in (4, 16, 64):
+            def build():
+                f = fs[0]
+                for i in range(1, depth):
+                    f = fs[i % len(fs)] @ f
+                return f
+            self._time(f"py.compose.build.depth={depth}", lambda: build().deduplicated())
+            f = build()
+            self._time(f"py.compose.eval.depth={depth}", lambda: f(z))
+
+    def derivatives(self):
+        fs = self.workloads["complex"]
+        z = np.random.default_rng(2).uniform(-2, 2, 16) + 0j
+        for symbolic in (False, True):
+            for order in (1, 2, 4):
+                self._time(f"py.derivative.{'symbolic.' if symbolic else ''}order={order}",
+                           lambda: [libcalculus.derivative(f, order, symbolic=symbolic)(z) for f in fs])
+
+    def integrals(self):
+        line = Contour.Line(-1 - 1j, 1 + 1j)
+        self._time("py.integrate.complex", lambda: [libcalculus.integrate(f, line, 0., 1., tol=1e-6) for f in self.workloads["complex"]])
+        self._time("py.integrate.real", lambda: [libcalculus.integrate(f, (-1., 1.), tol=1e-6) for f in self.workloads["real"]])
+        self._time("py.integrate_many.complex", lambda: libcalculus.integrate_many(self.workloads["complex"], line, 0., 1., tol=1e-6))
+
+    def cpp(self, binary):
+        """Runs the C++ harness over the same functions, and merges its timings."""
+        with tempfile.TemporaryDirectory() as directory:
+            workloads, output = os.path.join(directory, "workloads.bin"), os.path.join(directory, "results.json")
+            with open(workloads, "wb") as wfd:
+                for fs in self.workloads.values():
+                    for f in fs:
+                        data = f.to_bytes()
+                        wfd.write(struct.pack("=Q", len(data)) + data)
+            subprocess.run([binary, workloads, output] + [str(t) for t in self.threads], check=True)
+            with open(output) as rfd:
+                for name, seconds in json.load(rfd).items():
+                    self.results[name] = seconds
+                    print(f"{name:<48} {seconds * 1e6:12.2f} us", file=sys.stderr)
+
+    def run(self, cpp=None):
+        np.seterr(all="ignore")
+        self.evaluation()
+        self.composition()
+        self.derivatives()
+        self.integrals()
+        if cpp is not None:
+            self.cpp(cpp)
+        return {"machine": {"platform": platform.platform(), "processor": platform.processor(), "cpus": mp.cpu_count(),
+                            "python": platform.python_version(), "numpy": np.__version__},
+                "results": self.results}
+
+def compare(results, baseline, threshold):
+    """Prints how each timing changed from the baseline, and returns the names of those slower by more than threshold."""
+    regressions = []
+    for name in sorted(results.keys() & baseline.keys()):
+        ratio = results[name] / baseline[name]
+        mark = ""
+        if ratio > 1 + threshold:
+            regressions.append(name)
+            mark = "\033[1;41m SLOWER \033[0m"
+        elif ratio < 1 / (1 + threshold):
+            mark = "\033[1;92m faster \033[0m"
+        print(f"{name:<48} {baseline[name] * 1e6:12.2f} us -> {results[name] * 1e6:12.2f} us  x{ratio:5.2f} {mark}")
+    if baseline.keys() - results.keys():
+        print(f"{len(baseline.keys() - results.keys())} benchmarks of the baseline were not run.")
+    return regressions
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Benchmark suite for libcalculus.")
+    parser.add_argument("--quick", action="store_true", help="fewer functions and smaller arrays")
+    parser.add_argument("--cpp", metavar="BINARY", help="also run the C++ harness built from bench.cpp")
+    parser.add_argument("--output", default="bench_results.json", help="where to write the results")
+    parser.add_argument("--baseline", default="bench_baseline.json", help="results to compare with, if the file exists")
+    parser.add_argument("--save-baseline", action="store_true", help="write the results to the baseline as well")
+    parser.add_argument("--threshold", type=float, default=.25, help="relative slowdown reported as a regression")
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    threads = sorted({1, mp.cpu_count()})
+    if args.quick:
+        benchmark = Benchmark(n_funcs=8, n_ops=3, sizes=[1000], threads=threads, seed=args.seed)
+    else:
+        benchmark = Benchmark(n_funcs=32, n_ops=5, sizes=[10, 1000, 100000], threads=threads, seed=args.seed)
+    report = benchmark.run(args.cpp)
+    with open(args.output, "w") as wfd:
+        json.dump(report, wfd, indent=2, sort_keys=True)
+    print(f"Written results to {args.output}.", file=sys.stderr)
+
+    status = 0
+    if os.path.isfile(args.baseline):
+        with open(args.baseline) as rfd:
+            baseline = json.load(rfd)
+        if baseline["machine"] != report["machine"]:
+            print("\033[1mThe baseline was recorded on another machine; timings may not be comparable.\033[0m")
+        regressions = compare(report["results"], baseline["results"], args.threshold)
+        if regressions:
+            print(f"\033[1;41m{len(regressions)} benchmarks regressed by more than {args.threshold:.0%}.\033[0m")
+            status = 1
+    if args.save_baseline:
+        with open(args.baseline, "w") as wfd:
+            json.dump(report, wfd, indent=2, sort_keys=True)
+        print(f"Written baseline to {args.baseline}.", file=sys.stderr)
+    sys.exit(status)
@@ -1,11 +1,65 @@
 #pragma once
 #include "CFunction.h"
-#include <boost/math/quadrature/gauss_kronrod.hpp>
+#include "Profile.h"
 
 namespace libcalculus {
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> Derivative(CFunction<Dom, Ran> const &f, size_t const order, REAL const tol, REAL const radius);
+    CFunction<Dom, Ran> Derivative(CFunction<Dom, Ran> const &f, size_t const order, REAL const tol, REAL const radius, bool const symbolic);
 
+    /* The result of a numeric integration: the integral, an estimate of its absolute error and the number of times the
+     * integrand was evaluated. */
+    template<typename Ran>
+    struct Integral {
+        Ran value = 0.;
+        REAL error = 0.;
+        size_t evaluations = 0;
+    };
+
+    /* With extended set, the integrand is evaluated and summed in long double, for integrals that lose too much to
+     * cancellation in double precision. */
+    template<typename Dom, typename Ran, typename ContDom>
+    Integral<Ran> Integrate(CFunction<Dom, Ran> const &f, CFunction<ContDom, Dom> const &contour, ContDom const start, ContDom const end,
+                            REAL const tol, bool const extended = false);
+
+    /* Integrals of fs[i] along contours[i] from starts[i] to ends[i], for i < n, scheduled across NUM_THREADS threads. */
     template<typename Dom, typename Ran, typename ContDom>
-    Ran Integrate(CFunction<Dom, Ran> const &f, CFunction<ContDom, Dom> const &contour, ContDom const start, ContDom const end, REAL const tol);
+    void IntegrateMany(CFunction<Dom, Ran> const *fs, CFunction<ContDom, Dom> const *contours, ContDom const *starts,
+                       ContDom const *ends, size_t const n, REAL const tol, bool const extended, Integral<Ran> *results);
+
+    /* The length of a contour between two parameters: exact for contours of line segments and arcs, and otherwise the
+     * integral of |z'(t)|. */
+    Integral<REAL> Length(CFunction<REAL, COMPLEX> const &contour, REAL const start, REAL const end, REAL const tol);
+
+    /* Taylor coefficients a_0, ..., a_(n-1) of f around each center, or Laurent coefficients a_(-n/2), ..., a_(n/2-1),
+     * from the FFT of n samples on the circle of the given radius; coeffs holds n per center, and errors one estimate
+     * per center of the error of r^k a_k. */
+    void Coefficients(CFunction<COMPLEX, COMPLEX> const &f, COMPLEX const *centers, size_t const n_centers, REAL const radius,
+                      size_t const n, bool const laurent, COMPLEX *coeffs, REAL *errors);
+
+    /* An instruction of the tape of a function, as profiled: its index, operation and operands, the LaTeX of the
+     * subexpression it computes with the variable named varname, and what Profile recorded for it. */
+    struct ProfiledNode {
+        uint32_t index;
+        char const *op;
+        std::string latex;
+        std::vector<uint32_t> operands;
+        Profile::Node counts;
+    };
+
+    template<typename Dom, typename Ran>
+    std::vector<ProfiledNode> Profiled(CFunction<Dom, Ran> const &f, std::string const &varname);
+
+    /* A zero or pole of a function, and its multiplicity. */
+    struct Root {
+        COMPLEX location;
+        size_t multiplicity;
+    };
+
+    /* The zeros of f inside a closed contour, or its poles if poles is set, from the moments of f'/f around rectangles
+     * (Delves-Lyness): the bounding box of the contour is subdivided until each rectangle holds a few roots, whose
+     * power sums give a polynomial with the same roots; Newton's method optionally polishes them. A zero and a pole in
+     * the same rectangle cancel out, so f should be holomorphic when looking for zeros, and have no zeros near its poles
+     * when looking for poles. */
+    std::vector<Root> Roots(CFunction<COMPLEX, COMPLEX> const &f, CFunction<REAL, COMPLEX> const &contour, REAL const start,
+                            REAL const end, REAL const tol, bool const poles, bool const polish);
 }
@@ -1,18 +1,61 @@
 #pragma once
+#include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <type_traits>
 #include "Definitions.h"
+#include "Latex.h"
+#include "Expr.h"
 
 namespace libcalculus {
+    /* Results of a comparison over n points, packed into a mask: bit j % 64 of word j / 64 holds the one of point j, and
+     * the bits past n are unspecified. */
+    static inline size_t mask_words(size_t const n) noexcept { return (n + 63) / 64; }
+    static inline bool mask_bit(uint64_t const *mask, size_t const j) noexcept { return mask[j / 64] >> (j % 64) & 1; }
+    template<typename F>
+    static inline void pack_mask(uint64_t *RESTRICT mask, size_t const n, F const &bit) {
+        for (size_t w = 0; w < mask_words(n); ++w) {
+            size_t const m = std::min<size_t>(64, n - 64 * w);
+            uint64_t word = 0;
+            for (size_t b = 0; b < m; ++b) word |= uint64_t{bit(64 * w + b)} << b;
+            mask[w] = word;
+        }
+    }
+
+    /* What a comparison tests, as data kept alongside the code evaluating it, so that the comparison can be written out
+     * and built again (see Serial.h): a predicate between the values of two functions, or the negation or combination
+     * of other conditions. Comparisons without a condition always hold. */
+    struct Condition {
+        enum class Kind : unsigned char { GT, LT, EQ, GE, LE, NE, NOT, OR, AND };
+        Kind kind;
+        bool ran_real = false; // Whether the functions compared have real values.
+        Expr::ptr lhs = nullptr, rhs = nullptr; // The functions compared, for predicates.
+        std::shared_ptr<Condition const> a = nullptr, b = nullptr; // The conditions negated or combined.
+    };
+
     template<typename Dom>
     class CComparison {
     public:
-        std::string latex;
+        using array_function = std::function<void(Dom const *RESTRICT, uint64_t *RESTRICT, size_t)>;
+        Latex::Text::ptr latex;
         std::function<bool(Dom)> eval = [](Dom z) { return true; };
+        array_function eval_array; // Evaluation over arrays into a mask, if the comparison has one; see operator().
+        std::shared_ptr<Condition const> condition;
 
         CComparison() {}
-        CComparison(CComparison const &cc) : latex{cc.latex}, eval{cc.eval} {}
-        CComparison(std::function<bool(Dom)> const &eval, std::string const &latex) : latex{latex}, eval{eval} {}
+        CComparison(CComparison const &cc) : latex{cc.latex}, eval{cc.eval}, eval_array{cc.eval_array}, condition{cc.condition} {}
+        CComparison(std::function<bool(Dom)> const &eval, Latex::Text::ptr const &latex) : latex{latex}, eval{eval} {}
+        CComparison(std::function<bool(Dom)> const &eval, array_function const &eval_array, Latex::Text::ptr const &latex,
+                    std::shared_ptr<Condition const> const &condition = nullptr)
+            : latex{latex}, eval{eval}, eval_array{eval_array}, condition{condition} {}
+
+        /* Evaluation over n points into a mask: comparisons of functions evaluate them through the array path, and
+         * combine their masks word by word; others fall back to eval point by point. */
+        void operator()(Dom const *RESTRICT z, uint64_t *RESTRICT mask, size_t const n) const;
+
+        /* The comparison as the condition of a branch of a tape, between the tapes of two functions of Dom. */
+        Tape::Branch branch(Tape::ptr const &then_, Tape::ptr const &else_) const;
 
         // Unary operators
         CComparison operator~() const;
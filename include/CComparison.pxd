@@ -1,4 +1,5 @@
 from Definitions cimport *
+from libc.stdint cimport uint64_t
 
 cdef extern from "CComparison.cpp" nogil:
   pass
@@ -8,6 +9,7 @@ cdef extern from "CComparison.h" namespace "libcalculus" nogil:
     CComparison() except +
     CComparison(CComparison[Dom] cc) except +
     cbool eval(Dom z) except +
+    void _call_array "operator()"(Dom *z, uint64_t *mask, size_t n) except +
     # Unary operators
     CComparison[Dom] operator~() except +
 
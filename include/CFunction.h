@@ -5,25 +5,48 @@
 #include <functional>
 #include <string>
 #include <sstream>
-#include <regex>
 #include "Definitions.h"
 #include "Latex.h"
 #include "CComparison.h"
+#include "Tape.h"
+#include "Expr.h"
+#include "Jit.h"
 
 namespace libcalculus {
-    #define LATEX_VAR "%var"
+    template<typename Dom> class Differentiator;
+
+    /* What CFunction::grid() writes for every point: the value, or its modulus or argument. */
+    enum Grid : uint8_t { GRID_VALUE, GRID_ABS, GRID_ARG };
 
     template <typename Dom, typename Ran>
     class CFunction {
         using function = std::function<Ran(Dom)>;
     private:
-        function _f = [](Dom z) noexcept { return z; };
-        std::string _latex = LATEX_VAR;
+        Expr::ptr _expr = Expr::Variable(is_real<Dom>, is_real<Ran>);
+        Latex::Text::ptr _latex = Latex::variable();
         OP_TYPE _last_op = OP_TYPE::NOP;
+        std::shared_ptr<CFunction const> _operand; // The operand of the last operation, if it was unary or with a constant.
         template<typename, typename> friend class CFunction;
-        template<typename Dom_, typename Ran_> friend CFunction<Dom_, Ran_> Derivative(CFunction<Dom_, Ran_> const &f, size_t const order, REAL const tol, REAL const radius);
-        template<typename Dom_, typename Ran_, typename ContDom_>
-        friend Ran_ Integrate(CFunction<Dom_, Ran_> const &f, CFunction<ContDom_, Dom_> const &contour, ContDom_ const start, ContDom_ const End, double const tol);
+        template<typename> friend class Differentiator;
+        friend class Serial::Writer;
+        friend class Serial::Reader;
+        template<typename Dom_, typename Ran_> friend CFunction<Dom_, Ran_> Derivative(CFunction<Dom_, Ran_> const &f, size_t const order, REAL const tol, REAL const radius, bool const symbolic);
+
+        static inline Expr::ptr _wrap(function const &f) {
+            return Expr::Leaf(Tape::Wrap([f](COMPLEX const z) { return COMPLEX{f(from_complex<Dom>(z))}; }, is_real<Dom>, is_real<Ran>));
+        }
+        inline Tape::ptr const &_tape() const { return this->_expr->tape(); }
+
+        /* Simplification helpers */
+        CFunction(Expr::ptr const &expr, Latex::Text::ptr const &latex, OP_TYPE const last_op) : _expr{expr}, _latex{latex}, _last_op{last_op} {}
+        CFunction(Expr::ptr const &expr, Latex::Text::ptr const &latex, OP_TYPE const last_op, CFunction const &operand)
+            : _expr{expr}, _latex{latex}, _last_op{last_op},
+              _operand{new CFunction const(operand._expr, operand._latex, operand._last_op)} {}
+        inline bool _is_constant() const noexcept { return this->_expr->last() == OPCODE::CONST; }
+        inline bool _last_is(OPCODE const op) const noexcept { return this->_operand && this->_expr->last() == op; }
+        inline Ran _constant() const noexcept { return from_complex<Ran>(this->_expr->last_const()); } // Of CONST or the last constant operator.
+        static inline CFunction _shift(CFunction const &f, Ran const c) { return std::real(c) < 0 && std::imag(c) == 0 ? f - (-c) : f + c; }
+        template<typename Predicate> CComparison<Dom> _compare(CFunction const &rhs, char const *symbol, Condition::Kind const kind, Predicate const &predicate) const;
 
         /* Preset instances */
         static CFunction const _Identity;
@@ -63,12 +86,40 @@ namespace libcalculus {
 
     public:
         CFunction() {}
-        CFunction(CFunction const &cf) : _f{cf._f}, _latex{cf._latex}, _last_op{cf._last_op} {}
-        CFunction(function const &f) : _f{f} {}
-        CFunction(function const &f, std::string const &latex, OP_TYPE const last_op) : _f{f}, _latex{latex}, _last_op{last_op} {}
-        inline Ran operator()(Dom z) const { return this->_f(z); };
-        void operator()(Dom const *RESTRICT z, Ran *RESTRICT result, size_t const n) const;
+        CFunction(CFunction const &cf) : _expr{cf._expr}, _latex{cf._latex}, _last_op{cf._last_op}, _operand{cf._operand} {}
+        CFunction(function const &f) : _expr{CFunction::_wrap(f)} {}
+        CFunction(function const &f, std::string const &latex, OP_TYPE const last_op) : _expr{CFunction::_wrap(f)}, _latex{Latex::Text::Literal(latex)}, _last_op{last_op} {}
+        CFunction(function const &f, Latex::Text::ptr const &latex, OP_TYPE const last_op) : _expr{CFunction::_wrap(f)}, _latex{latex}, _last_op{last_op} {}
+        CFunction(Tape::ptr const &tape, std::string const &latex, OP_TYPE const last_op) : _expr{Expr::Leaf(tape)}, _latex{Latex::Text::Literal(latex)}, _last_op{last_op} {}
+        CFunction(Tape::ptr const &tape, Latex::Text::ptr const &latex, OP_TYPE const last_op) : _expr{Expr::Leaf(tape)}, _latex{latex}, _last_op{last_op} {}
+        inline Ran operator()(Dom z) const { return from_complex<Ran>((*this->_tape())(z)); };
+        void operator()(Dom const *RESTRICT z, Ran *RESTRICT result, size_t const n) const; // Split across the ThreadPool.
+        // The same at another precision, for T and U the types of Dom and Ran in float or long double; see Tape::evaluate().
+        template<typename T, typename U> void operator()(T const *RESTRICT z, U *RESTRICT result, size_t const n) const;
+        /* The same over arrays of ndim dimensions of any layout, of the given shape, as NumPy lays them out: strides
+         * holds the strides in bytes of z, then of result, then of where, ndim of each, and a stride of 0 repeats a
+         * point along its dimension. Only the points whose byte of where is nonzero are evaluated, and the others'
+         * values left as they are; where may be null. result may overlap z only where each point is written over
+         * itself. T and U are Dom and Ran at any precision. */
+        template<typename T, typename U> void operator()(T const *z, U *result, uint8_t const *where, size_t const ndim,
+                                                         size_t const *shape, ptrdiff_t const *strides) const;
+        /* Evaluation over the nx by ny points of the complex plane from lo to hi, both included, laid out row by row as
+         * np.meshgrid lays them out; the points are generated tile by tile rather than read, for functions of a complex
+         * variable. result holds Ran values for GRID_VALUE and REAL ones otherwise; with block above 1, it holds only
+         * moduli, each the largest over a block by block square of points, in ceil(ny / block) rows of
+         * ceil(nx / block). Split across the ThreadPool. */
+        void grid(COMPLEX const lo, COMPLEX const hi, size_t const nx, size_t const ny, Grid const output, size_t const block,
+                  void *RESTRICT result) const;
         std::string latex(std::string const &varname = "z") const;
+        size_t memory() const; // Bytes held by the function, including what it shares with others.
+        inline size_t deduplicated() const noexcept { return this->_tape()->deduplicated; }
+        inline CFunction compile() const { return CFunction(Jit::compile(*this->_tape()), this->_latex, this->_last_op); }
+        inline std::shared_ptr<Tape::Path const> path() const noexcept { return this->_tape()->path(); }
+        inline std::vector<REAL> breakpoints() const { return this->_tape()->breakpoints(); }
+        inline std::shared_ptr<Tape::Chebyshev const> chebyshev() const noexcept { return this->_tape()->chebyshev(); }
+        /* A piecewise Chebyshev interpolant of a function of a real variable over [a, b], fit to samples of it over
+         * arrays (see Tape::Chebyshev::fit()), for evaluating it cheaply many times; it prints as the function does. */
+        CFunction approximate(REAL const a, REAL const b, REAL const tol) const;
 
         /* Function composition */
         template<typename Predom> CFunction<Predom, Ran> compose(CFunction<Predom, Dom> const &rhs) const;
@@ -98,10 +149,10 @@ namespace libcalculus {
         CFunction pow(CFunction const &rhs) const;
 
         /* Function-with-constant operators */
-        template<typename Dom_, typename Ran_> friend CFunction<Dom_, Ran_> operator+(CFunction<Dom_, Ran_> const &lhs, Ran const rhs);
-        template<typename Dom_, typename Ran_> friend CFunction<Dom_, Ran_> operator-(CFunction<Dom_, Ran_> const &lhs, Ran const rhs);
-        template<typename Dom_, typename Ran_> friend CFunction<Dom_, Ran_> operator*(CFunction<Dom_, Ran_> const &lhs, Ran const rhs);
-        template<typename Dom_, typename Ran_> friend CFunction<Dom_, Ran_> operator/(CFunction<Dom_, Ran_> const &lhs, Ran const rhs);
+        template<typename Dom_, typename Ran_> friend CFunction<Dom_, Ran_> operator+(CFunction<Dom_, Ran_> const &lhs, Ran_ const rhs);
+        template<typename Dom_, typename Ran_> friend CFunction<Dom_, Ran_> operator-(CFunction<Dom_, Ran_> const &lhs, Ran_ const rhs);
+        template<typename Dom_, typename Ran_> friend CFunction<Dom_, Ran_> operator*(CFunction<Dom_, Ran_> const &lhs, Ran_ const rhs);
+        template<typename Dom_, typename Ran_> friend CFunction<Dom_, Ran_> operator/(CFunction<Dom_, Ran_> const &lhs, Ran_ const rhs);
         CFunction pow(Ran const c) const;
 
         /* Constant-with-function operators */
@@ -119,7 +170,7 @@ namespace libcalculus {
 
         /* Preset instances */
         static inline CFunction Identity() { return CFunction::_Identity;  }
-        static inline CFunction Constant(Ran const c) { return CFunction([=](Dom z) noexcept { return c; }, Latex::fmt_const(c, false), OP_TYPE::CONST); }
+        static inline CFunction Constant(Ran const c) { return CFunction(Tape::Constant(is_real<Dom>, c, is_real<Ran>), Latex::fmt_const(c, false), OP_TYPE::CONST); }
         static inline CFunction Re() { return CFunction::_Re;  }
         static inline CFunction Im() { return CFunction::_Im; }
         static inline CFunction Conj() { return CFunction::_Conj; }
@@ -157,126 +208,129 @@ namespace libcalculus {
 
         static inline CFunction Pi() { return CFunction::_Pi; }
         static inline CFunction E() { return CFunction::_E; }
+        /* Contours of line segments and circular arcs, traced natively rather than through the tape's arithmetic;
+         * defined only for CFunction<REAL, COMPLEX>. Each runs over t from 0 to 1, and contours joined by Polyline,
+         * Rectangle and Concat get shares of that interval in proportion to their lengths. */
+        static CFunction Trace(std::shared_ptr<Tape::Path const> const &path);
+        static CFunction Line(COMPLEX const z1, COMPLEX const z2);
+        static CFunction Arc(COMPLEX const center, REAL const radius, REAL const start_angle, REAL const end_angle);
+        static CFunction Polyline(COMPLEX const *points, size_t const n, bool const closed);
+        static CFunction Rectangle(COMPLEX const z1, COMPLEX const z2);
+        static CFunction Concat(CFunction const *contours, size_t const n);
+        /* The function that evaluates an interpolant, for functions of a real variable. */
+        static inline CFunction Approximation(std::shared_ptr<Tape::Chebyshev const> const &chebyshev, OP_TYPE const last_op) {
+            return CFunction(Tape::Approximation(chebyshev, is_real<Ran>), chebyshev->latex, last_op);
+        }
+
         static inline CFunction If(CComparison<Dom> const &cond_, CFunction const &then_,
                                       CFunction const &else_ = CFunction::Constant(Ran{0})) {
-              std::string new_latex = "\\begin{cases} ";
-              new_latex.append(then_._latex);
-              new_latex.append(" & ;\\;");
-              new_latex.append(cond_.latex);
-              new_latex.append(" \\\\ ");
-              new_latex.append(else_._latex);
-              new_latex.append(" & ;\\;\\text{else}\\end{cases} ");
-              return CFunction([cond__ = cond_.eval, then__ = then_._f, else__ = else_._f](Dom const z) noexcept { return cond__(z) ? then__(z) : else__(z); },
-                               new_latex, OP_TYPE::IF);
+              Latex::Text::ptr const new_latex = Latex::join({"\\begin{cases} ", then_._latex, " & ;\\;", cond_.latex, " \\\\ ",
+                                                              else_._latex, " & ;\\;\\text{else}\\end{cases} "});
+              return CFunction(Tape::If(cond_.branch(then_._tape(), else_._tape())), new_latex, OP_TYPE::IF);
         }
     };
 
     /* Preset instances - instantiation */
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Identity = CFunction<Dom, Ran>([](Dom const z) noexcept { return z; }, "\\text{Re}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Identity = CFunction<Dom, Ran>(Tape::Variable(is_real<Dom>, is_real<Ran>), "\\text{Re}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Re = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::real(z); }, "\\text{Re}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Re = CFunction<Dom, Ran>(Tape::Preset(OPCODE::RE, is_real<Dom>, is_real<Ran>), "\\text{Re}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Im = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::imag(z); }, "\\text{Im}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Im = CFunction<Dom, Ran>(Tape::Preset(OPCODE::IM, is_real<Dom>, is_real<Ran>), "\\text{Im}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Conj = CFunction<Dom, Ran>(([]() constexpr {
-                                                                                                if constexpr (std::is_same<Ran, COMPLEX>::value)
-                                                                                                    return [](Dom const z) noexcept { return std::conj(z); };
-                                                                                                else
-                                                                                                    return [](Dom const z) noexcept { return z; };
-                                                                                              })(), "\\overline{" LATEX_VAR "}", OP_TYPE::NOP);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Conj = CFunction<Dom, Ran>(Tape::Preset(OPCODE::CONJ, is_real<Dom>, is_real<Ran>), "\\overline{" LATEX_VAR "}", OP_TYPE::NOP);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Abs = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::abs(z); }, "\\left|" LATEX_VAR "\\right|", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Abs = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ABS, is_real<Dom>, is_real<Ran>), "\\left|" LATEX_VAR "\\right|", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arg = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::arg(z); }, "\\text{arg}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arg = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARG, is_real<Dom>, is_real<Ran>), "\\text{arg}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Exp = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::exp(z); }, "e^{" LATEX_VAR "}", OP_TYPE::NOP);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Exp = CFunction<Dom, Ran>(Tape::Preset(OPCODE::EXP, is_real<Dom>, is_real<Ran>), "e^{" LATEX_VAR "}", OP_TYPE::NOP);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Ln = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::log(z); }, "\\text{ln}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Ln = CFunction<Dom, Ran>(Tape::Preset(OPCODE::LN, is_real<Dom>, is_real<Ran>), "\\text{ln}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Sin = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::sin(z); }, "\\sin\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Sin = CFunction<Dom, Ran>(Tape::Preset(OPCODE::SIN, is_real<Dom>, is_real<Ran>), "\\sin\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Cos = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::cos(z); }, "\\cos\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Cos = CFunction<Dom, Ran>(Tape::Preset(OPCODE::COS, is_real<Dom>, is_real<Ran>), "\\cos\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Tan = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::tan(z); }, "\\tan\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Tan = CFunction<Dom, Ran>(Tape::Preset(OPCODE::TAN, is_real<Dom>, is_real<Ran>), "\\tan\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Sec = CFunction<Dom, Ran>([](Dom const z) noexcept { return 1. / std::cos(z); }, "\\sec\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Sec = CFunction<Dom, Ran>(Tape::Preset(OPCODE::SEC, is_real<Dom>, is_real<Ran>), "\\sec\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Csc = CFunction<Dom, Ran>([](Dom const z) noexcept { return 1. / std::sin(z); }, "\\csc\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Csc = CFunction<Dom, Ran>(Tape::Preset(OPCODE::CSC, is_real<Dom>, is_real<Ran>), "\\csc\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Cot = CFunction<Dom, Ran>([](Dom const z) noexcept { return 1. / std::tan(z); }, "\\cot\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Cot = CFunction<Dom, Ran>(Tape::Preset(OPCODE::COT, is_real<Dom>, is_real<Ran>), "\\cot\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Sinh = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::sinh(z); }, "\\sinh\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Sinh = CFunction<Dom, Ran>(Tape::Preset(OPCODE::SINH, is_real<Dom>, is_real<Ran>), "\\sinh\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Cosh = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::cosh(z); }, "\\cosh\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Cosh = CFunction<Dom, Ran>(Tape::Preset(OPCODE::COSH, is_real<Dom>, is_real<Ran>), "\\cosh\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Tanh = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::tanh(z); }, "\\tanh\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Tanh = CFunction<Dom, Ran>(Tape::Preset(OPCODE::TANH, is_real<Dom>, is_real<Ran>), "\\tanh\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Sech = CFunction<Dom, Ran>([](Dom const z) noexcept { return 1. / std::cosh(z); }, "\\text{sech}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Sech = CFunction<Dom, Ran>(Tape::Preset(OPCODE::SECH, is_real<Dom>, is_real<Ran>), "\\text{sech}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Csch = CFunction<Dom, Ran>([](Dom const z) noexcept { return 1. / std::sinh(z); }, "\\text{csch}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Csch = CFunction<Dom, Ran>(Tape::Preset(OPCODE::CSCH, is_real<Dom>, is_real<Ran>), "\\text{csch}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Coth = CFunction<Dom, Ran>([](Dom const z) noexcept { return 1. / std::tanh(z); }, "\\coth\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Coth = CFunction<Dom, Ran>(Tape::Preset(OPCODE::COTH, is_real<Dom>, is_real<Ran>), "\\coth\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arcsin = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::asin(z); }, "\\text{arcsin}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arcsin = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARCSIN, is_real<Dom>, is_real<Ran>), "\\text{arcsin}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arccos = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::acos(z); }, "\\text{arccos}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arccos = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARCCOS, is_real<Dom>, is_real<Ran>), "\\text{arccos}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arctan = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::atan(z); }, "\\text{arctan}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arctan = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARCTAN, is_real<Dom>, is_real<Ran>), "\\text{arctan}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arccsc = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::asin(1. / z); }, "\\text{arccsc}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arccsc = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARCCSC, is_real<Dom>, is_real<Ran>), "\\text{arccsc}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arcsec = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::acos(1. / z); }, "\\text{arcsec}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arcsec = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARCSEC, is_real<Dom>, is_real<Ran>), "\\text{arcsec}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arccot = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::atan(1. / z); }, "\\text{arccot}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arccot = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARCCOT, is_real<Dom>, is_real<Ran>), "\\text{arccot}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arsinh = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::asinh(z); }, "\\text{arsinh}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arsinh = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARSINH, is_real<Dom>, is_real<Ran>), "\\text{arsinh}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arcosh = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::acosh(z); }, "\\text{arcosh}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arcosh = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARCOSH, is_real<Dom>, is_real<Ran>), "\\text{arcosh}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Artanh = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::atanh(z); }, "\\text{artanh}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Artanh = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARTANH, is_real<Dom>, is_real<Ran>), "\\text{artanh}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arcsch = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::asinh(1. / z); }, "\\text{arcsch}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arcsch = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARCSCH, is_real<Dom>, is_real<Ran>), "\\text{arcsch}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arsech = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::acosh(1. / z); }, "\\text{arsech}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arsech = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARSECH, is_real<Dom>, is_real<Ran>), "\\text{arsech}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arcoth = CFunction<Dom, Ran>([](Dom const z) noexcept { return std::atanh(1. / z); }, "\\text{arcoth}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Arcoth = CFunction<Dom, Ran>(Tape::Preset(OPCODE::ARCOTH, is_real<Dom>, is_real<Ran>), "\\text{arcoth}\\left(" LATEX_VAR "\\right)", OP_TYPE::FUNC);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Pi = CFunction<Dom, Ran>([](Dom const z) noexcept { return M_PI; }, "\\pi", OP_TYPE::NOP);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_Pi = CFunction<Dom, Ran>(Tape::Constant(is_real<Dom>, M_PI, is_real<Ran>), "\\pi", OP_TYPE::NOP);
 
     template<typename Dom, typename Ran>
-    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_E = CFunction<Dom, Ran>([](Dom const z) noexcept { return M_E; }, "e", OP_TYPE::NOP);
+    CFunction<Dom, Ran> const CFunction<Dom, Ran>::_E = CFunction<Dom, Ran>(Tape::Constant(is_real<Dom>, M_E, is_real<Ran>), "e", OP_TYPE::NOP);
 
 }
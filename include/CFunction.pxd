@@ -1,5 +1,22 @@
 from Definitions cimport *
 from CComparison cimport *
+from libc.stdint cimport uint8_t
+from libc.stddef cimport ptrdiff_t
+
+cdef extern from "Kernels.cpp" nogil:
+  pass
+
+cdef extern from "Tape.cpp" nogil:
+  pass
+
+cdef extern from "Expr.cpp" nogil:
+  pass
+
+cdef extern from "Taylor.cpp" nogil:
+  pass
+
+cdef extern from "Jit.cpp" nogil:
+  pass
 
 cdef extern from "CFunction.cpp" nogil:
   pass
@@ -7,13 +24,28 @@ cdef extern from "CFunction.cpp" nogil:
 cdef extern from "Latex.cpp" nogil:
   pass
 
+cdef extern from "Contours.cpp" nogil:
+  pass
+
 cdef extern from "CFunction.h" namespace "libcalculus" nogil:
+  cdef enum Grid:
+    GRID_VALUE
+    GRID_ABS
+    GRID_ARG
+
   cdef cppclass CFunction[Dom, Ran]:
     CFunction() except +
     CFunction(CFunction[Dom, Ran] cf) except +
     Ran operator()(Dom z) except +
     void _call_array "operator()"(Dom *z, Ran *result, size_t n) except +
+    void _call_array_at "operator()"[T, U](T *z, U *result, size_t n) except +
+    void _call_strided "operator()"[T, U](T *z, U *result, uint8_t *where, size_t ndim, size_t *shape, ptrdiff_t *strides) except +
+    void grid(COMPLEX lo, COMPLEX hi, size_t nx, size_t ny, Grid output, size_t block, void *result) except +
     string latex(string &varname) except +
+    size_t deduplicated()
+    size_t memory() except +
+    CFunction[Dom, Ran] compile() except +
+    CFunction[Dom, Ran] approximate(REAL a, REAL b, REAL tol) except +
 
     # Function composition
     CFunction[Predom, Ran] compose[Predom](CFunction[Predom, Dom] &rhs) except +
@@ -126,6 +158,18 @@ cdef extern from "CFunction.h" namespace "libcalculus" nogil:
     @staticmethod
     CFunction[Dom, Ran] If(CComparison[Dom] &cond_, CFunction[Dom, Ran] &then_, CFunction[Dom, Ran] &else_) except +
 
+    # Contours of line segments and arcs
+    @staticmethod
+    CFunction[Dom, Ran] Line(COMPLEX z1, COMPLEX z2) except +
+    @staticmethod
+    CFunction[Dom, Ran] Arc(COMPLEX center, REAL radius, REAL start_angle, REAL end_angle) except +
+    @staticmethod
+    CFunction[Dom, Ran] Polyline(const COMPLEX *points, size_t n, cbool closed) except +
+    @staticmethod
+    CFunction[Dom, Ran] Rectangle(COMPLEX z1, COMPLEX z2) except +
+    @staticmethod
+    CFunction[Dom, Ran] Concat(const CFunction[Dom, Ran] *contours, size_t n) except +
+
   # Constant-with-function operators
   CFunction[COMPLEX, COMPLEX] csubC "operator-"(COMPLEX lhs, CFunction[COMPLEX, COMPLEX] &rhs) except +
   CFunction[COMPLEX, COMPLEX] cdivC "operator/"(COMPLEX lhs, CFunction[COMPLEX, COMPLEX] &rhs) except +
@@ -1,5 +1,6 @@
 #pragma once
 #include <complex>
+#include <type_traits>
 
 #if defined(_WIN32) || defined(WIN32)
 #define RESTRICT __restrict
@@ -7,6 +8,13 @@
 #define RESTRICT __restrict__
 #endif
 
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+// Compile the function for baseline x86-64, AVX2 and AVX-512, and pick the best version at load time.
+#define SIMD_CLONES __attribute__((target_clones("default", "arch=x86-64-v3", "arch=x86-64-v4")))
+#else
+#define SIMD_CLONES
+#endif
+
 namespace libcalculus {
     using namespace std::complex_literals;
     enum OP_TYPE {
@@ -25,10 +33,65 @@ namespace libcalculus {
         IF, // Cases
     };
 
+    enum class OPCODE : unsigned char {
+        VAR, // The function's argument
+        CONST, // Constant
+        WIDEN, // Conversion of a real value to a complex one
+        OPAQUE, // Opaque callable: x -> g(x)
+        IF, // Cases: x -> cond(x) ? then(x) : else(x)
+        DERIVATIVE, // Derivative of another tape: x -> f^(n)(x)
+        PATH, // Contour of line segments and arcs: t -> path(t)
+
+        /* Function-with-function operators */
+        ADD, // (x, y) -> x + y
+        SUB, // (x, y) -> x - y
+        MUL, // (x, y) -> x * y
+        DIV, // (x, y) -> x / y
+        POW, // (x, y) -> x ^ y
+
+        /* Function-with-constant operators */
+        ADDC, // x -> x + c
+        SUBC, // x -> x - c
+        CSUB, // x -> c - x
+        MULC, // x -> c * x
+        DIVC, // x -> x / c
+        CDIV, // x -> c / x
+        POWC, // x -> x ^ c
+        CPOW, // x -> c ^ x
+        NEG, // x -> -x
+
+        /* Preset functions */
+        RE, IM, CONJ, ABS, ARG, EXP, LN,
+        SIN, COS, TAN, SEC, CSC, COT,
+        SINH, COSH, TANH, SECH, CSCH, COTH,
+        ARCSIN, ARCCOS, ARCTAN, ARCCSC, ARCSEC, ARCCOT,
+        ARSINH, ARCOSH, ARTANH, ARCSCH, ARSECH, ARCOTH,
+
+        /* Added after the presets so that the values of the others, which tapes are written out with, stay the same */
+        CHEBYSHEV, // Piecewise Chebyshev interpolant: t -> p(t)
+    };
+
     using REAL = double;
     using COMPLEX = std::complex<double>;
-    static inline double constexpr INTEGRATION_SUBDIV_FACTOR = .05; // With integration tolerance tol, the domain will
-                                                                    // divided into INTEGRATION_SUBDIV_FACTOR / tol rectangles.
+    /* The floating-point type of values of type T, and the type like T - real or complex - at the precision F. Array
+     * evaluation also runs in float, for screening large grids, and in long double, for ill-conditioned problems. */
+    template<typename T> struct Precision { using type = T; };
+    template<typename F> struct Precision<std::complex<F>> { using type = F; };
+    template<typename T> using precision_of = typename Precision<T>::type;
+    template<typename T, typename F> using at_precision = std::conditional_t<std::is_floating_point<T>::value, F, std::complex<F>>;
+    static inline size_t constexpr INTEGRATION_MAX_INTERVALS = 1 << 16; // Adaptive integration stops refining at this many intervals.
+    static inline size_t constexpr CHEBYSHEV_DEGREE = 32; // Chebyshev interpolants are fit with pieces of up to this degree,
+    static inline size_t constexpr CHEBYSHEV_MAX_PIECES = 1 << 12; // and stop refining at this many pieces.
+    static inline size_t constexpr DERIVATIVE_MAX_ORDER = 1 << 10; // Taylor-mode derivatives, whose series cost the square
+                                                                   // of their order, are taken up to this order.
+    static inline size_t constexpr TAPE_BLOCK_SIZE = 256; // Array evaluation runs every instruction over blocks of this many points.
+    static inline size_t constexpr PARALLEL_GRAIN = 16 * TAPE_BLOCK_SIZE; // Array evaluation is split between threads in
+                                                                         // ranges of up to this many points.
+    inline size_t NUM_THREADS = 1; // Threads the C++ routines split their work across; set by libcalculus.threads().
+    inline bool PRESERVE_NAN = false; // Whether functions are built as written, without rewrites such as f * 0 -> 0 and
+                                      // f * -1 -> -f, which change the NaNs, infinities and signs of zeros f may produce.
+
+    namespace Serial { class Writer; class Reader; } // Friends of the classes they write out and load; see Serial.h.
 
     template<typename T>
     struct Traits {
@@ -38,6 +101,10 @@ namespace libcalculus {
                 return 1e-6;
             else if constexpr (std::is_same<T, COMPLEX>::value)
                 return 1e-6;
+            else if constexpr (std::is_same<precision_of<T>, float>::value)
+                return 1e-3;
+            else if constexpr (std::is_same<precision_of<T>, long double>::value)
+                return 1e-9;
         }();
 
         inline static bool close(T const a, T const b, REAL const tol=Traits<T>::tol) noexcept { return std::abs(a - b) < tol; }
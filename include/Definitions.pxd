@@ -8,6 +8,11 @@ np.import_array()
 
 ctypedef double REAL
 ctypedef np.complex128_t COMPLEX
+# The same in single and extended precision, which arrays of those dtypes are evaluated in.
+ctypedef float REAL_SINGLE
+ctypedef np.complex64_t COMPLEX_SINGLE
+ctypedef long double REAL_EXTENDED
+ctypedef long double complex COMPLEX_EXTENDED
 
 cimport cython
 
@@ -15,10 +20,10 @@ cdef inline cbool _isrealscalar(x):
   return isinstance(x, (int, float, np.int8, np.int16, np.int32, np.int64, np.float16, np.float32, np.float64, np.double))
 
 cdef inline cbool _isrealarray(x):
-  return isinstance(x, np.ndarray) and x.dtype in (int, float, np.int8, np.int16, np.int32, np.int64, np.float16, np.float32, np.float64, np.double)
+  return isinstance(x, np.ndarray) and x.dtype in (int, float, np.int8, np.int16, np.int32, np.int64, np.float16, np.float32, np.float64, np.double, np.longdouble)
 
 cdef inline cbool _iscomplexscalar(x):
   return isinstance(x, (complex, np.complex64, np.complex128))
 
 cdef inline cbool _iscomplexarray(x):
-  return isinstance(x, np.ndarray) and x.dtype in (complex, np.complex64, np.complex128)
+  return isinstance(x, np.ndarray) and x.dtype in (complex, np.complex64, np.complex128, np.clongdouble)
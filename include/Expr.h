@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <unordered_set>
+#include "Definitions.h"
+#include "Tape.h"
+
+namespace libcalculus {
+    /* A function as an immutable graph of operations on tapes. Operations on functions make a single node that refers
+     * to its operands, rather than copying them into a new tape, so building an expression of n operations takes O(n);
+     * the tape of an expression is built from its nodes when it is first needed, and kept. Nodes are shared between all
+     * the expressions that use them, and are allocated from a pool set aside for them. */
+    class Expr {
+    public:
+        using ptr = std::shared_ptr<Expr const>;
+        enum class Kind : unsigned char {
+            LEAF, // A tape
+            UNARY, // op(a)
+            BINARY, // op(a, b)
+            WITH_CONST, // op(a, c)
+            COMPOSE, // a(b)
+        };
+
+        Kind const kind;
+        OPCODE const op;
+        bool const dom_real, ran_real;
+        COMPLEX const c;
+
+        Expr(Kind const kind, OPCODE const op, bool const dom_real, bool const ran_real, COMPLEX const c, ptr const &a,
+             ptr const &b, Tape::ptr const &tape);
+        ~Expr();
+
+        /* The tape computing the expression, built on the first call. */
+        Tape::ptr const &tape() const;
+
+        /* What the tape of the expression would be without building it: whether it is the argument itself, whether it
+         * is a single instruction on the argument, and its last instruction and that instruction's constant. */
+        bool identity() const noexcept;
+        bool single() const noexcept;
+        OPCODE last() const noexcept;
+        COMPLEX last_const() const noexcept;
+
+        /* Bytes held by the nodes and tapes of the expression, counting anything already in seen as held elsewhere. */
+        size_t memory(std::unordered_set<void const *> &seen) const;
+
+        /* Construction */
+        static ptr Leaf(Tape::ptr const &tape);
+        static ptr Variable(bool const dom_real, bool const ran_real);
+        static ptr Unary(OPCODE const op, ptr const &x);
+        static ptr Binary(OPCODE const op, ptr const &lhs, ptr const &rhs);
+        static ptr WithConst(OPCODE const op, ptr const &x, COMPLEX const c);
+        static ptr Compose(ptr const &lhs, ptr const &rhs);
+
+    private:
+        friend class Serial::Writer;
+        friend class Serial::Reader;
+
+        ptr a, b;
+        mutable Tape::ptr cached;
+        mutable std::atomic<bool> built = false;
+
+        Tape::ptr build() const;
+    };
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include "Definitions.h"
+#include "Tape.h"
+
+namespace libcalculus {
+    /* Compilation of tapes to native code: the tape is lowered to C++, built into a shared object by the system compiler
+     * (the CXX environment variable, g++ by default) and loaded with dlopen. Runs of arithmetic instructions are fused into
+     * single loops; preset functions with vectorized kernels, opaque functions, cases and derivatives call back into the tape.
+     *
+     * Shared objects are cached in LIBCALCULUS_CACHE_DIR (by default $XDG_CACHE_HOME/libcalculus or ~/.cache/libcalculus),
+     * named by a hash of the generated source, the compiler and its flags, so equal functions compile only once. */
+    namespace Jit {
+        std::string source(Tape const &tape);
+        Tape::ptr compile(Tape const &tape);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <complex>
+#include "Definitions.h"
+
+namespace libcalculus {
+    /* Vectorized implementations of the preset functions, used by array evaluation of the tape.
+     * Each kernel is branch-free, so the compiler turns its loop into SIMD code; with GCC on x86-64 every loop is also
+     * cloned for AVX2 and AVX-512 and the best clone is picked at load time (see SIMD_CLONES). Vectorizing the selects
+     * requires -fno-trapping-math and -fno-math-errno, which setup.py passes.
+     *
+     * Error bounds within each kernel's range (see in_range) - in ULPs for REAL, and as |error| / |result| in units of
+     * 2^-52 for COMPLEX; the inverse reciprocal functions are bounded relative to their scalar definition, e.g.
+     * Arccsc(x) = Arcsin(1 / x) with 1 / x rounded:
+     *   REAL:    Exp, Ln, Arctan, Arccot 1; Sin, Cos, Cosh 1.5; Sinh, Tanh and the other inverse functions 2.5;
+     *            Tan, Cot, Sec, Csc, Sech, Csch, Coth 3.5.
+     *   COMPLEX: Abs, Arg, Exp, Ln, Sin, Cos, Sinh, Cosh, Arcsin, Arccos, Arsinh, Arcosh 2; Tan, Tanh and the other
+     *            reciprocal and inverse reciprocal functions 3.5; Arctan, Artanh, Arccot, Arcoth 5.5.
+     * Re, Im, Conj, Neg and the real Abs need no kernel, as they already compile to SIMD code. */
+    namespace Kernels {
+        static inline bool constexpr has_kernel(OPCODE const op, bool const real) noexcept {
+            return op >= (real ? OPCODE::ARG : OPCODE::ABS) && op <= OPCODE::ARCOTH;
+        }
+        template<OPCODE op, typename T> static inline bool constexpr exists =
+            (std::is_same<T, REAL>::value || std::is_same<T, COMPLEX>::value) && has_kernel(op, std::is_same<T, REAL>::value);
+
+        /* Whether x lies in the range where the kernel for op meets its bound and gives the signs of zeros that the
+         * standard library does; values outside it, and values for which the kernel returns an infinity or NaN, must
+         * be recomputed by the scalar standard library function. */
+        template<OPCODE op, typename T> bool in_range(T const x) noexcept;
+
+        template<OPCODE op, typename T> void run(T const *RESTRICT x, T *RESTRICT result, size_t const n) noexcept;
+    }
+}
@@ -1,11 +1,63 @@
 #pragma once
+#include <atomic>
+#include <initializer_list>
+#include <memory>
 #include <string>
+#include <unordered_set>
+#include <vector>
 #include "Definitions.h"
 
+#define LATEX_VAR "%var"
+
 namespace libcalculus {
     namespace Latex {
+        /* LaTeX markup kept as the pieces it is made of, and only put together when it is rendered, so that building a
+         * function does not copy the markup of its operands: a text is a string, which may hold LATEX_VAR for the
+         * variable, or texts one after another, or a text with its variable replaced by another text. Texts are
+         * immutable and shared; rendering keeps the result. */
+        class Text {
+        public:
+            using ptr = std::shared_ptr<Text const>;
+            enum class Kind : unsigned char { LITERAL, JOIN, SUBSTITUTE };
+
+            Text(Kind const kind, std::string const &literal, std::vector<ptr> const &parts);
+            ~Text();
+
+            std::string const &render() const;
+            size_t memory(std::unordered_set<void const *> &seen) const;
+
+            static ptr Literal(std::string const &literal);
+            static ptr Join(std::vector<ptr> const &parts);
+            static ptr Substitute(ptr const &outer, ptr const &inner); // outer, with inner for its variable.
+
+        private:
+            friend class Serial::Writer;
+
+            Kind kind;
+            std::string literal;
+            std::vector<ptr> parts; // Those joined, or the outer and inner texts of a substitution.
+            mutable std::string rendered;
+            mutable std::atomic<bool> done = false;
+
+            void render_into(std::string &out) const;
+        };
+
+        /* A piece of a text being joined: a string, or another text. */
+        struct Part {
+            Text::ptr text;
+            Part(Text::ptr const &text) : text{text} {}
+            Part(std::string const &literal) : text{Text::Literal(literal)} {}
+            Part(char const *literal) : text{Text::Literal(literal)} {}
+        };
+        Text::ptr variable(); // The variable alone, shared.
+        Text::ptr join(std::initializer_list<Part> const parts);
+
+        /* The markup with its variable named varname. */
+        std::string with_var(std::string const &markup, std::string const &varname);
+
         std::string _parenthesize(std::string const &expr);
-        std::string parenthesize_if(std::string const &expr, OP_TYPE const new_op, OP_TYPE const last_op);
+        Text::ptr _parenthesize(Text::ptr const &expr);
+        Text::ptr parenthesize_if(Text::ptr const &expr, OP_TYPE const new_op, OP_TYPE const last_op);
 
         template<typename T> std::string fmt_const(T const a, bool const parenthesize = false);
     }
@@ -0,0 +1,52 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "Definitions.h"
+
+namespace libcalculus {
+    class Tape;
+
+    /* Opt-in statistics of where evaluation and the numeric routines spend their work, for finding what makes a
+     * function slow. Nothing is recorded unless enabled is set: evaluation tests it once per call, to choose between
+     * the plain loop over the instructions and one that times each of them. */
+    namespace Profile {
+        inline bool enabled = false; // Set by libcalculus.profile().
+        using Clock = std::chrono::steady_clock;
+
+        /* Of an instruction of a tape: how many times it ran, over how many points altogether, and for how long. */
+        struct Node {
+            uint64_t calls = 0, points = 0;
+            double seconds = 0.;
+
+            inline void add(size_t const n, Clock::time_point const start) noexcept {
+                ++this->calls;
+                this->points += n;
+                this->seconds += std::chrono::duration<double>(Clock::now() - start).count();
+            }
+        };
+
+        /* Of the numeric routines: the integrals computed by quadrature, the passes of refinement they took, the
+         * evaluations of their integrands, the intervals they ended with and the sum of their error estimates; and the
+         * values of numeric derivatives computed, the halvings of the step they took, and how many of them ended with
+         * a step too small to change the argument before two consecutive estimates agreed. */
+        struct Numeric {
+            uint64_t integrals = 0, passes = 0, evaluations = 0, intervals = 0;
+            REAL error = 0.;
+            uint64_t derivatives = 0, halvings = 0, unconverged = 0;
+        };
+
+        /* Adds the counts of every instruction of the tape, nodes[i] for instruction i, to those recorded for it.
+         * Tapes not owned by a shared pointer are not recorded. */
+        void record(Tape const &tape, Node const *nodes);
+        void record(Numeric const &numeric);
+
+        /* What was recorded since the last reset(): the counts of every instruction of the tape, and of the numeric
+         * routines. */
+        std::vector<Node> nodes(Tape const &tape);
+        Numeric numeric();
+        void reset();
+
+        char const *name(OPCODE const op) noexcept;
+    }
+}
@@ -0,0 +1,16 @@
+from Definitions cimport *
+from libc.stdint cimport uint64_t
+
+cdef extern from "Profile.cpp" nogil:
+  pass
+
+cdef extern from "Profile.h" namespace "libcalculus::Profile" nogil:
+  cdef cppclass Node:
+    uint64_t calls, points
+    double seconds
+  cdef cppclass Numeric:
+    uint64_t integrals, passes, evaluations, intervals
+    REAL error
+    uint64_t derivatives, halvings, unconverged
+  Numeric numeric() except +
+  void reset() except +
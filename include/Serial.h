@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Definitions.h"
+#include "CFunction.h"
+
+namespace libcalculus {
+    /* A compact binary format for functions and comparisons. What they are made of - expression nodes, tapes, paths,
+     * interpolants, conditions and LaTeX texts - is written once however often it is shared, as records that refer only to records
+     * before them, so loading is a single pass that builds every record from ones already built. Tapes are written
+     * with their register allocation, and expressions with the tapes they had built, so loading simplifies and
+     * allocates nothing again, and can read the records in place from a memory-mapped file.
+     *
+     * The data starts with a header naming the format, its version, the kind of object it holds, the number of records
+     * and its size; numbers are in the byte order of the machine that wrote them, which the header records too.
+     * Functions of opaque callables cannot be written out. Compiled functions are compiled again when loaded, which
+     * usually finds them in the disk cache, and are interpreted if that fails. */
+    namespace Serial {
+        static inline uint32_t constexpr VERSION = 2; // 2 added Chebyshev interpolants; data of version 1 still loads.
+        enum Object : uint32_t { COMPLEX_FUNCTION, CONTOUR, REAL_FUNCTION, COMPLEX_COMPARISON, REAL_COMPARISON };
+        enum class Record : uint8_t { TEXT, PATH, CONDITION, TAPE, EXPR, FUNCTION, COMPARISON, CHEBYSHEV };
+
+        template<typename Dom, typename Ran> std::string dump(CFunction<Dom, Ran> const &f);
+        template<typename Dom> std::string dump(CComparison<Dom> const &c);
+
+        /* The kind of object the data holds; loading throws std::invalid_argument if it is not the one asked for, or
+         * if the data is malformed. */
+        Object object(char const *data, size_t const size);
+        template<typename Dom, typename Ran> CFunction<Dom, Ran> load_function(char const *data, size_t const size);
+        template<typename Dom> CComparison<Dom> load_comparison(char const *data, size_t const size);
+
+        class Writer {
+        public:
+            explicit Writer(Object const object);
+            template<typename Dom, typename Ran> void function(CFunction<Dom, Ran> const &f);
+            template<typename Dom> void comparison(CComparison<Dom> const &c);
+            std::string finish();
+
+        private:
+            struct Item {
+                Record type;
+                void const *object;
+            };
+            std::string out;
+            uint32_t records = 0;
+            std::unordered_map<void const *, uint32_t> ids[static_cast<size_t>(Record::CHEBYSHEV) + 1]; // By type of record.
+            std::unordered_set<Expr const *> roots; // Nodes written with their tapes, if built, as well as leaves.
+
+            template<typename T> inline void put(T const value) { this->out.append(reinterpret_cast<char const *>(&value), sizeof(T)); }
+            uint32_t id(Record const type, void const *object) const;
+            void visit(Record const type, void const *object);
+            std::vector<Item> children(Item const &item) const;
+            Tape const *tape(Expr const &expr) const;
+            void emit(Item const &item);
+        };
+
+        class Reader {
+        public:
+            Reader(char const *data, size_t const size);
+            Object object;
+            template<typename Dom, typename Ran> CFunction<Dom, Ran> function();
+            template<typename Dom> CComparison<Dom> comparison();
+
+        private:
+            char const *cursor, *end;
+            uint32_t version, records;
+            std::vector<Latex::Text::ptr> texts;
+            std::vector<std::shared_ptr<Tape::Path const>> paths;
+            std::vector<std::shared_ptr<Tape::Chebyshev const>> chebyshevs;
+            std::vector<std::shared_ptr<Condition const>> conditions;
+            std::vector<Tape::ptr> tapes;
+            std::vector<Expr::ptr> exprs;
+
+            template<typename T> T get();
+            template<typename T> T ref(std::vector<T> const &table, bool const optional = false);
+            void read(Record const root); // Up to the last record, which must be of type root.
+            void text();
+            void path();
+            void chebyshev();
+            void condition();
+            void tape();
+            void expr();
+            template<typename Dom> CComparison<Dom> rebuild(std::shared_ptr<Condition const> const &condition) const;
+            template<typename Dom, typename Ran> static CComparison<Dom> compare(Condition const &condition);
+        };
+    }
+}
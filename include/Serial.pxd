@@ -0,0 +1,20 @@
+from Definitions cimport *
+from CComparison cimport CComparison
+from CFunction cimport CFunction
+
+cdef extern from "Serial.cpp" nogil:
+  pass
+
+cdef extern from "Serial.h" namespace "libcalculus::Serial" nogil:
+  cdef enum Object:
+    COMPLEX_FUNCTION
+    CONTOUR
+    REAL_FUNCTION
+    COMPLEX_COMPARISON
+    REAL_COMPARISON
+
+  string dump[Dom, Ran](CFunction[Dom, Ran] &f) except +
+  string dump_comparison "libcalculus::Serial::dump"[Dom](CComparison[Dom] &c) except +
+  Object data_object "libcalculus::Serial::object"(const char *data, size_t size) except +
+  CFunction[Dom, Ran] load_function[Dom, Ran](const char *data, size_t size) except +
+  CComparison[Dom] load_comparison[Dom](const char *data, size_t size) except +
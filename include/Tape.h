@@ -0,0 +1,193 @@
+#pragma once
+#include <complex>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <cstdint>
+#include "Definitions.h"
+#include "Latex.h"
+#include "Profile.h"
+
+namespace libcalculus {
+    struct Condition; // See CComparison.h.
+
+    /* Helpers for moving values in and out of the tape, which stores everything as COMPLEX. */
+    template<typename T> static inline bool constexpr is_real = std::is_floating_point<T>::value;
+    template<typename T> inline T from_complex(COMPLEX const z) noexcept {
+        if constexpr (is_real<T>) return std::real(z);
+        else return z;
+    }
+
+    static inline bool is_binary(OPCODE const op) noexcept {
+        return op == OPCODE::ADD || op == OPCODE::SUB || op == OPCODE::MUL || op == OPCODE::DIV || op == OPCODE::POW;
+    }
+
+    static inline bool has_operand(OPCODE const op) noexcept {
+        return op != OPCODE::VAR && op != OPCODE::CONST;
+    }
+
+    struct Instruction {
+        OPCODE op;
+        bool real; // Whether the instruction operates on REAL values (otherwise COMPLEX).
+        uint32_t a = 0, b = 0; // Operands - indices of earlier instructions.
+        uint32_t aux = 0; // Index into the opaque or branch tables.
+        COMPLEX c = 0.; // Constant operand.
+    };
+
+    /* A flat, topologically ordered program computing a function; instruction 0 is always the argument (VAR),
+     * and every other instruction refers only to instructions before it. Tapes are shared, and the profiler knows them
+     * by their owner (see Profile.h). */
+    class Tape : public std::enable_shared_from_this<Tape> {
+    public:
+        using Opaque = std::function<COMPLEX(COMPLEX)>;
+        using Mask = std::function<void(void const *RESTRICT, uint64_t *RESTRICT, size_t)>;
+        struct Branch {
+            std::function<bool(COMPLEX)> cond;
+            Mask cond_array; // The condition over an array of arguments, into a packed mask (see CComparison).
+            std::shared_ptr<Tape const> then_, else_;
+            Latex::Text::ptr latex; // Of the condition, for rebuilding function objects from the tape.
+            std::shared_ptr<Condition const> condition; // What cond tests, for writing the tape out.
+        };
+        struct Diff {
+            std::shared_ptr<Tape const> f;
+            size_t order;
+        };
+        /* A contour made of line segments and circular arcs over consecutive intervals of its parameter t: with
+         * s = t - start, a piece is a + b s if omega is 0, and a + b e^(i omega s) otherwise. Outside [start, end] of
+         * the whole path, the first and last pieces extend. The derivative of a path is a path of the same pieces. */
+        struct Path {
+            struct Piece {
+                REAL start, end;
+                COMPLEX a, b;
+                REAL omega = 0.;
+            };
+            std::vector<Piece> pieces;
+
+            Piece const &piece(REAL const t) const noexcept;
+            COMPLEX operator()(REAL const t) const noexcept;
+            void operator()(REAL const *RESTRICT t, COMPLEX *RESTRICT result, size_t const n) const;
+            Path derivative() const;
+            REAL length(REAL const from, REAL const to) const noexcept;
+        };
+        /* A piecewise Chebyshev interpolant of a function of a real variable t, standing in for it where it is costly
+         * to evaluate: over each of consecutive intervals [start, end], the sum of coeffs[k] T_k(s) with
+         * s = (2t - start - end) / (end - start), evaluated by Clenshaw's recurrence. Outside [start, end] of the
+         * whole interpolant, the first and last pieces extend. Its derivative and antiderivative are interpolants of
+         * the same pieces, computed from the coefficients. */
+        struct Chebyshev {
+            struct Piece {
+                REAL start, end;
+                std::vector<COMPLEX> coeffs;
+            };
+            using Sampler = std::function<void(REAL const *RESTRICT, COMPLEX *RESTRICT, size_t)>;
+            std::vector<Piece> pieces;
+            REAL error = 0.; // The bound on its distance from the function it was fit to.
+            Latex::Text::ptr latex; // Of that function, for rebuilding function objects from the tape.
+
+            Piece const &piece(REAL const t) const noexcept;
+            COMPLEX operator()(REAL const t) const noexcept;
+            /* Into an array of REAL if real, and of COMPLEX otherwise. */
+            void operator()(REAL const *RESTRICT t, void *RESTRICT result, size_t const n, bool const real) const;
+            Chebyshev derivative() const;
+            Chebyshev antiderivative() const; // The one that is 0 at the start of the first piece.
+
+            /* Fits an interpolant to f over [a, b], f sampling the function over arrays of points: pieces of degree up
+             * to CHEBYSHEV_DEGREE are bisected until their coefficients fall below tol times the largest magnitude of
+             * the function, or tol where that is below 1, and trailing coefficients are dropped while they add up to
+             * less than that. */
+            static Chebyshev fit(Sampler const &f, REAL const a, REAL const b, REAL const tol);
+        };
+        using ptr = std::shared_ptr<Tape const>;
+
+        std::vector<Instruction> code;
+        std::vector<std::shared_ptr<Opaque const>> opaques;
+        std::vector<std::shared_ptr<Branch const>> branches;
+        std::vector<std::shared_ptr<Diff const>> diffs;
+        std::vector<std::shared_ptr<Path const>> paths;
+        std::vector<std::shared_ptr<Chebyshev const>> chebyshevs;
+        uint32_t root = 0;
+
+        /* Native code compiled from the tape by Jit::compile(), which evaluation runs instead of interpreting the tape.
+         * It calls back into the tape for instructions that are not inlined into it, through run_instruction(). */
+        struct Native {
+            using Callback = void (*)(void const *tape, uint32_t i, void const *x, void const *y, void *out, size_t n);
+            using Function = void (*)(void const *z, void *result, size_t n, void const *tape, Callback callback);
+            std::shared_ptr<void> library;
+            Function run;
+        };
+        std::shared_ptr<Native const> native;
+
+        /* Register allocation, filled by finalize(): dst[i] is the register instruction i writes to. */
+        std::vector<uint32_t> dst;
+        uint32_t n_regs = 0;
+
+        /* How many operations of the expression, written out as a tree, are shared with an identical subexpression
+         * rather than evaluated separately. Filled by finalize(). */
+        size_t deduplicated = 0;
+
+        inline bool dom_real() const noexcept { return this->code[0].real; }
+        inline bool ran_real() const noexcept { return this->code[this->root].real; }
+        inline OPCODE last() const noexcept { return this->code[this->root].op; }
+        inline COMPLEX last_const() const noexcept { return this->code[this->root].c; }
+
+        /* The path the tape traces, if it is nothing but a path applied to its argument. */
+        inline std::shared_ptr<Path const> path() const noexcept {
+            return this->code.size() == 2 && this->last() == OPCODE::PATH ? this->paths[this->code[1].aux] : nullptr;
+        }
+        /* The interpolant the tape evaluates, if it is nothing but one applied to its argument. */
+        inline std::shared_ptr<Chebyshev const> chebyshev() const noexcept {
+            return this->code.size() == 2 && this->last() == OPCODE::CHEBYSHEV ? this->chebyshevs[this->code[1].aux] : nullptr;
+        }
+        /* The sorted parameters where a path applied to the argument passes from one piece to the next; the function
+         * is generally not smooth there. */
+        std::vector<REAL> breakpoints() const;
+
+        /* Evaluation; arrays are REAL or COMPLEX according to dom_real() and ran_real(). */
+        COMPLEX operator()(COMPLEX const z) const;
+        void operator()(void const *RESTRICT z, void *RESTRICT result, size_t const n) const;
+        /* Array evaluation at the precision F, float or long double, with arrays of F or std::complex<F>. Elementwise
+         * operations run at that precision, except that the preset functions with kernels run in float through the
+         * double kernels; constants, conditions, opaque functions, derivatives, paths and interpolants are computed
+         * in double precision, and compiled code is not used. */
+        template<typename F> void evaluate(void const *RESTRICT z, void *RESTRICT result, size_t const n) const;
+
+        /* Differentiation, exact up to rounding by propagating Taylor series through the tape; x is the series of the
+         * argument in a real step h, and the result holds the coefficients of the function's series in h, up to the
+         * same order. Opaque functions have no derivative rule, so differentiable() must hold. */
+        bool differentiable() const noexcept;
+        std::vector<COMPLEX> taylor(std::vector<COMPLEX> const &x) const;
+        COMPLEX derivative(COMPLEX const z, size_t const order) const;
+
+        /* Construction */
+        static ptr Variable(bool const dom_real, bool const ran_real);
+        static ptr Constant(bool const dom_real, COMPLEX const c, bool const ran_real);
+        static ptr Preset(OPCODE const op, bool const dom_real, bool const ran_real);
+        static ptr Wrap(Opaque const &f, bool const dom_real, bool const ran_real);
+        static ptr If(Branch const &branch);
+        static ptr Unary(OPCODE const op, Tape const &x);
+        static ptr Binary(OPCODE const op, Tape const &lhs, Tape const &rhs);
+        static ptr WithConst(OPCODE const op, Tape const &x, COMPLEX const c);
+        static ptr Compose(Tape const &lhs, Tape const &rhs);
+        static ptr Differentiate(ptr const &f, size_t const order);
+        static ptr Trace(std::shared_ptr<Path const> const &path);
+        static ptr Approximation(std::shared_ptr<Chebyshev const> const &chebyshev, bool const ran_real);
+
+        void run_instruction(uint32_t const i, void const *RESTRICT x, void const *RESTRICT y, void *RESTRICT out, size_t const n) const;
+
+        /* Bytes held by the tape and what it refers to, counting anything already in seen as held elsewhere. */
+        size_t memory(std::unordered_set<void const *> &seen) const;
+
+    private:
+        friend class Expr;
+
+        uint32_t push(Instruction const &instr);
+        uint32_t append(Tape const &other, uint32_t const var);
+        ptr finalize();
+
+        /* With nodes, every instruction is timed into nodes[i], for profiling. */
+        void run_block(double *RESTRICT regs, size_t const n, Profile::Node *RESTRICT nodes) const;
+        template<typename F> void run_block(F *RESTRICT regs, COMPLEX *RESTRICT wide, size_t const n, Profile::Node *RESTRICT nodes) const;
+    };
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "Definitions.h"
+
+namespace libcalculus {
+    /* A persistent pool of NUM_THREADS - 1 threads which, together with the calling thread, run loops by work stealing.
+     * Every thread keeps a deque of index ranges: it runs its own ranges newest first, and when it has none left it
+     * takes the oldest - and so largest - range of another thread. A thread splits the range it runs in half only when
+     * its deque is empty, so ranges are split just as often as threads run out of work, and loops whose cost varies
+     * across the indices stay balanced. Loops started from inside a loop run on the same threads. */
+    class ThreadPool {
+    public:
+        static ThreadPool &instance();
+        ~ThreadPool();
+
+        /* Runs body(begin, end) over ranges of at most grain indices covering [0, n), and returns when all are done.
+         * The first exception body throws is rethrown, and the ranges that have not started by then are skipped. */
+        template<typename Body>
+        void parallel_for(size_t const n, size_t const grain, Body const &body) {
+            if (n == 0) return;
+            Job job{[](void const *body, size_t const begin, size_t const end) { (*static_cast<Body const *>(body))(begin, end); },
+                    &body, grain == 0 ? 1 : grain, n};
+            if (n <= job.grain || !this->run(job)) {
+                for (size_t begin = 0; begin < n; begin += job.grain) body(begin, std::min(begin + job.grain, n));
+            } else if (job.error) std::rethrow_exception(job.error);
+        }
+
+        /* The number of threads loops run on, the calling one included, and its change; it waits for running loops. */
+        size_t size() const noexcept;
+        void resize(size_t const threads);
+
+        /* Whether each thread of the pool is bound to a CPU of its own, where the platform supports it. */
+        bool pinned() const noexcept;
+        void pin(bool const flag);
+
+    private:
+        struct Job {
+            void (*call)(void const *body, size_t const begin, size_t const end);
+            void const *body;
+            size_t grain;
+            std::atomic<size_t> remaining; // Indices not done yet; the loop is over when it reaches 0.
+            std::atomic<bool> failed = false;
+            std::exception_ptr error = nullptr;
+            std::mutex error_mutex{};
+        };
+        struct Range {
+            Job *job;
+            size_t begin, end;
+        };
+        struct alignas(64) Queue {
+            std::mutex mutex;
+            std::deque<Range> ranges;
+            std::atomic<size_t> size = 0;
+        };
+
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<Queue>> queues; // One per worker, and a last one shared by outside threads.
+        std::shared_mutex resize_mutex; // Held shared by running loops, and exclusively by resize().
+        std::mutex sleep_mutex;
+        std::condition_variable wake;
+        std::atomic<size_t> queued = 0, sleeping = 0;
+        bool stopping = false, pinned_ = false;
+
+        ThreadPool();
+        bool run(Job &job);
+        void start(size_t const threads);
+        void stop();
+        void work(size_t const index);
+        void execute(Range range, size_t const self);
+        void call(Job &job, size_t const begin, size_t const end);
+        void push(Queue &queue, Range const &range);
+        bool find(size_t const self, Range &range);
+        void apply_pinning(size_t const index);
+    };
+}
@@ -0,0 +1,13 @@
+from Definitions cimport *
+
+cdef extern from "ThreadPool.cpp" nogil:
+  pass
+
+cdef extern from "ThreadPool.h" namespace "libcalculus" nogil:
+  cdef cppclass ThreadPool:
+    @staticmethod
+    ThreadPool &instance() except +
+    size_t size()
+    void resize(size_t threads) except +
+    cbool pinned()
+    void pin(cbool flag) except +
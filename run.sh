@@ -5,10 +5,12 @@ shopt -s extglob
 release=0
 SETUP_SCRIPT='./setup.py'
 TEST_SCRIPT='test.py'
+BENCH_SCRIPT='bench.py'
+BENCH_SOURCE='bench.cpp'
 
 function clean {
   echo $'\e[92mCleaning.\e[0m'
-  rm -vrf src/libcalculus.cpp src/*.html build dist/* annotations __pycache__ libcalculus.egg-info docs/{html,doctrees}
+  rm -vrf src/libcalculus.cpp src/*.html build dist/* annotations __pycache__ libcalculus.egg-info docs/{html,doctrees} bench_cpp bench_results.json
   echo
 }
 
@@ -40,13 +42,21 @@ function bdist_wheel {
 
 function run_tests {
   echo $'\e[92mTesting.\e[0m'
-  python3 "$TEST_SCRIPT" --ComplexFunction --RealFunction --Contour --Function
+  python3 "$TEST_SCRIPT" --ComplexFunction --RealFunction --Contour --Function --Kernel --Array --Rewrite --Derivative --Coefficient --Quadrature --Root --Comparison --Deduplication --Memory --Profile --Compile --Output --Grid --Stream --Precision --Serial
+  echo
+}
+
+function run_bench {
+  echo $'\e[92mBenchmarking.\e[0m'
+  g++ -std=c++2a -O3 -fno-math-errno -fno-trapping-math -fopenmp -I./include -I./src $CXXFLAGS "$BENCH_SOURCE" -o bench_cpp -ldl
+  python3 "$BENCH_SCRIPT" --cpp ./bench_cpp
   echo
 }
 
 function display_help {
   echo -e "Usage: $0 [option] ... command [command] ...\nCommands:"
   echo $'bdist_wheel\t: Build the extension and create a python wheel (.whl) file in the dist/ directory.'
+  echo $'bench\t: Run the benchmarks and compare them with bench_baseline.json, if it exists (applicable after the extension has been built).'
   echo $'build\t: Build the extension in-place (will output an .so in the current directory).'
   echo $'clean\t: Clean all previous builds and leftovers.'
   echo $'sdist\t: Create a source distribution (.tar.gz) in the dist/ directory.'
@@ -85,6 +95,8 @@ else
       build
     elif [[ $1 == 'test' ]]; then
       run_tests
+    elif [[ $1 == 'bench' ]]; then
+      run_bench
     else
       echo "Unknown parameter: \"$1\""; exit 1
     fi
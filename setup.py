@@ -12,10 +12,10 @@ if sys.platform == "linux":
     os.environ["CC"] = os.environ.get("CC", "g++")
     os.environ["CXX"] = os.environ.get("CXX", "g++")
     os.environ["LDSHARED"] = os.environ.get("LDSHARED", "g++ -shared")
-    COMPILER_ARGS = ["-DNPY_NO_DEPRECATED_API", "-std=c++2a", "-O3", "-lstdc++", "-fopenmp", "-static-libstdc++", "-static-libgcc"] + \
+    COMPILER_ARGS = ["-DNPY_NO_DEPRECATED_API", "-std=c++2a", "-O3", "-fno-math-errno", "-fno-trapping-math", "-lstdc++", "-fopenmp", "-static-libstdc++", "-static-libgcc"] + \
                     os.environ.get("CFLAGS", "").split() + os.environ.get("CXXFLAGS", "").split()
     LIBRARY_DIRS = []
-    LINKER_ARGS = ["-fopenmp", "-lstdc++", "-static-libstdc++", "-static-libgcc"] + \
+    LINKER_ARGS = ["-fopenmp", "-lstdc++", "-static-libstdc++", "-static-libgcc", "-ldl"] + \
                   os.environ.get("LDFLAGS", "").split()
 elif sys.platform == "win32":
     COMPILER_ARGS = ["/std:c++20", "/DNPY_NO_DEPRECATED_API", "/O2", "/MT"] + \
@@ -53,4 +53,4 @@ project_urls = {"Documentation": "https://libcalculus.readthedocs.io/en/latest/"
                 "Source Code": "https://gitlab.com/ariter777/libcalculus"},
 ext_modules=cythonize(Extension("libcalculus", SOURCES,
                                 extra_compile_args=COMPILER_ARGS, extra_link_args=LINKER_ARGS, library_dirs=LIBRARY_DIRS, include_dirs=INCLUDE_DIRS),
-                      language_level=3, nthreads=4, annotate=False, compiler_directives={"embedsignature": True}))
+                      language_level=3, nthreads=4, annotate=False, compiler_directives={"embedsignature": True, "c_api_binop_methods": True}))
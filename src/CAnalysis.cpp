@@ -1,9 +1,329 @@
 #include "CAnalysis.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
 
 namespace libcalculus {
+    static Latex::Text::ptr derivative_latex(Latex::Text::ptr const &latex, size_t const order) {
+        std::string const power = order == 1 ? "" : ("^{" + std::to_string(order) + "}");
+        return Latex::join({"\\frac{\\text{d}" + power + "}{\\text{d}" LATEX_VAR + power + "}\\left(", latex, "\\right)"});
+    }
+
+    /* The derivative of an interpolant, another one of the same pieces, printed as that of the function it stands for. */
+    static std::shared_ptr<Tape::Chebyshev const> derivative_chebyshev(Tape::Chebyshev const &chebyshev, size_t const order) {
+        auto result = std::make_shared<Tape::Chebyshev>(chebyshev);
+        for (size_t k = 0; k < order; ++k) *result = result->derivative();
+        result->latex = derivative_latex(chebyshev.latex, order);
+        return result;
+    }
+
+    /* Symbolic differentiation: the tape of a function is rebuilt instruction by instruction into function objects, and
+     * the derivative of each instruction follows from those of its operands by the chain, product and quotient rules.
+     * Instructions of real kind are rebuilt as functions to REAL, and the others as functions to COMPLEX; the results
+     * are ordinary functions, simplified as they are built. Derivatives in the complex plane are taken along the real
+     * axis, as with the numeric scheme. Without with_derivatives, the derivatives are left out, and opaque functions are
+     * rebuilt as they are; the profiler labels the instructions of a tape this way. */
+    template<typename Dom>
+    class Differentiator {
+        template<typename T> using F = CFunction<Dom, T>;
+        std::vector<F<REAL>> real_values, real_derivatives;
+        std::vector<F<COMPLEX>> complex_values, complex_derivatives;
+        uint32_t root;
+        bool with_derivatives;
+
+        template<typename T> inline std::vector<F<T>> &values() {
+            if constexpr (is_real<T>) return this->real_values;
+            else return this->complex_values;
+        }
+        template<typename T> inline std::vector<F<T>> &derivatives() {
+            if constexpr (is_real<T>) return this->real_derivatives;
+            else return this->complex_derivatives;
+        }
+
+        template<typename Dom_, typename T>
+        static inline CFunction<Dom_, COMPLEX> widen(CFunction<Dom_, T> const &f) {
+            if constexpr (is_real<T>) {
+                if (f._is_constant()) return CFunction<Dom_, COMPLEX>::Constant(f._constant());
+                return CFunction<Dom_, COMPLEX>(Expr::Unary(OPCODE::WIDEN, f._expr), f._latex, f._last_op);
+            }
+            else return f;
+        }
+
+        template<typename T>
+        static CFunction<T, T> preset(OPCODE const op) {
+            using P = CFunction<T, T>;
+            switch (op) {
+                case OPCODE::RE: return P::Re();
+                case OPCODE::IM: return P::Im();
+                case OPCODE::CONJ: return P::Conj();
+                case OPCODE::ABS: return P::Abs();
+                case OPCODE::ARG: return P::Arg();
+                case OPCODE::EXP: return P::Exp();
+                case OPCODE::LN: return P::Ln();
+                case OPCODE::SIN: return P::Sin();
+                case OPCODE::COS: return P::Cos();
+                case OPCODE::TAN: return P::Tan();
+                case OPCODE::SEC: return P::Sec();
+                case OPCODE::CSC: return P::Csc();
+                case OPCODE::COT: return P::Cot();
+                case OPCODE::SINH: return P::Sinh();
+                case OPCODE::COSH: return P::Cosh();
+                case OPCODE::TANH: return P::Tanh();
+                case OPCODE::SECH: return P::Sech();
+                case OPCODE::CSCH: return P::Csch();
+                case OPCODE::COTH: return P::Coth();
+                case OPCODE::ARCSIN: return P::Arcsin();
+                case OPCODE::ARCCOS: return P::Arccos();
+                case OPCODE::ARCTAN: return P::Arctan();
+                case OPCODE::ARCCSC: return P::Arccsc();
+                case OPCODE::ARCSEC: return P::Arcsec();
+                case OPCODE::ARCCOT: return P::Arccot();
+                case OPCODE::ARSINH: return P::Arsinh();
+                case OPCODE::ARCOSH: return P::Arcosh();
+                case OPCODE::ARTANH: return P::Artanh();
+                case OPCODE::ARCSCH: return P::Arcsch();
+                case OPCODE::ARSECH: return P::Arsech();
+                case OPCODE::ARCOTH: return P::Arcoth();
+                default: throw std::logic_error("not a preset function");
+            }
+        }
+
+        /* The derivative of a preset applied to u, given u, its derivative du and the preset's value w. */
+        template<typename T>
+        static F<T> rule(OPCODE const op, F<T> const &u, F<T> const &du, F<T> const &w) {
+            auto const of = [&](OPCODE const p) { return preset<T>(p).compose(u); };
+            T const one = 1.;
+            switch (op) {
+                case OPCODE::RE: case OPCODE::CONJ:
+                    if constexpr (is_real<T>) return du;
+                    else return preset<T>(op).compose(du);
+                case OPCODE::IM:
+                    if constexpr (is_real<T>) return F<T>::Constant(0.);
+                    else return preset<T>(op).compose(du);
+                case OPCODE::ABS:
+                    if constexpr (is_real<T>) return du * u / w;
+                    else return preset<T>(OPCODE::RE).compose(preset<T>(OPCODE::CONJ).compose(u) * du) / w;
+                case OPCODE::ARG:
+                    if constexpr (is_real<T>) return F<T>::Constant(0.);
+                    else return preset<T>(OPCODE::IM).compose(du / u);
+                case OPCODE::EXP: return w * du;
+                case OPCODE::LN: return du / u;
+                case OPCODE::SIN: return of(OPCODE::COS) * du;
+                case OPCODE::COS: return -of(OPCODE::SIN) * du;
+                case OPCODE::TAN: return of(OPCODE::SEC).pow(2) * du;
+                case OPCODE::SEC: return w * of(OPCODE::TAN) * du;
+                case OPCODE::CSC: return -(w * of(OPCODE::COT)) * du;
+                case OPCODE::COT: return -of(OPCODE::CSC).pow(2) * du;
+                case OPCODE::SINH: return of(OPCODE::COSH) * du;
+                case OPCODE::COSH: return of(OPCODE::SINH) * du;
+                case OPCODE::TANH: return of(OPCODE::SECH).pow(2) * du;
+                case OPCODE::SECH: return -(w * of(OPCODE::TANH)) * du;
+                case OPCODE::CSCH: return -(w * of(OPCODE::COTH)) * du;
+                case OPCODE::COTH: return -of(OPCODE::CSCH).pow(2) * du;
+                case OPCODE::ARCSIN: return du / (one - u.pow(2)).pow(.5);
+                case OPCODE::ARCCOS: return -du / (one - u.pow(2)).pow(.5);
+                case OPCODE::ARCTAN: return du / (u.pow(2) + one);
+                case OPCODE::ARCCSC: return -du / (u.pow(2) * (one - u.pow(-2)).pow(.5));
+                case OPCODE::ARCSEC: return du / (u.pow(2) * (one - u.pow(-2)).pow(.5));
+                case OPCODE::ARCCOT: return -du / (u.pow(2) + one);
+                case OPCODE::ARSINH: return du / (u.pow(2) + one).pow(.5);
+                case OPCODE::ARCOSH: return du / ((u - one).pow(.5) * (u + one).pow(.5));
+                case OPCODE::ARTANH: case OPCODE::ARCOTH: return du / (one - u.pow(2));
+                case OPCODE::ARCSCH: return -du / (u.pow(2) * (u.pow(-2) + one).pow(.5));
+                case OPCODE::ARSECH: return -du / (u.pow(2) * (u.pow(-1) - one).pow(.5) * (u.pow(-1) + one).pow(.5));
+                default: throw std::logic_error("not a preset function");
+            }
+        }
+
+        /* Cases and derivative nodes apply another tape, with domain ADom, to their operand. */
+        template<typename T, typename ADom>
+        void apply(uint32_t const i, Instruction const &instr, Tape const &tape) {
+            if constexpr ((is_real<T> && !is_real<ADom>) || (!is_real<Dom> && is_real<ADom>)) {
+                throw std::logic_error("instruction operand of the wrong kind");
+            } else {
+                F<ADom> const &u = this->values<ADom>()[instr.a], &du = this->derivatives<ADom>()[instr.a];
+                CFunction<ADom, T> f, df;
+                if (instr.op == OPCODE::IF) {
+                    Tape::Branch const &branch = *tape.branches[instr.aux];
+                    Differentiator<ADom> const then_(*branch.then_, this->with_derivatives), else_(*branch.else_, this->with_derivatives);
+                    CComparison<ADom> const cond([cond = branch.cond](ADom const z) { return cond(z); },
+                                                 [cond = branch.cond_array](ADom const *RESTRICT z, uint64_t *RESTRICT mask, size_t const n) { cond(z, mask, n); },
+                                                 branch.latex, branch.condition);
+                    f = CFunction<ADom, T>::If(cond, then_.template value<T>(), else_.template value<T>());
+                    df = CFunction<ADom, T>::If(cond, then_.template derivative<T>(), else_.template derivative<T>());
+                } else {
+                    // Derivative nodes stay exact Taylor-mode derivatives; their derivative is the one of the next order.
+                    Tape::Diff const &diff = *tape.diffs[instr.aux];
+                    Latex::Text::ptr const latex = Differentiator<ADom>(*diff.f, false).template value<T>()._latex;
+                    f = CFunction<ADom, T>(Tape::Differentiate(diff.f, diff.order), derivative_latex(latex, diff.order), OP_TYPE::FUNC);
+                    df = CFunction<ADom, T>(Tape::Differentiate(diff.f, diff.order + 1), derivative_latex(latex, diff.order + 1), OP_TYPE::FUNC);
+                }
+                this->values<T>()[i] = f.compose(u);
+                if (!this->with_derivatives) return;
+                if constexpr (is_real<ADom> && !is_real<T>) this->derivatives<T>()[i] = df.compose(u) * widen(du);
+                else this->derivatives<T>()[i] = df.compose(u) * du;
+            }
+        }
+
+        template<typename T, typename ADom>
+        void wrap(uint32_t const i, Instruction const &instr, Tape const &tape) {
+            if constexpr ((is_real<T> && !is_real<ADom>) || (!is_real<Dom> && is_real<ADom>)) {
+                throw std::logic_error("instruction operand of the wrong kind");
+            } else {
+                CFunction<ADom, T> const f(Expr::Leaf(Tape::Wrap(*tape.opaques[instr.aux], is_real<ADom>, is_real<T>)),
+                                           Latex::Text::Literal("f\\left(" LATEX_VAR "\\right)"), OP_TYPE::FUNC);
+                this->values<T>()[i] = f.compose(this->values<ADom>()[instr.a]);
+            }
+        }
+
+        template<typename T>
+        void step(uint32_t const i, Instruction const &instr, Tape const &tape) {
+            std::vector<F<T>> &values = this->values<T>(), &derivatives = this->derivatives<T>();
+            if (instr.op == OPCODE::CONST) {
+                values[i] = F<T>::Constant(from_complex<T>(instr.c));
+                derivatives[i] = F<T>::Constant(0.);
+                return;
+            }
+            if (instr.op == OPCODE::WIDEN) {
+                if constexpr (!is_real<T>) {
+                    values[i] = widen(this->real_values[instr.a]);
+                    derivatives[i] = widen(this->real_derivatives[instr.a]);
+                }
+                return;
+            }
+            if (instr.op == OPCODE::IF || instr.op == OPCODE::DERIVATIVE) {
+                bool const operand_real = instr.op == OPCODE::IF ? tape.branches[instr.aux]->then_->dom_real() : tape.diffs[instr.aux]->f->dom_real();
+                if (operand_real) this->apply<T, REAL>(i, instr, tape);
+                else this->apply<T, COMPLEX>(i, instr, tape);
+                return;
+            }
+            if (instr.op == OPCODE::PATH) {
+                // The derivative of a path is another path, applied to the same parameter.
+                if constexpr (is_real<Dom> && !is_real<T>) {
+                    std::shared_ptr<Tape::Path const> const &path = tape.paths[instr.aux];
+                    values[i] = F<T>::Trace(path).compose(this->real_values[instr.a]);
+                    derivatives[i] = F<T>::Trace(std::make_shared<Tape::Path const>(path->derivative())).compose(this->real_values[instr.a])
+                                     * widen(this->real_derivatives[instr.a]);
+                } else {
+                    throw std::logic_error("instruction operand of the wrong kind");
+                }
+                return;
+            }
+            if (instr.op == OPCODE::CHEBYSHEV) {
+                if constexpr (is_real<Dom>) {
+                    std::shared_ptr<Tape::Chebyshev const> const &chebyshev = tape.chebyshevs[instr.aux];
+                    F<REAL> const &u = this->real_values[instr.a], &du = this->real_derivatives[instr.a];
+                    // Nothing is known of how the function it stands for was last built, so it is parenthesized as a sum.
+                    values[i] = F<T>::Approximation(chebyshev, OP_TYPE::ADD).compose(u);
+                    F<T> const df = F<T>::Approximation(derivative_chebyshev(*chebyshev, 1), OP_TYPE::FUNC).compose(u);
+                    if constexpr (is_real<T>) derivatives[i] = df * du;
+                    else derivatives[i] = df * widen(du);
+                } else {
+                    throw std::logic_error("instruction operand of the wrong kind");
+                }
+                return;
+            }
+            if (instr.op == OPCODE::OPAQUE) {
+                if (this->with_derivatives) throw std::invalid_argument("opaque functions cannot be differentiated symbolically");
+                if (tape.code[instr.a].real) this->wrap<T, REAL>(i, instr, tape);
+                else this->wrap<T, COMPLEX>(i, instr, tape);
+                return;
+            }
+
+            F<T> const &u = values[instr.a], &du = derivatives[instr.a];
+            F<T> const &v = values[instr.b], &dv = derivatives[instr.b];
+            T const c = from_complex<T>(instr.c);
+            F<T> &w = values[i], &dw = derivatives[i];
+            switch (instr.op) {
+                case OPCODE::ADD: w = u + v; dw = du + dv; break;
+                case OPCODE::SUB: w = u - v; dw = du - dv; break;
+                case OPCODE::MUL: w = u * v; dw = du * v + u * dv; break;
+                case OPCODE::DIV: w = u / v; dw = (du - w * dv) / v; break;
+                case OPCODE::POW: w = u.pow(v); dw = w * (dv * preset<T>(OPCODE::LN).compose(u) + v * du / u); break;
+                case OPCODE::ADDC: w = u + c; dw = du; break;
+                case OPCODE::SUBC: w = u - c; dw = du; break;
+                case OPCODE::CSUB: w = c - u; dw = -du; break;
+                case OPCODE::MULC: w = u * c; dw = du * c; break;
+                case OPCODE::DIVC: w = u / c; dw = du / c; break;
+                case OPCODE::CDIV: w = c / u; dw = -(w * du) / u; break;
+                case OPCODE::POWC: w = u.pow(c); dw = u.pow(c - T{1}) * c * du; break;
+                case OPCODE::CPOW: w = u.lpow(c); dw = w * du * std::log(c); break;
+                case OPCODE::NEG: w = -u; dw = -du; break;
+                default: w = preset<T>(instr.op).compose(u); dw = rule<T>(instr.op, u, du, w);
+            }
+        }
+
+    public:
+        Differentiator(Tape const &tape, bool const with_derivatives = true) : root{tape.root}, with_derivatives{with_derivatives} {
+            size_t const n = tape.code.size();
+            if (tape.dom_real()) {
+                this->real_values.resize(n);
+                this->real_derivatives.resize(n);
+            }
+            this->complex_values.resize(n);
+            this->complex_derivatives.resize(n);
+            this->values<Dom>()[0] = F<Dom>();
+            this->derivatives<Dom>()[0] = F<Dom>::Constant(1.);
+            for (uint32_t i = 1; i < n; ++i) {
+                Instruction const &instr = tape.code[i];
+                if constexpr (is_real<Dom>) {
+                    if (instr.real) {
+                        this->step<REAL>(i, instr, tape);
+                        continue;
+                    }
+                }
+                this->step<COMPLEX>(i, instr, tape);
+            }
+        }
+
+        /* The function the tape computes, and its derivative. */
+        template<typename T> inline F<T> value() const {
+            if constexpr (is_real<T>) return this->real_values[this->root];
+            else return this->complex_values[this->root];
+        }
+        template<typename T> inline F<T> derivative() const {
+            if constexpr (is_real<T>) return this->real_derivatives[this->root];
+            else return this->complex_derivatives[this->root];
+        }
+
+        template<typename Ran>
+        static F<Ran> differentiate(F<Ran> const &f, size_t const order) {
+            F<Ran> result = f;
+            for (size_t k = 0; k < order; ++k) result = Differentiator(*result._tape()).template derivative<Ran>();
+            return result;
+        }
+
+        template<typename Ran>
+        static std::vector<ProfiledNode> profile(F<Ran> const &f, std::string const &varname) {
+            Tape const &tape = *f._tape();
+            Differentiator const rebuilt(tape, false);
+            std::vector<Profile::Node> const nodes = Profile::nodes(tape);
+            std::vector<ProfiledNode> result;
+            for (uint32_t i = 1; i < tape.code.size(); ++i) {
+                Instruction const &instr = tape.code[i];
+                Latex::Text::ptr const &latex = instr.real ? rebuilt.real_values[i]._latex : rebuilt.complex_values[i]._latex;
+                std::vector<uint32_t> operands;
+                if (has_operand(instr.op)) operands.push_back(instr.a);
+                if (is_binary(instr.op)) operands.push_back(instr.b);
+                result.push_back({i, Profile::name(instr.op), Latex::with_var(latex->render(), varname), std::move(operands), nodes[i]});
+            }
+            return result;
+        }
+    };
+
+    template<typename Dom, typename Ran>
+    std::vector<ProfiledNode> Profiled(CFunction<Dom, Ran> const &f, std::string const &varname) {
+        return Differentiator<Dom>::profile(f, varname);
+    }
+
     template<>
-    CFunction<COMPLEX, COMPLEX> Derivative(CFunction<COMPLEX, COMPLEX> const &f, size_t const order, REAL const tol, REAL const radius) {
-        auto df = f._f;
+    CFunction<COMPLEX, COMPLEX> Derivative(CFunction<COMPLEX, COMPLEX> const &f, size_t const order, REAL const tol, REAL const radius, bool const symbolic) {
+        Latex::Text::ptr const latex = derivative_latex(f._latex, order);
+        if (f._tape()->differentiable()) return symbolic ? Differentiator<COMPLEX>::differentiate(f, order)
+                                                     : CFunction<COMPLEX, COMPLEX>(Tape::Differentiate(f._tape(), order), latex, OP_TYPE::FUNC);
+
+        std::function<COMPLEX(COMPLEX)> df = f;
         for (size_t k = order; k > 0; --k) {
             df = [=](COMPLEX z) {
                 COMPLEX prev_result, result = 0.;
@@ -15,22 +335,21 @@ namespace libcalculus {
                     result = (df(z + dz) - df(z)) / dz;
                     ++while_iters;
                 }
+                if (Profile::enabled) Profile::record(Profile::Numeric{0, 0, 0, 0, 0., 1, while_iters, z + dz == z});
                 return result;
             };
         }
-        std::string latex = "\\frac{\\text{d}";
-        latex.append(order == 1 ? "" : ("^{" + std::to_string(order) + "}"));
-        latex.append("}{\\text{d}" LATEX_VAR);
-        latex.append(order == 1 ? "" : ("^{" + std::to_string(order) + "}"));
-        latex.append("}\\left(");
-        latex.append(f._latex);
-        latex.append("\\right)");
         return CFunction<COMPLEX, COMPLEX>(df, latex, OP_TYPE::FUNC);
     }
 
     template<>
-    CFunction<REAL, COMPLEX> Derivative(CFunction<REAL, COMPLEX> const &f, size_t const order, REAL const tol, REAL const radius) {
-        auto df = f._f;
+    CFunction<REAL, COMPLEX> Derivative(CFunction<REAL, COMPLEX> const &f, size_t const order, REAL const tol, REAL const radius, bool const symbolic) {
+        Latex::Text::ptr const latex = derivative_latex(f._latex, order);
+        if (std::shared_ptr<Tape::Chebyshev const> const chebyshev = f.chebyshev()) return CFunction<REAL, COMPLEX>::Approximation(derivative_chebyshev(*chebyshev, order), OP_TYPE::FUNC);
+        if (f._tape()->differentiable()) return symbolic ? Differentiator<REAL>::differentiate(f, order)
+                                                     : CFunction<REAL, COMPLEX>(Tape::Differentiate(f._tape(), order), latex, OP_TYPE::FUNC);
+
+        std::function<COMPLEX(REAL)> df = f;
         for (size_t k = order; k > 0; --k) {
             df = [=](REAL x) {
                 COMPLEX prev_result, result = 0.;
@@ -42,22 +361,21 @@ namespace libcalculus {
                     result = (df(x + dx) - df(x)) / dx;
                     ++while_iters;
                 }
+                if (Profile::enabled) Profile::record(Profile::Numeric{0, 0, 0, 0, 0., 1, while_iters, x + dx == x});
                 return result;
             };
         }
-        std::string latex = "\\frac{\\text{d}";
-        latex.append(order == 1 ? "" : ("^{" + std::to_string(order) + "}"));
-        latex.append("}{\\text{d}" LATEX_VAR);
-        latex.append(order == 1 ? "" : ("^{" + std::to_string(order) + "}"));
-        latex.append("}\\left(");
-        latex.append(f._latex);
-        latex.append("\\right)");
         return CFunction<REAL, COMPLEX>(df, latex, OP_TYPE::FUNC);
     }
 
     template<>
-    CFunction<REAL, REAL> Derivative(CFunction<REAL, REAL> const &f, size_t const order, REAL const tol, REAL const radius) {
-        auto df = f._f;
+    CFunction<REAL, REAL> Derivative(CFunction<REAL, REAL> const &f, size_t const order, REAL const tol, REAL const radius, bool const symbolic) {
+        Latex::Text::ptr const latex = derivative_latex(f._latex, order);
+        if (std::shared_ptr<Tape::Chebyshev const> const chebyshev = f.chebyshev()) return CFunction<REAL, REAL>::Approximation(derivative_chebyshev(*chebyshev, order), OP_TYPE::FUNC);
+        if (f._tape()->differentiable()) return symbolic ? Differentiator<REAL>::differentiate(f, order)
+                                                     : CFunction<REAL, REAL>(Tape::Differentiate(f._tape(), order), latex, OP_TYPE::FUNC);
+
+        std::function<REAL(REAL)> df = f;
         for (size_t k = order; k > 0; --k) {
             df = [=](REAL x) {
                 REAL prev_result, result = 0.;
@@ -69,43 +387,495 @@ namespace libcalculus {
                     result = (df(x + dx) - df(x)) / dx;
                     ++while_iters;
                 }
+                if (Profile::enabled) Profile::record(Profile::Numeric{0, 0, 0, 0, 0., 1, while_iters, x + dx == x});
                 return result;
             };
         }
-        std::string latex = "\\frac{\\text{d}";
-        latex.append(order == 1 ? "" : ("^{" + std::to_string(order) + "}"));
-        latex.append("}{\\text{d}" LATEX_VAR);
-        latex.append(order == 1 ? "" : ("^{" + std::to_string(order) + "}"));
-        latex.append("}\\left(");
-        latex.append(f._latex);
-        latex.append("\\right)");
         return CFunction<REAL, REAL>(df, latex, OP_TYPE::FUNC);
     }
 
+    /* Gauss-Kronrod rule with 15 points (QUADPACK's qk15): nodes on [-1, 1] from the outside in, and their Kronrod
+     * weights, at the precision F; the 7-point Gauss rule uses every other node, so both estimates come from the same
+     * evaluations. */
+    template<typename F>
+    static F constexpr KRONROD_NODES[8] = {0.991455371120812639206854697526329L, 0.949107912342758524526189684047851L,
+                                           0.864864423359769072789712788640926L, 0.741531185599394439863864773280788L,
+                                           0.586087235467691130294144845693013L, 0.405845151377397166906606412076961L,
+                                           0.207784955007898467600689403773245L, 0.L};
+    template<typename F>
+    static F constexpr KRONROD_WEIGHTS[8] = {0.022935322010529224963732008058970L, 0.063092092629978553290700663189204L,
+                                             0.104790010322250183839876322541518L, 0.140653259715525918745189590510238L,
+                                             0.169004726639267902826583426598550L, 0.190350578064785409913256402421014L,
+                                             0.204432940075298892414161999234649L, 0.209482141084727828012999174891714L};
+    template<typename F>
+    static F constexpr GAUSS_WEIGHTS[4] = {0.129484966168869693270611432679082L, 0.279705391489276667901467771423780L,
+                                           0.381830050505118944950369775488975L, 0.417959183673469387755102040816327L};
+    static size_t constexpr KRONROD_POINTS = 15;
+
+    /* Sum of get(x[i]) over i < n, added pairwise: the rounding error grows as log n rather than n. */
+    template<typename T, typename Get>
+    static auto pairwise_sum(T const *x, size_t const n, Get const &get) -> decltype(get(*x)) {
+        if (n <= 8) {
+            decltype(get(*x)) result = 0.;
+            for (size_t i = 0; i < n; ++i) result += get(x[i]);
+            return result;
+        }
+        return pairwise_sum(x, n / 2, get) + pairwise_sum(x + n / 2, n - n / 2, get);
+    }
+
+    /* Adaptive quadrature of g over [start, end]. Every pass evaluates g on all the new intervals at once, through
+     * the array path, and then bisects each interval whose error estimate |K15 - G7| exceeds its share of tol, until
+     * the estimates add up to less than tol or INTEGRATION_MAX_INTERVALS is reached. The points, values and sums are
+     * at the precision F. */
+    template<typename F, typename Ran>
+    static Integral<Ran> gauss_kronrod(CFunction<REAL, Ran> const &g, REAL const start, REAL const end, REAL const tol) {
+        using Value = at_precision<Ran, F>;
+        struct Piece {
+            F a, b;
+            Value value;
+            REAL error;
+        };
+        Integral<Ran> result;
+        if (start == end) return result;
+
+        // Intervals start between the breakpoints of contours of several pieces, where g is not smooth.
+        std::vector<Piece> pieces;
+        std::vector<std::pair<F, F>> pending;
+        std::vector<REAL> bounds{start};
+        for (REAL const t : g.breakpoints()) {
+            if (std::min(start, end) < t && t < std::max(start, end)) bounds.push_back(t);
+        }
+        if (start > end) std::reverse(bounds.begin() + 1, bounds.end());
+        bounds.push_back(end);
+        for (size_t k = 0; k + 1 < bounds.size(); ++k) pending.emplace_back(bounds[k], bounds[k + 1]);
+        std::vector<F> points;
+        std::vector<Value> values;
+        size_t passes = 0;
+        while (!pending.empty()) {
+            ++passes;
+            size_t const n = KRONROD_POINTS * pending.size();
+            points.resize(n);
+            values.resize(n);
+            for (size_t i = 0; i < pending.size(); ++i) {
+                F const center = .5 * (pending[i].first + pending[i].second), half = .5 * (pending[i].second - pending[i].first);
+                for (size_t j = 0; j < 7; ++j) {
+                    points[KRONROD_POINTS * i + 2 * j] = center - half * KRONROD_NODES<F>[j];
+                    points[KRONROD_POINTS * i + 2 * j + 1] = center + half * KRONROD_NODES<F>[j];
+                }
+                points[KRONROD_POINTS * i + 14] = center;
+            }
+            // The array path splits the points between the threads; each value depends only on its point, so the
+            // result is the same for any number of threads.
+            g(points.data(), values.data(), n);
+            result.evaluations += n;
+
+            for (size_t i = 0; i < pending.size(); ++i) {
+                Value const *v = values.data() + KRONROD_POINTS * i;
+                Value kronrod = KRONROD_WEIGHTS<F>[7] * v[14], gauss = GAUSS_WEIGHTS<F>[3] * v[14];
+                for (size_t j = 0; j < 7; ++j) {
+                    kronrod += KRONROD_WEIGHTS<F>[j] * (v[2 * j] + v[2 * j + 1]);
+                    if (j % 2 == 1) gauss += GAUSS_WEIGHTS<F>[j / 2] * (v[2 * j] + v[2 * j + 1]);
+                }
+                F const half = .5 * (pending[i].second - pending[i].first);
+                pieces.push_back({pending[i].first, pending[i].second, half * kronrod, static_cast<REAL>(std::abs(half * (kronrod - gauss)))});
+            }
+            pending.clear();
+
+            REAL error = 0.;
+            for (Piece const &piece : pieces) error += piece.error;
+            if (!(error > tol) || pieces.size() >= INTEGRATION_MAX_INTERVALS) break;
+            std::vector<Piece> kept;
+            for (Piece const &piece : pieces) {
+                F const mid = .5 * (piece.a + piece.b);
+                if (piece.error > tol * std::abs((piece.b - piece.a) / (end - start)) && mid != piece.a && mid != piece.b) {
+                    pending.emplace_back(piece.a, mid);
+                    pending.emplace_back(mid, piece.b);
+                } else {
+                    kept.push_back(piece);
+                }
+            }
+            pieces = std::move(kept);
+        }
+
+        // Summing pairwise in order along the interval fixes the rounding, whatever the order of refinement.
+        bool const forward = start < end;
+        std::sort(pieces.begin(), pieces.end(), [forward](Piece const &lhs, Piece const &rhs) { return forward ? lhs.a < rhs.a : lhs.a > rhs.a; });
+        result.value = static_cast<Ran>(pairwise_sum(pieces.data(), pieces.size(), [](Piece const &piece) { return piece.value; }));
+        result.error = pairwise_sum(pieces.data(), pieces.size(), [](Piece const &piece) { return piece.error; });
+        if (Profile::enabled) Profile::record(Profile::Numeric{1, passes, result.evaluations, pieces.size(), result.error});
+        return result;
+    }
+
+    template<typename Ran>
+    static Integral<Ran> gauss_kronrod(CFunction<REAL, Ran> const &g, REAL const start, REAL const end, REAL const tol, bool const extended) {
+        // An interpolant is integrated exactly from its antiderivative, without evaluating it; the error is that of the
+        // interpolant itself.
+        if (std::shared_ptr<Tape::Chebyshev const> const chebyshev = g.chebyshev()) {
+            Tape::Chebyshev const antiderivative = chebyshev->antiderivative();
+            Integral<Ran> const result{from_complex<Ran>(antiderivative(end) - antiderivative(start)), chebyshev->error * std::abs(end - start), 0};
+            if (Profile::enabled) Profile::record(Profile::Numeric{1, 0, 0, 0, result.error});
+            return result;
+        }
+        return extended ? gauss_kronrod<long double>(g, start, end, tol) : gauss_kronrod<REAL>(g, start, end, tol);
+    }
+
     template<>
-    COMPLEX Integrate(CFunction<COMPLEX, COMPLEX> const &f,
-                      CFunction<REAL, COMPLEX> const &contour, REAL const start, REAL const end, REAL const tol) {
-         COMPLEX prev_result, result = 0.;
-         size_t while_iters = 0, n = INTEGRATION_SUBDIV_FACTOR / tol;
-         while (while_iters < 2 || !Traits<COMPLEX>::close(prev_result, result, tol)) {
-             n *= 2;
-             prev_result = result;
-             result = 0.;
-             COMPLEX z, prev_z = contour(start);
-
-             for (size_t k = 1; k <= n; ++k) {
-                 z = contour(start + (end - start) * k / n);
-                 result += f(z) * (z - prev_z);
-                 prev_z = z;
-             }
-             ++while_iters;
-         }
-         return result;
+    Integral<COMPLEX> Integrate(CFunction<COMPLEX, COMPLEX> const &f, CFunction<REAL, COMPLEX> const &contour, REAL const start,
+                                REAL const end, REAL const tol, bool const extended) {
+        // The integrand in the contour's parameter is f(z(t)) z'(t).
+        return gauss_kronrod(f.compose(contour) * Derivative(contour, 1, tol, 1., true), start, end, tol, extended);
     }
 
     template<>
-    REAL Integrate(CFunction<REAL, REAL> const &f, CFunction<REAL, REAL> const &contour, REAL const start, REAL const end, REAL const tol) {
-        auto const reverse = start > end;
-        return (reverse ? -1. : 1.) * boost::math::quadrature::gauss_kronrod<REAL, 61>::integrate(f, contour(reverse ? end : start), contour(reverse ? start : end), 15, tol);
+    Integral<REAL> Integrate(CFunction<REAL, REAL> const &f, CFunction<REAL, REAL> const &contour, REAL const start, REAL const end,
+                             REAL const tol, bool const extended) {
+        return gauss_kronrod(f.compose(contour) * Derivative(contour, 1, tol, 1., true), start, end, tol, extended);
+    }
+
+    Integral<REAL> Length(CFunction<REAL, COMPLEX> const &contour, REAL const start, REAL const end, REAL const tol) {
+        if (std::shared_ptr<Tape::Path const> const path = contour.path()) return {path->length(start, end), 0., 0};
+        Integral<COMPLEX> const length = gauss_kronrod<REAL>(CFunction<COMPLEX, COMPLEX>::Abs().compose(Derivative(contour, 1, tol, 1., true)), start, end, tol);
+        return {std::abs(std::real(length.value)), length.error, length.evaluations};
+    }
+
+    template<typename Dom, typename Ran, typename ContDom>
+    void IntegrateMany(CFunction<Dom, Ran> const *fs, CFunction<ContDom, Dom> const *contours, ContDom const *starts,
+                       ContDom const *ends, size_t const n, REAL const tol, bool const extended, Integral<Ran> *results) {
+        // Integrals are scheduled one at a time, and those of many points evaluate them on whichever threads are idle;
+        // as each one is independent of the scheduling, so are the results.
+        ThreadPool::instance().parallel_for(n, 1, [&](size_t const begin, size_t const end) {
+            for (size_t i = begin; i < end; ++i) results[i] = Integrate(fs[i], contours[i], starts[i], ends[i], tol, extended);
+        });
+    }
+
+    /* In-place radix-2 FFT, F_m = sum_j x_j e^(-2 pi i j m / n), given the twiddle factors e^(-2 pi i k / n) for k < n / 2. */
+    static void fft(COMPLEX *x, size_t const n, COMPLEX const *twiddles) {
+        for (size_t i = 1, j = 0; i < n; ++i) {
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) j ^= bit;
+            j ^= bit;
+            if (i < j) std::swap(x[i], x[j]);
+        }
+        for (size_t len = 2; len <= n; len <<= 1) {
+            size_t const stride = n / len;
+            for (size_t start = 0; start < n; start += len) {
+                for (size_t k = 0; k < len / 2; ++k) {
+                    COMPLEX const u = x[start + k], v = x[start + k + len / 2] * twiddles[k * stride];
+                    x[start + k] = u + v;
+                    x[start + k + len / 2] = u - v;
+                }
+            }
+        }
+    }
+
+    void Coefficients(CFunction<COMPLEX, COMPLEX> const &f, COMPLEX const *centers, size_t const n_centers, REAL const radius,
+                      size_t const n, bool const laurent, COMPLEX *coeffs, REAL *errors) {
+        if (n < 8 || (n & (n - 1)) != 0) throw std::invalid_argument("the number of samples must be a power of two, at least 8");
+        std::vector<COMPLEX> roots(n), twiddles(n / 2);
+        for (size_t j = 0; j < n; ++j) roots[j] = std::polar(radius, 2. * M_PI * j / n);
+        for (size_t k = 0; k < n / 2; ++k) twiddles[k] = std::conj(roots[k]) / radius;
+
+        ThreadPool::instance().parallel_for(n_centers, 1, [&](size_t const c, size_t) {
+            std::vector<COMPLEX> points(n), samples(n);
+            for (size_t j = 0; j < n; ++j) points[j] = centers[c] + roots[j];
+            f(points.data(), samples.data(), n);
+            fft(samples.data(), n, twiddles.data());
+
+            // Coefficient k is F_(k mod n) / (n r^k); the coefficients of highest order left, which should have decayed
+            // for the series to converge, estimate the error of r^k a_k.
+            REAL tail = 0., peak = 0.;
+            for (size_t j = 0; j < n; ++j) {
+                long const k = laurent ? static_cast<long>(j) - static_cast<long>(n / 2) : static_cast<long>(j);
+                COMPLEX const scaled = samples[(k + static_cast<long>(n)) % n] / static_cast<REAL>(n);
+                coeffs[c * n + j] = scaled / std::pow(radius, static_cast<REAL>(k));
+                peak = std::max(peak, std::abs(scaled));
+                if (laurent ? j < n / 8 || j >= n - n / 8 : j >= n - n / 8) tail = std::max(tail, std::abs(scaled));
+            }
+            errors[c] = tail + peak * n * std::numeric_limits<REAL>::epsilon();
+        });
+    }
+
+    /* Root finding: rectangles with more roots than ROOTS_PER_REGION are split into four, up to ROOTS_MAX_DEPTH times;
+     * counts only need to round to the right integer, so they are integrated to ROOTS_COUNT_TOL. */
+    static size_t constexpr ROOTS_PER_REGION = 4, ROOTS_MAX_DEPTH = 24;
+    static REAL constexpr ROOTS_COUNT_TOL = 1e-2;
+
+    struct Region {
+        COMPLEX lo, hi; // Lower left and upper right corners.
+        long count = 0; // Zeros minus poles of the integrand's function inside.
+        size_t depth = 0;
+    };
+
+    /* The k-th moment of g around a region, (1 / 2 pi i) times the integral of ((z - center) / scale)^k g(z) around
+     * its boundary; the scaling keeps the moments of the roots inside of order 1. */
+    static COMPLEX moment(CFunction<COMPLEX, COMPLEX> const &g, Region const &region, size_t const k, REAL const tol) {
+        COMPLEX const center = .5 * (region.lo + region.hi);
+        REAL const scale = .5 * std::abs(region.hi - region.lo);
+        CFunction<COMPLEX, COMPLEX> const integrand = k == 0 ? g : ((CFunction<COMPLEX, COMPLEX>() - center) / COMPLEX{scale}).pow(COMPLEX(k)) * g;
+        Integral<COMPLEX> const integral = Integrate(integrand, CFunction<REAL, COMPLEX>::Rectangle(region.lo, region.hi), 0., 1., 2. * M_PI * tol);
+        return integral.value / COMPLEX{0., 2. * M_PI};
+    }
+
+    /* The number of roots in a region, unless the integral does not come out close to an integer, as when a root lies
+     * on the boundary. */
+    static std::optional<long> count(CFunction<COMPLEX, COMPLEX> const &g, Region const &region) {
+        COMPLEX const s = moment(g, region, 0, ROOTS_COUNT_TOL);
+        REAL const rounded = std::round(std::real(s));
+        if (!(std::abs(s - rounded) < .25)) return std::nullopt;
+        return static_cast<long>(rounded);
+    }
+
+    /* Splits a region into the quadrants around a point near its center, leaving out those without roots; the point
+     * moves off center if a root lies on the new edges. Returns whether the counts add up. */
+    static bool split(CFunction<COMPLEX, COMPLEX> const &g, Region const &region, std::vector<Region> &children) {
+        static REAL constexpr FRACTIONS[] = {.5, .4615, .5398, .4167, .5741};
+        size_t constexpr n_fractions = sizeof(FRACTIONS) / sizeof(*FRACTIONS);
+        for (size_t attempt = 0; attempt < n_fractions; ++attempt) {
+            REAL const x0 = std::real(region.lo), y0 = std::imag(region.lo), x1 = std::real(region.hi), y1 = std::imag(region.hi);
+            REAL const x = x0 + FRACTIONS[attempt] * (x1 - x0), y = y0 + FRACTIONS[(attempt + 1) % n_fractions] * (y1 - y0);
+            Region const quadrants[4] = {{{x0, y0}, {x, y}}, {{x, y0}, {x1, y}}, {{x, y}, {x1, y1}}, {{x0, y}, {x, y1}}};
+            long total = 0;
+            bool valid = true;
+            children.clear();
+            for (Region quadrant : quadrants) {
+                std::optional<long> const n = count(g, quadrant);
+                if (!n) {
+                    valid = false;
+                    break;
+                }
+                total += *n;
+                quadrant.count = *n;
+                quadrant.depth = region.depth + 1;
+                if (*n != 0) children.push_back(quadrant);
+            }
+            if (valid && total == region.count) return true;
+        }
+        children.clear();
+        return false;
+    }
+
+    /* The roots of the monic polynomial z^n + a_(n-1) z^(n-1) + ... + a_0, by the Aberth-Ehrlich iteration. */
+    static std::vector<COMPLEX> polynomial_roots(std::vector<COMPLEX> const &a) {
+        size_t const n = a.size();
+        std::vector<COMPLEX> z(n);
+        for (size_t i = 0; i < n; ++i) z[i] = std::polar(.5, 2. * M_PI * (i + .25) / n);
+        for (size_t iteration = 0; iteration < 500; ++iteration) {
+            REAL largest = 0.;
+            for (size_t i = 0; i < n; ++i) {
+                COMPLEX p = 1., dp = 0., repulsion = 0.;
+                for (size_t k = n; k-- > 0;) {
+                    dp = dp * z[i] + p;
+                    p = p * z[i] + a[k];
+                }
+                for (size_t j = 0; j < n; ++j) {
+                    if (j != i) repulsion += 1. / (z[i] - z[j]);
+                }
+                COMPLEX const ratio = p / dp, step = ratio / (1. - ratio * repulsion);
+                if (!(std::isfinite(std::real(step)) && std::isfinite(std::imag(step)))) continue;
+                z[i] -= step;
+                largest = std::max(largest, std::abs(step));
+            }
+            if (largest <= 4. * std::numeric_limits<REAL>::epsilon()) break;
+        }
+        return z;
+    }
+
+    /* Estimates of the roots in a region, from the polynomial whose power sums are the moments of g: the Newton
+     * identities give its coefficients. One more moment checks them, and they are wrong if roots of the other kind
+     * (poles when looking for zeros, or the reverse) cancel some out; then there are none. */
+    static std::optional<std::vector<COMPLEX>> estimate(CFunction<COMPLEX, COMPLEX> const &g, Region const &region, REAL const tol) {
+        size_t const n = region.count;
+        std::vector<COMPLEX> sums(n + 2), e(n + 1, 0.), a(n);
+        for (size_t k = 1; k <= n + 1; ++k) sums[k] = moment(g, region, k, tol);
+        e[0] = 1.;
+        for (size_t k = 1; k <= n; ++k) {
+            for (size_t i = 1; i <= k; ++i) e[k] += (i % 2 == 1 ? 1. : -1.) * e[k - i] * sums[i];
+            e[k] /= static_cast<REAL>(k);
+        }
+        for (size_t j = 0; j < n; ++j) a[j] = ((n - j) % 2 == 0 ? 1. : -1.) * e[n - j];
+        std::vector<COMPLEX> w = polynomial_roots(a);
+        COMPLEX check = 0.;
+        for (COMPLEX const root : w) check += std::pow(root, static_cast<REAL>(n + 1));
+        if (!(std::abs(check - sums[n + 1]) <= 1e-4 + 100. * tol)) return std::nullopt;
+        COMPLEX const center = .5 * (region.lo + region.hi);
+        REAL const scale = .5 * std::abs(region.hi - region.lo);
+        for (COMPLEX &root : w) root = center + scale * root;
+        return w;
+    }
+
+    /* Groups estimates that lie within radius of the first of their group. */
+    static std::vector<std::vector<COMPLEX>> group(std::vector<COMPLEX> const &w, REAL const radius) {
+        std::vector<std::vector<COMPLEX>> groups;
+        std::vector<bool> grouped(w.size(), false);
+        for (size_t i = 0; i < w.size(); ++i) {
+            if (grouped[i]) continue;
+            groups.emplace_back();
+            for (size_t j = i; j < w.size(); ++j) {
+                if (grouped[j] || std::abs(w[j] - w[i]) > radius) continue;
+                grouped[j] = true;
+                groups.back().push_back(w[j]);
+            }
+        }
+        return groups;
+    }
+
+    /* The roots that a group of estimates stands for, none of the other estimates being within clearance of its mean.
+     * A root of multiplicity m comes out as m estimates spread over about tol^(1 / m) of the region they were found
+     * in, but so can m simple roots close together: the group is solved again in a box a few times its size, which
+     * must hold as many roots. There, the estimates of a multiple root close in on it, while those of distinct roots
+     * stay apart and are grouped, and solved, apart. */
+    static std::optional<std::vector<Root>> resolve(CFunction<COMPLEX, COMPLEX> const &g, std::vector<COMPLEX> const &members,
+                                                    REAL const clearance, size_t const depth, REAL const tol) {
+        size_t const m = members.size();
+        COMPLEX mean = 0.;
+        for (COMPLEX const w : members) mean += w;
+        mean /= static_cast<REAL>(m);
+        REAL spread = 0.;
+        for (COMPLEX const w : members) spread = std::max(spread, std::abs(w - mean));
+        if (m == 1 || spread == 0.) return std::vector<Root>{{mean, m}};
+
+        REAL const h = 4. * spread;
+        if (depth >= ROOTS_MAX_DEPTH || !(2. * h < clearance)) return std::nullopt;
+        Region box{mean - COMPLEX{h, .93 * h}, mean + COMPLEX{1.07 * h, h}, 0, depth + 1};
+        std::optional<long> const n = count(g, box);
+        if (!n || *n != static_cast<long>(m)) return std::nullopt;
+        box.count = *n;
+        std::optional<std::vector<COMPLEX>> const w = estimate(g, box, tol);
+        if (!w) return std::nullopt;
+        std::vector<std::vector<COMPLEX>> const groups = group(*w, std::min(.1, 10. * std::pow(tol, 1. / m)) * .5 * std::abs(box.hi - box.lo));
+        std::vector<Root> result;
+        for (std::vector<COMPLEX> const &inner : groups) {
+            COMPLEX inner_mean = 0.;
+            for (COMPLEX const z : inner) inner_mean += z;
+            inner_mean /= static_cast<REAL>(inner.size());
+            if (inner.size() == m) {
+                // Closing in on a multiple root; estimates that do not are distinct roots the grouping cannot part.
+                REAL inner_spread = 0.;
+                for (COMPLEX const z : inner) inner_spread = std::max(inner_spread, std::abs(z - inner_mean));
+                if (!(inner_spread < .5 * spread)) return std::nullopt;
+                result.push_back({inner_mean, m});
+                continue;
+            }
+            REAL inner_clearance = INFINITY;
+            for (COMPLEX const z : *w) {
+                if (std::find(inner.begin(), inner.end(), z) == inner.end()) inner_clearance = std::min(inner_clearance, std::abs(z - inner_mean));
+            }
+            std::optional<std::vector<Root>> const roots = resolve(g, inner, inner_clearance, depth + 1, tol);
+            if (!roots) return std::nullopt;
+            result.insert(result.end(), roots->begin(), roots->end());
+        }
+        return result;
+    }
+
+    /* The roots in a region, with their multiplicities, unless they cannot be told apart from each other or from roots
+     * of the other kind. */
+    static std::optional<std::vector<Root>> solve(CFunction<COMPLEX, COMPLEX> const &g, Region const &region, REAL const tol, bool const polish) {
+        std::optional<std::vector<COMPLEX>> const w = estimate(g, region, tol);
+        if (!w) return std::nullopt;
+        REAL const scale = .5 * std::abs(region.hi - region.lo);
+        std::vector<std::vector<COMPLEX>> const groups = group(*w, std::min(.1, 10. * std::pow(tol, 1. / w->size())) * scale);
+        std::vector<Root> result;
+        for (std::vector<COMPLEX> const &members : groups) {
+            COMPLEX mean = 0.;
+            for (COMPLEX const z : members) mean += z;
+            mean /= static_cast<REAL>(members.size());
+            REAL clearance = INFINITY;
+            for (COMPLEX const z : *w) {
+                if (std::find(members.begin(), members.end(), z) == members.end()) clearance = std::min(clearance, std::abs(z - mean));
+            }
+            std::optional<std::vector<Root>> const roots = resolve(g, members, clearance, region.depth, tol);
+            if (!roots) return std::nullopt;
+            result.insert(result.end(), roots->begin(), roots->end());
+        }
+        if (polish) {
+            for (Root &root : result) {
+                // Newton's method for a root of multiplicity m: g = f'/f is about m / (z - root) near it.
+                COMPLEX const start = root.location;
+                COMPLEX z = start;
+                for (size_t iteration = 0; iteration < 50; ++iteration) {
+                    COMPLEX const step = static_cast<REAL>(root.multiplicity) / g(z);
+                    if (!(std::isfinite(std::real(step)) && std::isfinite(std::imag(step)))) break;
+                    z -= step;
+                    if (std::abs(step) <= 4. * std::numeric_limits<REAL>::epsilon() * std::abs(z)) break;
+                }
+                if (std::abs(z - start) < scale) root.location = z;
+            }
+        }
+        return result;
+    }
+
+    std::vector<Root> Roots(CFunction<COMPLEX, COMPLEX> const &f, CFunction<REAL, COMPLEX> const &contour, REAL const start,
+                            REAL const end, REAL const tol, bool const poles, bool const polish) {
+        // The roots of f are those of f'/f with residues their multiplicities, and the poles those with minus theirs.
+        CFunction<COMPLEX, COMPLEX> const df_f = Derivative(f, 1, tol, 1., false) / f, g = poles ? -df_f : df_f;
+
+        // The search starts from the bounding box of the contour, enlarged a little and off center, so that its edges
+        // and the subdivisions are unlikely to pass through roots at round coordinates.
+        size_t constexpr n_samples = 1025;
+        std::vector<REAL> t(n_samples);
+        std::vector<COMPLEX> z(n_samples);
+        for (size_t j = 0; j < n_samples; ++j) t[j] = start + (end - start) * j / (n_samples - 1);
+        contour(t.data(), z.data(), n_samples);
+        REAL x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+        for (COMPLEX const point : z) {
+            x0 = std::min(x0, std::real(point));
+            y0 = std::min(y0, std::imag(point));
+            x1 = std::max(x1, std::real(point));
+            y1 = std::max(y1, std::imag(point));
+        }
+        if (!(std::isfinite(x0) && std::isfinite(y0) && std::isfinite(x1) && std::isfinite(y1))) throw std::invalid_argument("the contour is not finite");
+        REAL const size = std::max({x1 - x0, y1 - y0, std::numeric_limits<REAL>::min()});
+        std::optional<long> n;
+        Region box;
+        for (REAL margin = .0513; !n && margin < 1.; margin *= 1.618) {
+            box = {{x0 - margin * size, y0 - .93 * margin * size}, {x1 + 1.07 * margin * size, y1 + margin * size}, 0, 0};
+            n = count(g, box);
+        }
+        if (!n) throw std::runtime_error("could not count the roots around the contour");
+        box.count = *n;
+
+        // Rectangles are processed level by level, each level in parallel; the results are gathered in order, so they do
+        // not depend on the number of threads. Regions left with more roots of the other kind than of this one have none
+        // to find; every other root the box was counted to hold must be found.
+        std::vector<Region> pending{box};
+        std::vector<Root> found;
+        long found_count = 0, other_count = 0;
+        while (!pending.empty()) {
+            std::vector<std::vector<Region>> children(pending.size());
+            std::vector<std::vector<Root>> roots(pending.size());
+            std::vector<char> solved(pending.size(), false);
+            ThreadPool::instance().parallel_for(pending.size(), 1, [&](size_t const i, size_t) {
+                Region const &region = pending[i];
+                bool const few = region.count > 0 && region.count <= static_cast<long>(ROOTS_PER_REGION);
+                std::optional<std::vector<Root>> solution;
+                if (few) solution = solve(g, region, tol, polish);
+                if (!solution && region.depth < ROOTS_MAX_DEPTH && split(g, region, children[i])) return;
+                if (!few && region.count > 0) solution = solve(g, region, tol, polish);
+                if (solution) roots[i] = *solution;
+                solved[i] = solution.has_value();
+            });
+            for (size_t i = 0; i < children.size(); ++i) {
+                for (Root const &root : roots[i]) found_count += static_cast<long>(root.multiplicity);
+                if (!solved[i] && children[i].empty() && pending[i].count < 0) other_count += pending[i].count;
+            }
+            pending.clear();
+            for (size_t i = 0; i < children.size(); ++i) {
+                pending.insert(pending.end(), children[i].begin(), children[i].end());
+                found.insert(found.end(), roots[i].begin(), roots[i].end());
+            }
+        }
+        if (found_count + other_count != box.count) throw std::runtime_error("could not isolate the roots around the contour");
+
+        // Of the roots in the box, those the contour winds around.
+        std::vector<char> inside(found.size());
+        ThreadPool::instance().parallel_for(found.size(), 1, [&](size_t const i, size_t) {
+            Integral<COMPLEX> const winding = Integrate(COMPLEX{1.} / (CFunction<COMPLEX, COMPLEX>() - found[i].location), contour, start, end, ROOTS_COUNT_TOL);
+            inside[i] = std::abs(std::real(winding.value / COMPLEX{0., 2. * M_PI})) > .5;
+        });
+        std::vector<Root> result;
+        for (size_t i = 0; i < found.size(); ++i) {
+            if (inside[i]) result.push_back(found[i]);
+        }
+        return result;
     }
 }
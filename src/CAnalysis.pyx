@@ -1,41 +1,154 @@
 # distutils: language = c++
 from Definitions cimport *
 from CFunction cimport *
+from libcpp.vector cimport vector
+from libc.stdint cimport uint32_t
+from Profile cimport Node
 
 cdef extern from "CAnalysis.cpp":
   pass
 
 cdef extern from "CAnalysis.h" namespace "libcalculus":
-  CFunction[Dom, Ran] Derivative[Dom, Ran](CFunction[Dom, Ran] f, const size_t order, const REAL tol, const REAL radius) except +
-  Ran Integrate[Dom, Ran, ContDom](CFunction[Dom, Ran] f, CFunction[ContDom, Dom] contour,
-                                   const ContDom start, const ContDom end, const REAL tol) except +
-
-def integrate(f, contour, const REAL start=0., const REAL end=1., const REAL tol=1e-3):
-  """Integrate f between two real numbers or along a contour."""
-  if isinstance(f, ComplexFunction) and isinstance(contour, Contour) and start is not None and end is not None:
-    return Integrate[COMPLEX, COMPLEX, REAL]((<ComplexFunction>f).cfunction, (<Contour>contour).cfunction,
-                                             start, end, tol)
-  elif isinstance(f, Function) and (<Function>f).complexfunction is not None and isinstance(contour, Contour) and start is not None and end is not None:
-      return Integrate[COMPLEX, COMPLEX, REAL]((<Function>f).complexfunction.cfunction, (<Contour>contour).cfunction,
-                                               start, end, tol)
-  elif isinstance(f, ComplexFunction) and isinstance(contour, Function) and (<Function>contour).contour is not None and start is not None and end is not None:
-      return Integrate[COMPLEX, COMPLEX, REAL]((<ComplexFunction>f).cfunction, (<Function>contour).contour.cfunction,
-                                               start, end, tol)
-  elif isinstance(f, Function) and (<Function>f).complexfunction is not None and isinstance(contour, Function) and (<Function>f).contour is not None \
-     and start is not None and end is not None:
-      return Integrate[COMPLEX, COMPLEX, REAL]((<Function>f).complexfunction.cfunction, (<Function>contour).contour.cfunction,
-                                               start, end, tol)
-  elif isinstance(f, RealFunction) and isinstance(contour, np.ndarray) and np.issubdtype(contour.dtype, np.number) and contour.shape == (2,):
-      return Integrate[REAL, REAL, REAL]((<RealFunction>f).cfunction, (<RealFunction>RealFunction.Identity()).cfunction, contour[0], contour[1], tol)
-  elif isinstance(f, RealFunction) and hasattr(contour, "__iter__") and len(contour) == 2 and np.issubdtype(type(contour[0]), np.number) and np.issubdtype(type(contour[1]), np.number):
-    return Integrate[REAL, REAL, REAL]((<RealFunction>f).cfunction, (<RealFunction>RealFunction.Identity()).cfunction, contour[0], contour[1], tol)
-  elif isinstance(f, Function) and hasattr(contour, "__iter__") and len(contour) == 2 and np.issubdtype(type(contour[0]), np.number) and np.issubdtype(type(contour[1]), np.number):
-      return Integrate[REAL, REAL, REAL]((<Function>f).realfunction.cfunction, (<RealFunction>RealFunction.Identity()).cfunction, contour[0], contour[1], tol)
+  CFunction[Dom, Ran] Derivative[Dom, Ran](CFunction[Dom, Ran] f, const size_t order, const REAL tol, const REAL radius, const cbool symbolic) except +
+  cdef cppclass Integral[Ran]:
+    Ran value
+    REAL error
+    size_t evaluations
+  Integral[Ran] Integrate[Dom, Ran, ContDom](CFunction[Dom, Ran] f, CFunction[ContDom, Dom] contour,
+                                             const ContDom start, const ContDom end, const REAL tol, const cbool extended) except + nogil
+  void IntegrateMany[Dom, Ran, ContDom](const CFunction[Dom, Ran] *fs, const CFunction[ContDom, Dom] *contours, const ContDom *starts,
+                                        const ContDom *ends, const size_t n, const REAL tol, const cbool extended,
+                                        Integral[Ran] *results) except + nogil
+  cdef cppclass Root:
+    COMPLEX location
+    size_t multiplicity
+  vector[Root] Roots(CFunction[COMPLEX, COMPLEX] f, CFunction[REAL, COMPLEX] contour, const REAL start, const REAL end, const REAL tol,
+                     const cbool poles, const cbool polish) except + nogil
+  Integral[REAL] Length(CFunction[REAL, COMPLEX] contour, const REAL start, const REAL end, const REAL tol) except +
+  void Coefficients(CFunction[COMPLEX, COMPLEX] f, const COMPLEX *centers, const size_t n_centers, const REAL radius,
+                    const size_t n, const cbool laurent, COMPLEX *coeffs, REAL *errors) except + nogil
+  cdef cppclass ProfiledNode:
+    uint32_t index
+    const char *op
+    string latex
+    vector[uint32_t] operands
+    Node counts
+  vector[ProfiledNode] Profiled[Dom, Ran](CFunction[Dom, Ran] f, string varname) except +
+
+cdef cbool _integrand(f, contour, REAL *start, REAL *end, CFunction[COMPLEX, COMPLEX] *complex_f, CFunction[REAL, COMPLEX] *contour_f,
+                      CFunction[REAL, REAL] *real_f) except *:
+  """Resolve the arguments of integrate() into the C++ function and contour, or the real function whose integral is
+  taken between the two numbers in contour; returns whether the integral is real."""
+  if isinstance(f, Function) and (<Function>f).complexfunction is not None and not isinstance(contour, (RealFunction, np.ndarray, list, tuple)):
+    f = (<Function>f).complexfunction
+  if isinstance(contour, Function) and (<Function>contour).contour is not None:
+    contour = (<Function>contour).contour
+  if isinstance(f, ComplexFunction) and isinstance(contour, Contour):
+    complex_f[0], contour_f[0] = (<ComplexFunction>f).cfunction, (<Contour>contour).cfunction
+    return False
+
+  if isinstance(f, Function) and (<Function>f).realfunction is not None:
+    f = (<Function>f).realfunction
+  if isinstance(f, RealFunction) and hasattr(contour, "__iter__") and len(contour) == 2 \
+     and np.issubdtype(type(contour[0]), np.number) and np.issubdtype(type(contour[1]), np.number):
+    real_f[0], start[0], end[0] = (<RealFunction>f).cfunction, contour[0], contour[1]
+    return True
+  raise NotImplementedError
+
+def integrate(f, contour, REAL start=0., REAL end=1., const REAL tol=1e-3, cbool full_output=False, cbool extended=False):
+  """Integrate f between two real numbers or along a contour, by adaptive Gauss-Kronrod quadrature to an absolute
+  tolerance tol; the work is split between the threads set by threads(), and the result does not depend on their number.
+  With full_output=True, returns the integral, an estimate of its error and the number of evaluations. With
+  extended=True, the integrand is evaluated and summed in long double, for integrals that cancel badly in double."""
+  cdef CFunction[COMPLEX, COMPLEX] complex_f
+  cdef CFunction[REAL, COMPLEX] contour_f
+  cdef CFunction[REAL, REAL] real_f, identity
+  cdef Integral[COMPLEX] complex_result
+  cdef Integral[REAL] real_result
+  cdef cbool is_real = _integrand(f, contour, &start, &end, &complex_f, &contour_f, &real_f)
+  with nogil:
+    if is_real:
+      real_result = Integrate[REAL, REAL, REAL](real_f, identity, start, end, tol, extended)
+    else:
+      complex_result = Integrate[COMPLEX, COMPLEX, REAL](complex_f, contour_f, start, end, tol, extended)
+
+  if is_real and full_output:
+    return real_result.value, real_result.error, real_result.evaluations
+  elif is_real:
+    return real_result.value
+  elif full_output:
+    return complex_result.value, complex_result.error, complex_result.evaluations
   else:
-    raise NotImplementedError
+    return complex_result.value
+
+def integrate_many(fs, contours, starts=0., ends=1., const REAL tol=1e-3, cbool extended=False):
+  """Integrate many functions at once: fs and contours are sequences (or single objects, used for every integral) with
+  the arguments of integrate(), and starts and ends numbers or arrays of them; extended is as in integrate(). All
+  integrals run in C++ across the threads set by threads(), with the GIL released. Returns arrays of the integrals,
+  their error estimates and the numbers of evaluations."""
+  cdef size_t i, n
+  cdef REAL start, end
+  cdef CFunction[COMPLEX, COMPLEX] complex_f
+  cdef CFunction[REAL, COMPLEX] contour_f
+  cdef CFunction[REAL, REAL] real_f, identity
+  cdef vector[CFunction[COMPLEX, COMPLEX]] complex_fs
+  cdef vector[CFunction[REAL, COMPLEX]] contour_fs
+  cdef vector[CFunction[REAL, REAL]] real_fs, identities
+  cdef vector[REAL] complex_starts, complex_ends, real_starts, real_ends
+  cdef vector[size_t] complex_items, real_items
+  cdef vector[Integral[COMPLEX]] complex_results
+  cdef vector[Integral[REAL]] real_results
 
-def derivative(f, const size_t order=1, const REAL tol=1e-3, const REAL radius=1.):
-  """Returns a function object representing f's derivative."""
+  single = lambda x: isinstance(x, (Function, ComplexFunction, RealFunction, Contour))
+  fs = [fs] if single(fs) else list(fs)
+  pair = lambda x: hasattr(x, "__len__") and len(x) == 2 and all(np.issubdtype(type(y), np.number) for y in x)
+  contours = [contours] if single(contours) or pair(contours) else list(contours)
+  starts, ends = np.atleast_1d(np.asarray(starts, dtype=float)), np.atleast_1d(np.asarray(ends, dtype=float))
+  n = max(len(fs), len(contours), starts.size, ends.size)
+  for name, items in (("fs", fs), ("contours", contours), ("starts", starts), ("ends", ends)):
+    if len(items) != 1 and <size_t>len(items) != n:
+      raise ValueError(f"{name} has {len(items)} items, but others have {n}.")
+
+  for i in range(n):
+    start, end = starts[i % starts.size], ends[i % ends.size]
+    if _integrand(fs[i % len(fs)], contours[i % len(contours)], &start, &end, &complex_f, &contour_f, &real_f):
+      real_items.push_back(i)
+      real_fs.push_back(real_f)
+      identities.push_back(identity)
+      real_starts.push_back(start)
+      real_ends.push_back(end)
+    else:
+      complex_items.push_back(i)
+      complex_fs.push_back(complex_f)
+      contour_fs.push_back(contour_f)
+      complex_starts.push_back(start)
+      complex_ends.push_back(end)
+  complex_results.resize(complex_items.size())
+  real_results.resize(real_items.size())
+
+  with nogil:
+    if complex_items.size() > 0:
+      IntegrateMany[COMPLEX, COMPLEX, REAL](complex_fs.data(), contour_fs.data(), complex_starts.data(), complex_ends.data(),
+                                            complex_items.size(), tol, extended, complex_results.data())
+    if real_items.size() > 0:
+      IntegrateMany[REAL, REAL, REAL](real_fs.data(), identities.data(), real_starts.data(), real_ends.data(),
+                                      real_items.size(), tol, extended, real_results.data())
+
+  values = np.empty(n, dtype=complex if complex_items.size() > 0 else float)
+  errors, evaluations = np.empty(n, dtype=float), np.empty(n, dtype=np.uint64)
+  for i in range(complex_items.size()):
+    values[complex_items[i]] = complex_results[i].value
+    errors[complex_items[i]], evaluations[complex_items[i]] = complex_results[i].error, complex_results[i].evaluations
+  for i in range(real_items.size()):
+    values[real_items[i]] = real_results[i].value
+    errors[real_items[i]], evaluations[real_items[i]] = real_results[i].error, real_results[i].evaluations
+  return values, errors, evaluations
+
+def derivative(f, const size_t order=1, const REAL tol=1e-3, const REAL radius=1., cbool symbolic=False):
+  """Returns a function object representing f's derivative. With symbolic=True, the derivative is built from the
+  differentiation rules of the presets, as an ordinary function with its own LaTeX; tol and radius only apply to
+  functions wrapping Python callables, which are differentiated numerically. Otherwise, the derivative is evaluated
+  from the Taylor series of f, up to order 1024."""
   cdef RealFunction real_result
   cdef Contour contour_result
   cdef ComplexFunction complex_result
@@ -46,49 +159,76 @@ def derivative(f, const size_t order=1, const REAL tol=1e-3, const REAL radius=1
   if isinstance(f, Function):
     if (<Function>f).realfunction is not None:
       real_result = RealFunction()
-      real_result.cfunction = Derivative((<Function>f).realfunction.cfunction, order, tol, radius)
+      real_result.cfunction = Derivative((<Function>f).realfunction.cfunction, order, tol, radius, symbolic)
     else:
       real_result = None
 
     if (<Function>f).contour is not None:
       contour_result = Contour()
-      contour_result.cfunction = Derivative((<Function>f).contour.cfunction, order, tol, radius)
+      contour_result.cfunction = Derivative((<Function>f).contour.cfunction, order, tol, radius, symbolic)
     else:
       contour_result = None
 
     if (<Function>f).complexfunction is not None:
       complex_result = ComplexFunction()
-      complex_result.cfunction = Derivative((<Function>f).complexfunction.cfunction, order, tol, radius)
+      complex_result.cfunction = Derivative((<Function>f).complexfunction.cfunction, order, tol, radius, symbolic)
     else:
       complex_result = None
     return Function(real_result, contour_result, complex_result)
 
   elif isinstance(f, ComplexFunction):
     complex_result = ComplexFunction()
-    complex_result.cfunction = Derivative((<ComplexFunction>f).cfunction, order, tol, radius)
+    complex_result.cfunction = Derivative((<ComplexFunction>f).cfunction, order, tol, radius, symbolic)
     return complex_result
   elif isinstance(f, RealFunction):
     real_result = RealFunction()
-    real_result.cfunction = Derivative((<RealFunction>f).cfunction, order, tol, radius)
+    real_result.cfunction = Derivative((<RealFunction>f).cfunction, order, tol, radius, symbolic)
     return real_result
   elif isinstance(f, Contour):
     contour_result = Contour()
-    contour_result.cfunction = Derivative((<Contour>f).cfunction, order, tol, radius)
+    contour_result.cfunction = Derivative((<Contour>f).cfunction, order, tol, radius, symbolic)
     return contour_result
   else:
     raise NotImplementedError(f"Derivative not supported for type {type(f)}.")
 
+def coefficients(f, z0, const REAL radius=1., const size_t n=64, cbool laurent=False):
+  """Taylor coefficients a_0, ..., a_(n-1) of f around z0, or with laurent=True the Laurent coefficients a_(-n/2), ...,
+  a_(n/2-1), from one FFT of f sampled at n points (a power of two) on the circle of the given radius around z0.
+  Returns the coefficients and an estimate of the error of radius^k a_k, from the decay of the last coefficients.
+  z0 may be an array of centers, in which case every circle is evaluated in one pass and there is a row of coefficients
+  and an error estimate per center."""
+  cdef ComplexFunction cf
+  if isinstance(f, Function) and (<Function>f).complexfunction is not None:
+    cf = (<Function>f).complexfunction
+  elif isinstance(f, ComplexFunction):
+    cf = <ComplexFunction>f
+  else:
+    raise NotImplementedError(f"Coefficients not supported for type {type(f)}.")
+
+  cdef np.ndarray[COMPLEX] centers = np.ascontiguousarray(np.ravel(z0), dtype=complex)
+  cdef np.ndarray[COMPLEX, ndim=2] coeffs = np.empty((centers.size, n), dtype=complex)
+  cdef np.ndarray[REAL] errors = np.empty(centers.size, dtype=float)
+  if centers.size > 0:
+    with nogil:
+      Coefficients(cf.cfunction, &centers[0], centers.size, radius, n, laurent, &coeffs[0, 0], &errors[0])
+  if np.ndim(z0) == 0:
+    return coeffs[0], errors[0]
+  return coeffs.reshape(np.shape(z0) + (n,)), errors.reshape(np.shape(z0))
+
 def residue(f, z0, const REAL radius=1., const REAL tol=1e-3):
   """Calculate the residue of f around z0, given that f does not have any further singularities inside
-  a sphere of the given radius around z0."""
-  cdef Contour contour
-  if _isrealscalar(z0) or _iscomplexscalar(z0):
-    contour = Contour.Sphere(z0, radius)
-  elif isinstance(z0, Function): # Just assume it is a constant function
-    contour = Contour.Sphere(z0(0.), radius)
-  else:
+  a sphere of the given radius around z0. z0 may be an array of points, whose residues are computed together."""
+  if isinstance(z0, Function): # Just assume it is a constant function
+    z0 = z0(0.)
+  elif not (_isrealscalar(z0) or _iscomplexscalar(z0) or isinstance(z0, np.ndarray)):
     raise NotImplementedError(f"Point of residue calculation should be a number or a constant function, not {type(z0)}.")
-  return integrate(f, contour, 0., 1., tol) / complex(2j * M_PI)
+  # The residue is the Laurent coefficient a_(-1); samples are doubled until its error estimate meets the tolerance.
+  cdef size_t n = 64
+  while True:
+    coeffs, errors = coefficients(f, z0, radius, n, True)
+    if np.all(errors * radius <= tol) or n >= 1 << 16:
+      return coeffs[..., n // 2 - 1]
+    n *= 2
 
 def index(const COMPLEX z0, Function contour not None, const REAL start=0., const REAL end=1.):
   if contour.contour is None:
@@ -101,3 +241,39 @@ def zeros(Function f not None, Function contour not None, const REAL start=0., c
     raise ValueError("The function or contour passed are malformed.")
   else:
     return f.complexfunction.zeros(contour.contour, start, end)
+
+def length(Function contour not None, const REAL start=0., const REAL end=1., const REAL tol=1e-3):
+  """Calculates the length of a contour between two values of t."""
+  if contour.contour is None:
+    raise ValueError("The contour passed is malformed.")
+  return contour.contour.length(start, end, tol)
+
+cdef _roots(f, contour, const REAL start, const REAL end, const REAL tol, const cbool poles, const cbool polish):
+  cdef vector[Root] result
+  cdef CFunction[COMPLEX, COMPLEX] complex_f
+  cdef CFunction[REAL, COMPLEX] contour_f
+  cdef size_t i
+  if isinstance(f, Function):
+    f = (<Function>f).complexfunction
+  if isinstance(contour, Function):
+    contour = (<Function>contour).contour
+  if not isinstance(f, ComplexFunction) or not isinstance(contour, Contour):
+    raise ValueError("The function or contour passed are malformed.")
+  complex_f, contour_f = (<ComplexFunction>f).cfunction, (<Contour>contour).cfunction
+  with nogil:
+    result = Roots(complex_f, contour_f, start, end, tol, poles, polish)
+  locations, multiplicities = np.empty(result.size(), dtype=complex), np.empty(result.size(), dtype=np.uint64)
+  for i in range(result.size()):
+    locations[i], multiplicities[i] = result[i].location, result[i].multiplicity
+  return locations, multiplicities
+
+def roots(f, contour, const REAL start=0., const REAL end=1., const REAL tol=1e-8, cbool polish=True):
+  """Locates the zeros of a holomorphic function inside a closed contour by the argument principle, subdividing the
+  region in parallel until each part holds a few, and polishing them by Newton's method unless polish=False. Returns
+  arrays of their locations and multiplicities."""
+  return _roots(f, contour, start, end, tol, False, polish)
+
+def poles(f, contour, const REAL start=0., const REAL end=1., const REAL tol=1e-8, cbool polish=True):
+  """Locates the poles of a meromorphic function inside a closed contour, like roots(); zeros of the function close to
+  a pole can hide it."""
+  return _roots(f, contour, start, end, tol, True, polish)
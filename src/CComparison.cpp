@@ -1,57 +1,75 @@
 #include "CComparison.h"
+#include "ThreadPool.h"
+#include <vector>
 
 namespace libcalculus {
+    template<typename Dom>
+    void CComparison<Dom>::operator()(Dom const *RESTRICT z, uint64_t *RESTRICT mask, size_t const n) const {
+        // Ranges of whole words, so that no two threads write to the same one.
+        ThreadPool::instance().parallel_for(mask_words(n), PARALLEL_GRAIN / 64, [&](size_t const begin, size_t const end) {
+            size_t const offset = 64 * begin, m = std::min(64 * end, n) - offset;
+            if (this->eval_array) this->eval_array(z + offset, mask + begin, m);
+            else pack_mask(mask + begin, m, [&](size_t const j) { return this->eval(z[offset + j]); });
+        });
+    }
+
+    template<typename Dom>
+    Tape::Branch CComparison<Dom>::branch(Tape::ptr const &then_, Tape::ptr const &else_) const {
+        return Tape::Branch{[eval = this->eval](COMPLEX const z) { return eval(from_complex<Dom>(z)); },
+                            [comparison = *this](void const *RESTRICT z, uint64_t *RESTRICT mask, size_t const n) {
+                                comparison(static_cast<Dom const *>(z), mask, n);
+                            }, then_, else_, this->latex, this->condition};
+    }
+
+    /* Masks of two comparisons combined by op, word by word. */
+    template<typename Dom, typename Op>
+    static inline typename CComparison<Dom>::array_function combine(CComparison<Dom> const &lhs, CComparison<Dom> const &rhs, Op const &op) {
+        return [lhs, rhs, op](Dom const *RESTRICT z, uint64_t *RESTRICT mask, size_t const n) {
+            std::vector<uint64_t> rhs_mask(mask_words(n));
+            lhs(z, mask, n);
+            rhs(z, rhs_mask.data(), n);
+            for (size_t w = 0; w < rhs_mask.size(); ++w) mask[w] = op(mask[w], rhs_mask[w]);
+        };
+    }
+
+    static inline std::shared_ptr<Condition const> combined(Condition::Kind const kind, std::shared_ptr<Condition const> const &a,
+                                                            std::shared_ptr<Condition const> const &b) {
+        return std::make_shared<Condition const>(Condition{kind, false, nullptr, nullptr, a, b});
+    }
+
     template<typename Dom>
     CComparison<Dom> CComparison<Dom>::operator~() const {
-        std::string new_latex = "\\neg\\left(";
-        new_latex.append(this->latex);
-        new_latex.append("\\right)");
-        return CComparison([old_eval = this->eval](Dom z) { return !old_eval(z); }, new_latex);
+        Latex::Text::ptr const new_latex = Latex::join({"\\neg\\left(", this->latex, "\\right)"});
+        return CComparison([old_eval = this->eval](Dom z) { return !old_eval(z); },
+                           [operand = *this](Dom const *RESTRICT z, uint64_t *RESTRICT mask, size_t const n) {
+                               operand(z, mask, n);
+                               for (size_t w = 0; w < mask_words(n); ++w) mask[w] = ~mask[w];
+                           }, new_latex, combined(Condition::Kind::NOT, this->condition, nullptr));
     }
 
     template<typename Dom>
     CComparison<Dom> CComparison<Dom>::operator|(CComparison<Dom> const &rhs) const {
-        std::string new_latex = "\\left(";
-        new_latex.append(this->latex);
-        new_latex.append("\\right)\\vee\\left(");
-        new_latex.append(rhs.latex);
-        new_latex.append("\\right)");
+        Latex::Text::ptr const new_latex = Latex::join({"\\left(", this->latex, "\\right)\\vee\\left(", rhs.latex, "\\right)"});
         return CComparison([lhs_eval = this->eval, rhs_eval = rhs.eval](Dom z) { return lhs_eval(z) || rhs_eval(z); },
-                                     new_latex);
+                           combine(*this, rhs, [](uint64_t const a, uint64_t const b) { return a | b; }), new_latex,
+                           combined(Condition::Kind::OR, this->condition, rhs.condition));
     }
 
     template<typename Dom>
     CComparison<Dom> CComparison<Dom>::operator&(CComparison<Dom> const &rhs) const {
-        std::string new_latex = "\\left(";
-        new_latex.append(this->latex);
-        new_latex.append("\\right)\\wedge\\left(");
-        new_latex.append(rhs.latex);
-        new_latex.append("\\right)");
+        Latex::Text::ptr const new_latex = Latex::join({"\\left(", this->latex, "\\right)\\wedge\\left(", rhs.latex, "\\right)"});
         return CComparison([lhs_eval = this->eval, rhs_eval = rhs.eval](Dom z) { return lhs_eval(z) && rhs_eval(z); },
-                                     new_latex);
+                           combine(*this, rhs, [](uint64_t const a, uint64_t const b) { return a & b; }), new_latex,
+                           combined(Condition::Kind::AND, this->condition, rhs.condition));
     }
 
     template<typename Dom>
     CComparison<Dom> &CComparison<Dom>::operator|=(CComparison<Dom> const &rhs) {
-        std::string new_latex = "\\left(";
-        new_latex.append(this->latex);
-        new_latex.append("\\right)\\vee\\left(");
-        new_latex.append(rhs.latex);
-        new_latex.append("\\right)");
-        this->eval = [lhs_eval = this->eval, rhs_eval = rhs.eval](Dom z) { return lhs_eval(z) || rhs_eval(z); };
-        this->latex = new_latex;
-        return *this;
+        return *this = *this | rhs;
     }
 
     template<typename Dom>
     CComparison<Dom> &CComparison<Dom>::operator&=(CComparison<Dom> const &rhs) {
-        std::string new_latex = "\\left(";
-        new_latex.append(this->latex);
-        new_latex.append("\\right)\\wedge\\left(");
-        new_latex.append(rhs.latex);
-        new_latex.append("\\right)");
-        this->eval = [lhs_eval = this->eval, rhs_eval = rhs.eval](Dom z) { return lhs_eval(z) && rhs_eval(z); };
-        this->latex = new_latex;
-        return *this;
+        return *this = *this & rhs;
     }
 }
@@ -1,288 +1,509 @@
 #include "CFunction.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 
 namespace libcalculus {
     template<typename Dom, typename Ran>
     void CFunction<Dom, Ran>::operator()(Dom const *RESTRICT z, Ran *RESTRICT result, size_t const n) const {
-        #pragma omp simd
-        for (size_t i = 0; i < n; ++i) {
-            result[i] = this->_f(z[i]);
+        ThreadPool::instance().parallel_for(n, PARALLEL_GRAIN, [&](size_t const begin, size_t const end) {
+            (*this->_tape())(z + begin, result + begin, end - begin);
+        });
+    }
+
+    template<typename Dom, typename Ran>
+    template<typename T, typename U>
+    void CFunction<Dom, Ran>::operator()(T const *RESTRICT z, U *RESTRICT result, size_t const n) const {
+        using F = precision_of<T>;
+        static_assert(std::is_same<T, at_precision<Dom, F>>::value && std::is_same<U, at_precision<Ran, F>>::value);
+        ThreadPool::instance().parallel_for(n, PARALLEL_GRAIN, [&](size_t const begin, size_t const end) {
+            this->_tape()->template evaluate<F>(z + begin, result + begin, end - begin);
+        });
+    }
+
+    template<typename Dom, typename Ran>
+    template<typename T, typename U>
+    void CFunction<Dom, Ran>::operator()(T const *z, U *result, uint8_t const *where, size_t const ndim, size_t const *shape,
+                                         ptrdiff_t const *strides) const {
+        using F = precision_of<T>;
+        static_assert(std::is_same<T, at_precision<Dom, F>>::value && std::is_same<U, at_precision<Ran, F>>::value);
+        struct Dimension {
+            size_t size;
+            ptrdiff_t z, result, where;
+        };
+        // Dimensions of one point are dropped, and the rest walked in the order of result in memory, with each merged
+        // into the one before it where the points of both are evenly spaced, so that contiguous arrays are one run.
+        std::vector<Dimension> dimensions;
+        size_t n = 1;
+        for (size_t i = 0; i < ndim; ++i) {
+            n *= shape[i];
+            if (shape[i] != 1) dimensions.push_back({shape[i], strides[i], strides[ndim + i], where ? strides[2 * ndim + i] : 0});
+        }
+        if (n == 0) return;
+        std::stable_sort(dimensions.begin(), dimensions.end(), [](Dimension const &a, Dimension const &b) {
+            return std::abs(a.result) > std::abs(b.result);
+        });
+        size_t d = 0;
+        for (size_t i = 0; i < dimensions.size(); ++i) {
+            Dimension const &inner = dimensions[i];
+            if (d > 0) {
+                Dimension &outer = dimensions[d - 1];
+                ptrdiff_t const size = static_cast<ptrdiff_t>(inner.size);
+                if (outer.z == inner.z * size && outer.result == inner.result * size && outer.where == inner.where * size) {
+                    outer = {outer.size * inner.size, inner.z, inner.result, inner.where};
+                    continue;
+                }
+            }
+            dimensions[d++] = inner;
         }
+        dimensions.resize(d);
+        if (dimensions.empty()) dimensions.push_back({1, 0, 0, 0}); // A single point.
+        d = dimensions.size();
+
+        char const *const z_bytes = reinterpret_cast<char const *>(z);
+        char *const result_bytes = reinterpret_cast<char *>(result);
+        if (!where && d == 1 && dimensions[0].z == static_cast<ptrdiff_t>(sizeof(T)) && dimensions[0].result == static_cast<ptrdiff_t>(sizeof(U))
+            && (z_bytes + n * sizeof(T) <= result_bytes || result_bytes + n * sizeof(U) <= z_bytes)) {
+            (*this)(z, result, n);
+            return;
+        }
+
+        // Otherwise every task gathers its points a few tape blocks at a time, small enough to stay in cache, evaluates
+        // them, and scatters their values.
+        Tape const &tape = *this->_tape();
+        ThreadPool::instance().parallel_for(n, PARALLEL_GRAIN, [&](size_t const begin, size_t const end) {
+            size_t const block = std::min(4 * TAPE_BLOCK_SIZE, end - begin);
+            std::vector<T> points(block);
+            std::vector<U> values(block);
+            std::vector<char *> targets(where ? block : 0); // Where each value goes, or with no where, the runs they fill.
+            std::vector<std::pair<char *, size_t>> runs;
+            std::vector<size_t> index(d);
+            char const *z_at = z_bytes, *where_at = reinterpret_cast<char const *>(where);
+            char *result_at = result_bytes;
+            for (size_t k = d, rest = begin; k-- > 0; rest /= dimensions[k].size) {
+                index[k] = rest % dimensions[k].size;
+                z_at += static_cast<ptrdiff_t>(index[k]) * dimensions[k].z;
+                result_at += static_cast<ptrdiff_t>(index[k]) * dimensions[k].result;
+                if (where) where_at += static_cast<ptrdiff_t>(index[k]) * dimensions[k].where;
+            }
+            // Runs along the innermost dimension are gathered in a tight loop, and the position carried into the
+            // outer dimensions between them.
+            Dimension const &inner = dimensions[d - 1];
+            size_t m = 0;
+            for (size_t i = begin; i < end;) {
+                ptrdiff_t const run = static_cast<ptrdiff_t>(std::min({end - i, inner.size - index[d - 1], block - m}));
+                if (where) {
+                    for (ptrdiff_t j = 0; j < run; ++j) {
+                        if (!where_at[j * inner.where]) continue;
+                        std::memcpy(&points[m], z_at + j * inner.z, sizeof(T));
+                        targets[m++] = result_at + j * inner.result;
+                    }
+                } else {
+                    for (ptrdiff_t j = 0; j < run; ++j) std::memcpy(&points[m + j], z_at + j * inner.z, sizeof(T));
+                    runs.push_back({result_at, static_cast<size_t>(run)});
+                    m += run;
+                }
+                i += run;
+                index[d - 1] += run;
+                z_at += run * inner.z;
+                result_at += run * inner.result;
+                if (where) where_at += run * inner.where;
+                for (size_t k = d - 1; k > 0 && index[k] == dimensions[k].size; --k) {
+                    ptrdiff_t const size = static_cast<ptrdiff_t>(dimensions[k].size);
+                    index[k] = 0;
+                    ++index[k - 1];
+                    z_at += dimensions[k - 1].z - size * dimensions[k].z;
+                    result_at += dimensions[k - 1].result - size * dimensions[k].result;
+                    if (where) where_at += dimensions[k - 1].where - size * dimensions[k].where;
+                }
+                if (m == block || (i == end && m > 0)) {
+                    // Values of one contiguous run are written in place.
+                    bool const direct = !where && runs.size() == 1 && inner.result == static_cast<ptrdiff_t>(sizeof(U));
+                    U *const into = direct ? reinterpret_cast<U *>(runs[0].first) : values.data();
+                    if constexpr (std::is_same<F, REAL>::value) tape(points.data(), into, m);
+                    else tape.template evaluate<F>(points.data(), into, m);
+                    if (direct) {
+                        runs.clear();
+                    } else if (where) {
+                        for (size_t j = 0; j < m; ++j) std::memcpy(targets[j], &values[j], sizeof(U));
+                    } else {
+                        U const *from = values.data();
+                        for (auto const &[to, count] : runs) {
+                            for (size_t j = 0; j < count; ++j) std::memcpy(to + static_cast<ptrdiff_t>(j) * inner.result, from++, sizeof(U));
+                        }
+                        runs.clear();
+                    }
+                    m = 0;
+                }
+            }
+        });
+    }
+
+    template<typename Dom, typename Ran>
+    void CFunction<Dom, Ran>::grid(COMPLEX const lo, COMPLEX const hi, size_t const nx, size_t const ny, Grid const output,
+                                   size_t const block, void *RESTRICT result) const {
+        static_assert(!is_real<Dom>, "grids are of the complex plane");
+        if (block == 0 || (block > 1 && output != GRID_ABS)) throw std::invalid_argument("only moduli are taken over blocks of points");
+        if (nx == 0 || ny == 0) return;
+        // Spaced as np.linspace spaces them, with the last point exactly at hi.
+        REAL const dx = nx > 1 ? (std::real(hi) - std::real(lo)) / static_cast<REAL>(nx - 1) : 0.;
+        REAL const dy = ny > 1 ? (std::imag(hi) - std::imag(lo)) / static_cast<REAL>(ny - 1) : 0.;
+        auto const re = [&](size_t const j) { return nx > 1 && j == nx - 1 ? std::real(hi) : std::real(lo) + static_cast<REAL>(j) * dx; };
+        auto const im = [&](size_t const k) { return ny > 1 && k == ny - 1 ? std::imag(hi) : std::imag(lo) + static_cast<REAL>(k) * dy; };
+
+        // Every task runs over bands of block rows, each in tiles of as many columns as the array path splits arrays
+        // into, so that the points and values of a tile stay in cache; values are written in place.
+        size_t const rows = (ny + block - 1) / block, cols = (nx + block - 1) / block;
+        size_t const tile = std::min(nx, std::max(block, PARALLEL_GRAIN / block * block));
+        Tape const &tape = *this->_tape();
+        ThreadPool::instance().parallel_for(rows, std::max<size_t>(1, PARALLEL_GRAIN / (nx * block)), [&](size_t const begin, size_t const end) {
+            std::vector<Dom> z(tile);
+            std::vector<Ran> values(output == GRID_VALUE ? 0 : tile);
+            for (size_t r = begin; r < end; ++r) {
+                for (size_t c = 0; c < nx; c += tile) {
+                    size_t const m = std::min(tile, nx - c);
+                    REAL *RESTRICT cells = static_cast<REAL *>(result) + r * cols + c / block;
+                    if (block > 1) std::fill_n(cells, (m + block - 1) / block, std::numeric_limits<REAL>::quiet_NaN());
+                    for (size_t k = r * block; k < std::min(ny, (r + 1) * block); ++k) {
+                        REAL const y = im(k);
+                        for (size_t j = 0; j < m; ++j) z[j] = Dom{re(c + j), y};
+                        if (output == GRID_VALUE) {
+                            tape(z.data(), static_cast<Ran *>(result) + k * nx + c, m);
+                            continue;
+                        }
+                        tape(z.data(), values.data(), m);
+                        REAL *RESTRICT out = static_cast<REAL *>(result) + k * nx + c;
+                        if (block > 1) {
+                            // NaNs are skipped, unless every value of a block is one.
+                            for (size_t j = 0; j < m; ++j) cells[j / block] = std::fmax(cells[j / block], std::abs(values[j]));
+                        } else if (output == GRID_ABS) {
+                            for (size_t j = 0; j < m; ++j) out[j] = std::abs(values[j]);
+                        } else {
+                            for (size_t j = 0; j < m; ++j) out[j] = std::arg(values[j]);
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    template<typename Dom, typename Ran>
+    CFunction<Dom, Ran> CFunction<Dom, Ran>::approximate(REAL const a, REAL const b, REAL const tol) const {
+        static_assert(is_real<Dom>, "only functions of a real variable are approximated");
+        auto const sample = [this](REAL const *RESTRICT t, COMPLEX *RESTRICT values, size_t const n) {
+            if constexpr (is_real<Ran>) {
+                std::vector<REAL> real_values(n);
+                (*this)(t, real_values.data(), n);
+                std::copy_n(real_values.begin(), n, values);
+            } else {
+                (*this)(t, values, n);
+            }
+        };
+        auto chebyshev = std::make_shared<Tape::Chebyshev>(Tape::Chebyshev::fit(sample, a, b, tol));
+        chebyshev->latex = this->_latex;
+        return CFunction::Approximation(chebyshev, this->_last_op);
     }
 
     template<typename Dom, typename Ran>
     std::string CFunction<Dom, Ran>::latex(std::string const &varname) const {
-        return std::regex_replace(this->_latex, std::regex(LATEX_VAR), varname);
+        return Latex::with_var(this->_latex->render(), varname);
+    }
+
+    template<typename Dom, typename Ran>
+    size_t CFunction<Dom, Ran>::memory() const {
+        std::unordered_set<void const *> seen;
+        size_t result = sizeof(CFunction) + this->_latex->memory(seen) + this->_expr->memory(seen);
+        if (this->_operand) result += sizeof(CFunction) + this->_operand->_latex->memory(seen) + this->_operand->_expr->memory(seen);
+        return result;
     }
 
     template<typename Dom, typename Ran>
     template<typename Predom>
     CFunction<Predom, Ran> CFunction<Dom, Ran>::compose(CFunction<Predom, Dom> const &rhs) const {
-        std::string new_latex = std::regex_replace(this->_latex, std::regex(LATEX_VAR),
-                                                   Latex::parenthesize_if(rhs._latex, OP_TYPE::COMP, rhs._last_op));
-        return CFunction<Predom, Ran>([lhs_f = this->_f, rhs_f = rhs._f](Predom z) { return lhs_f(rhs_f(z)); }, new_latex, this->_last_op);
+        if (this->_is_constant()) return CFunction<Predom, Ran>::Constant(this->_constant());
+        if (rhs._is_constant()) return CFunction<Predom, Ran>::Constant((*this)(rhs._constant()));
+        if (!PRESERVE_NAN) {
+            if constexpr (std::is_same<Predom, Dom>::value) {
+                if (rhs._expr->identity()) return *this;
+            }
+            if constexpr (std::is_same<Dom, Ran>::value) {
+                if (this->_expr->identity()) return rhs;
+                // Preset functions undo their inverses: exp(ln(f)) = f, conj(conj(f)) = f.
+                OPCODE const op = this->_expr->last(), inner = rhs._expr->last();
+                if (this->_expr->single() && ((op == OPCODE::EXP && inner == OPCODE::LN) ||
+                                              (op == OPCODE::CONJ && inner == OPCODE::CONJ))) {
+                    if (rhs._operand) return *rhs._operand;
+                    if (rhs._expr->single()) return CFunction<Predom, Ran>();
+                }
+            }
+        }
+
+        Latex::Text::ptr const new_latex = Latex::Text::Substitute(this->_latex, Latex::parenthesize_if(rhs._latex, OP_TYPE::COMP, rhs._last_op));
+        if constexpr (std::is_same<Dom, Ran>::value) {
+            if (this->_expr->single()) return CFunction<Predom, Ran>(Expr::Compose(this->_expr, rhs._expr), new_latex, this->_last_op, rhs);
+        }
+        return CFunction<Predom, Ran>(Expr::Compose(this->_expr, rhs._expr), new_latex, this->_last_op);
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> &CFunction<Dom, Ran>::operator+=(CFunction<Dom, Ran> const &rhs) {
-        this->_f = [lhs_f = this->_f, rhs_f = rhs._f](Dom const z) noexcept { return lhs_f(z) + rhs_f(z); };
-        this->_latex = Latex::parenthesize_if(this->_latex, OP_TYPE::ADD, this->_last_op);
-        this->_latex.append(" + ");
-        this->_latex.append(Latex::parenthesize_if(rhs._latex, OP_TYPE::ADD, rhs._last_op));
+        if (rhs._is_constant()) return *this = *this + rhs._constant();
+        if (this->_is_constant()) return *this = rhs + this->_constant();
+        this->_expr = Expr::Binary(OPCODE::ADD, this->_expr, rhs._expr);
+        this->_latex = Latex::join({Latex::parenthesize_if(this->_latex, OP_TYPE::ADD, this->_last_op), " + ",
+                                    Latex::parenthesize_if(rhs._latex, OP_TYPE::ADD, rhs._last_op)});
         this->_last_op = OP_TYPE::ADD;
+        this->_operand.reset();
         return *this;
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> &CFunction<Dom, Ran>::operator-=(CFunction<Dom, Ran> const &rhs) {
-        this->_f = [lhs_f = this->_f, rhs_f = rhs._f](Dom const z) noexcept { return lhs_f(z) - rhs_f(z); };
-        this->_latex = Latex::parenthesize_if(this->_latex, OP_TYPE::SUB, this->_last_op);
-        this->_latex.append(" - ");
-        this->_latex.append(Latex::parenthesize_if(rhs._latex, OP_TYPE::SUB, rhs._last_op));
+        if (rhs._is_constant()) return *this = *this - rhs._constant();
+        if (this->_is_constant()) return *this = this->_constant() - rhs;
+        this->_expr = Expr::Binary(OPCODE::SUB, this->_expr, rhs._expr);
+        this->_latex = Latex::join({Latex::parenthesize_if(this->_latex, OP_TYPE::SUB, this->_last_op), " - ",
+                                    Latex::parenthesize_if(rhs._latex, OP_TYPE::SUB, rhs._last_op)});
         this->_last_op = OP_TYPE::SUB;
+        this->_operand.reset();
         return *this;
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> &CFunction<Dom, Ran>::operator*=(CFunction<Dom, Ran> const &rhs) {
-        this->_f = [lhs_f = this->_f, rhs_f = rhs._f](Dom const z) noexcept { return lhs_f(z) * rhs_f(z); };
-        this->_latex = Latex::parenthesize_if(this->_latex, OP_TYPE::MUL, this->_last_op);
-        this->_latex.append((rhs._last_op == OP_TYPE::MULCONST || rhs._last_op == OP_TYPE::CONST) ? " \\cdot ": " ");
-        this->_latex.append(Latex::parenthesize_if(rhs._latex, OP_TYPE::MUL, rhs._last_op));
+        if (rhs._is_constant()) return *this = *this * rhs._constant();
+        if (this->_is_constant()) return *this = rhs * this->_constant();
+        this->_expr = Expr::Binary(OPCODE::MUL, this->_expr, rhs._expr);
+        this->_latex = Latex::join({Latex::parenthesize_if(this->_latex, OP_TYPE::MUL, this->_last_op),
+                                    (rhs._last_op == OP_TYPE::MULCONST || rhs._last_op == OP_TYPE::CONST) ? " \\cdot ": " ",
+                                    Latex::parenthesize_if(rhs._latex, OP_TYPE::MUL, rhs._last_op)});
         this->_last_op = this->_last_op == OP_TYPE::CONST || this->_last_op == OP_TYPE::MULCONST ? OP_TYPE::MULCONST : OP_TYPE::MUL;
+        this->_operand.reset();
         return *this;
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> &CFunction<Dom, Ran>::operator/=(CFunction<Dom, Ran> const &rhs) {
-        this->_f = [lhs_f = this->_f, rhs_f = rhs._f](Dom const z) noexcept { return lhs_f(z) / rhs_f(z); };
-        std::string new_latex = " \\frac{";
-        new_latex.append(Latex::parenthesize_if(this->_latex, OP_TYPE::DIV, this->_last_op));
-        new_latex.append("}{");
-        new_latex.append(Latex::parenthesize_if(rhs._latex, OP_TYPE::DIV, rhs._last_op));
-        new_latex.append("}");
-        this->_latex = new_latex;
+        if (rhs._is_constant()) return *this = *this / rhs._constant();
+        if (this->_is_constant()) return *this = this->_constant() / rhs;
+        this->_expr = Expr::Binary(OPCODE::DIV, this->_expr, rhs._expr);
+        this->_latex = Latex::join({" \\frac{", Latex::parenthesize_if(this->_latex, OP_TYPE::DIV, this->_last_op), "}{",
+                                    Latex::parenthesize_if(rhs._latex, OP_TYPE::DIV, rhs._last_op), "}"});
         this->_last_op = OP_TYPE::DIV;
+        this->_operand.reset();
         return *this;
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> &CFunction<Dom, Ran>::ipow(CFunction<Dom, Ran> const &rhs) {
-        this->_f = [lhs_f = this->_f, rhs_f = rhs._f](Dom const z) noexcept { return std::pow(lhs_f(z), rhs_f(z)); };
-        std::string new_latex = "{";
-        new_latex.append(Latex::parenthesize_if(this->_latex, OP_TYPE::LPOW, this->_last_op));
-        new_latex.append("}^{");
-        new_latex.append(Latex::parenthesize_if(rhs._latex, OP_TYPE::RPOW, rhs._last_op));
-        new_latex.append("}");
-        this->_latex = new_latex;
-        this->_last_op = OP_TYPE::LPOW;
-        return *this;
+        return *this = this->pow(rhs);
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> &CFunction<Dom, Ran>::operator+=(Ran const c) {
-        if (!Traits<Ran>::close(c, 0)) {
-            this->_f = [c = c, old_f = this->_f](Dom const z) noexcept { return old_f(z) + c; };
-            this->_latex.append(" + ");
-            this->_latex.append(Latex::fmt_const(c, true));
-            this->_last_op = OP_TYPE::ADD;
-        }
+        if (PRESERVE_NAN || !Traits<Ran>::close(c, 0)) *this = *this + c;
         return *this;
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> &CFunction<Dom, Ran>::operator-=(Ran const c) {
-        if (!Traits<Ran>::close(c, 0)) {
-            this->_f = [c = c, old_f = this->_f](Dom const z) noexcept { return old_f(z) - c; };
-            this->_latex.append(" - ");
-            this->_latex.append(Latex::fmt_const(c, true));
-            this->_last_op = OP_TYPE::SUB;
-        }
+        if (PRESERVE_NAN || !Traits<Ran>::close(c, 0)) *this = *this - c;
         return *this;
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> &CFunction<Dom, Ran>::operator*=(Ran const c) {
-        if (!Traits<Ran>::close(c, 1)) {
-            this->_f = [c = c, old_f = this->_f](Dom const z) noexcept { return c * old_f(z); };
-            std::string new_latex = Latex::fmt_const(c, true);
-            new_latex.append((this->_last_op == OP_TYPE::MULCONST || this->_last_op == OP_TYPE::CONST) ? " \\cdot " : " ");
-            new_latex.append(Latex::parenthesize_if(this->_latex, OP_TYPE::MUL, this->_last_op));
-            this->_latex = new_latex;
-            this->_last_op = OP_TYPE::MULCONST;
-        }
+        if (PRESERVE_NAN || !Traits<Ran>::close(c, 1)) *this = *this * c;
         return *this;
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> &CFunction<Dom, Ran>::operator/=(Ran const c) {
-        if (!Traits<Ran>::close(c, 1)) {
-            this->_f = [c = c, old_f = this->_f](Dom const z) noexcept { return old_f(z) / c; };
-            std::string new_latex = " \\frac{";
-            new_latex.append(Latex::parenthesize_if(this->_latex, OP_TYPE::DIV, this->_last_op));
-            new_latex.append("}{");
-            new_latex.append(Latex::fmt_const(c, false));
-            new_latex.append("}");
-            this->_latex = new_latex;
-            this->_last_op = OP_TYPE::DIV;
-        }
+        if (PRESERVE_NAN || !Traits<Ran>::close(c, 1)) *this = *this / c;
         return *this;
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> &CFunction<Dom, Ran>::ipow(Ran const c) {
-        this->_f = [lhs_f = this->_f, c = c](Dom const z) noexcept { return std::pow(lhs_f(z), c); };
-        std::string new_latex = "{";
-        new_latex.append(Latex::parenthesize_if(this->_latex, OP_TYPE::LPOW, this->_last_op));
-        new_latex.append("}^{");
-        new_latex.append(Latex::fmt_const(c, false));
-        new_latex.append("}");
-        this->_latex = new_latex;
-        this->_last_op = OP_TYPE::LPOW;
-        return *this;
+        return *this = this->pow(c);
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> CFunction<Dom, Ran>::operator-() const {
-        std::string new_latex = "-";
-        new_latex.append(Latex::parenthesize_if(this->_latex, OP_TYPE::NEG, this->_last_op));
-        return CFunction<Dom, Ran>([old_f = this->_f](Dom const z) noexcept { return -old_f(z); }, new_latex, OP_TYPE::NEG);
+        if (this->_is_constant()) return CFunction<Dom, Ran>::Constant(-this->_constant());
+        if (!PRESERVE_NAN) {
+            if (this->_last_is(OPCODE::NEG)) return *this->_operand; // -(-f) = f
+            if (this->_last_is(OPCODE::MULC)) return *this->_operand * -this->_constant(); // -(a f) = (-a) f
+            if (this->_last_is(OPCODE::CSUB)) return *this->_operand - this->_constant(); // -(a - f) = f - a
+        }
+        Latex::Text::ptr const new_latex = Latex::join({"-", Latex::parenthesize_if(this->_latex, OP_TYPE::NEG, this->_last_op)});
+        return CFunction<Dom, Ran>(Expr::Unary(OPCODE::NEG, this->_expr), new_latex, OP_TYPE::NEG, *this);
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> CFunction<Dom, Ran>::pow(CFunction const &rhs) const {
-        std::string new_latex = "{";
-        new_latex.append(Latex::parenthesize_if(this->_latex, OP_TYPE::LPOW, this->_last_op));
-        new_latex.append("}^{");
-        new_latex.append(Latex::parenthesize_if(rhs._latex, OP_TYPE::RPOW, rhs._last_op));
-        new_latex.append("}");
-        return CFunction<Dom, Ran>([lhs_f = this->_f, rhs_f = rhs._f](Dom const z) noexcept { return std::pow(lhs_f(z), rhs_f(z)); }, new_latex, OP_TYPE::LPOW);
+        if (rhs._is_constant()) return this->pow(rhs._constant());
+        if (this->_is_constant()) return rhs.lpow(this->_constant());
+        Latex::Text::ptr const new_latex = Latex::join({"{", Latex::parenthesize_if(this->_latex, OP_TYPE::LPOW, this->_last_op), "}^{",
+                                                        Latex::parenthesize_if(rhs._latex, OP_TYPE::RPOW, rhs._last_op), "}"});
+        return CFunction<Dom, Ran>(Expr::Binary(OPCODE::POW, this->_expr, rhs._expr), new_latex, OP_TYPE::LPOW);
     }
 
+    /* Function-with-constant operators fold constants, drop identity operations and merge chains of constant
+     * operations: (f + a) + b = f + (a + b), (a f) / b = (a / b) f, and so on. Under PRESERVE_NAN only the folding
+     * is done, since the other rewrites may change overflows, NaNs and the signs of zeros. */
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> operator+(CFunction<Dom, Ran> const &lhs, Ran const c) {
-        std::string new_latex = lhs._latex;
-        new_latex.append(" + ");
-        new_latex.append(Latex::fmt_const(c, true));
-        return CFunction<Dom, Ran>([c = c, lhs_f = lhs._f](Dom const z) noexcept { return lhs_f(z) + c; }, new_latex, OP_TYPE::ADD);
+        if (lhs._is_constant()) return CFunction<Dom, Ran>::Constant(lhs._constant() + c);
+        if (!PRESERVE_NAN) {
+            if (c == Ran{0}) return lhs;
+            if (lhs._last_is(OPCODE::ADDC)) return CFunction<Dom, Ran>::_shift(*lhs._operand, lhs._constant() + c);
+            if (lhs._last_is(OPCODE::SUBC)) return CFunction<Dom, Ran>::_shift(*lhs._operand, c - lhs._constant());
+            if (lhs._last_is(OPCODE::CSUB)) return (lhs._constant() + c) - *lhs._operand;
+        }
+        Latex::Text::ptr const new_latex = Latex::join({lhs._latex, " + ", Latex::fmt_const(c, true)});
+        return CFunction<Dom, Ran>(Expr::WithConst(OPCODE::ADDC, lhs._expr, c), new_latex, OP_TYPE::ADD, lhs);
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> operator-(CFunction<Dom, Ran> const &lhs, Ran const c) {
-        std::string new_latex = lhs._latex;
-        new_latex.append(" - ");
-        new_latex.append(Latex::fmt_const(c, true));
-        return CFunction<Dom, Ran>([c = c, lhs_f = lhs._f](Dom const z) noexcept { return lhs_f(z) - c; }, new_latex, OP_TYPE::SUB);
+        if (lhs._is_constant()) return CFunction<Dom, Ran>::Constant(lhs._constant() - c);
+        if (!PRESERVE_NAN) {
+            if (c == Ran{0}) return lhs;
+            if (lhs._last_is(OPCODE::ADDC)) return CFunction<Dom, Ran>::_shift(*lhs._operand, lhs._constant() - c);
+            if (lhs._last_is(OPCODE::SUBC)) return CFunction<Dom, Ran>::_shift(*lhs._operand, -(lhs._constant() + c));
+            if (lhs._last_is(OPCODE::CSUB)) return (lhs._constant() - c) - *lhs._operand;
+        }
+        Latex::Text::ptr const new_latex = Latex::join({lhs._latex, " - ", Latex::fmt_const(c, true)});
+        return CFunction<Dom, Ran>(Expr::WithConst(OPCODE::SUBC, lhs._expr, c), new_latex, OP_TYPE::SUB, lhs);
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> operator*(CFunction<Dom, Ran> const &lhs, Ran const c) {
-        std::string new_latex = Latex::fmt_const(c, true);
-        new_latex.append(lhs._last_op == OP_TYPE::MULCONST ? " \\cdot " : " ");
-        new_latex.append(Latex::parenthesize_if(lhs._latex, OP_TYPE::MUL, lhs._last_op));
-        return CFunction<Dom, Ran>([c = c, lhs_f = lhs._f](Dom const z) noexcept { return lhs_f(z) * c; }, new_latex, OP_TYPE::MULCONST);
+        if (lhs._is_constant()) return CFunction<Dom, Ran>::Constant(lhs._constant() * c);
+        if (!PRESERVE_NAN) {
+            if (c == Ran{1}) return lhs;
+            if (c == Ran{0}) return CFunction<Dom, Ran>::Constant(0);
+            if (c == Ran{-1}) return -lhs;
+            if (lhs._last_is(OPCODE::MULC)) return *lhs._operand * (lhs._constant() * c);
+            if (lhs._last_is(OPCODE::DIVC)) return *lhs._operand * (c / lhs._constant());
+            if (lhs._last_is(OPCODE::CDIV)) return (lhs._constant() * c) / *lhs._operand;
+            if (lhs._last_is(OPCODE::NEG)) return *lhs._operand * -c;
+        }
+        Latex::Text::ptr const new_latex = Latex::join({Latex::fmt_const(c, true),
+                                                        (lhs._last_op == OP_TYPE::MULCONST || lhs._last_op == OP_TYPE::CONST) ? " \\cdot " : " ",
+                                                        Latex::parenthesize_if(lhs._latex, OP_TYPE::MUL, lhs._last_op)});
+        return CFunction<Dom, Ran>(Expr::WithConst(OPCODE::MULC, lhs._expr, c), new_latex, OP_TYPE::MULCONST, lhs);
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> operator/(CFunction<Dom, Ran> const &lhs, Ran const c) {
-        std::string new_latex = " \\frac{";
-        new_latex.append(Latex::parenthesize_if(lhs._latex, OP_TYPE::DIV, lhs._last_op));
-        new_latex.append("}{");
-        new_latex.append(Latex::fmt_const(c, false));
-        new_latex.append("}");
-        return CFunction<Dom, Ran>([c = c, lhs_f = lhs._f](Dom const z) noexcept { return lhs_f(z) / c; }, new_latex, OP_TYPE::DIV);
+        if (lhs._is_constant()) return CFunction<Dom, Ran>::Constant(lhs._constant() / c);
+        if (!PRESERVE_NAN) {
+            if (c == Ran{1}) return lhs;
+            if (lhs._last_is(OPCODE::MULC)) return *lhs._operand * (lhs._constant() / c);
+            if (lhs._last_is(OPCODE::DIVC)) return *lhs._operand / (lhs._constant() * c);
+            if (lhs._last_is(OPCODE::CDIV)) return (lhs._constant() / c) / *lhs._operand;
+        }
+        Latex::Text::ptr const new_latex = Latex::join({" \\frac{", Latex::parenthesize_if(lhs._latex, OP_TYPE::DIV, lhs._last_op), "}{",
+                                                        Latex::fmt_const(c, false), "}"});
+        return CFunction<Dom, Ran>(Expr::WithConst(OPCODE::DIVC, lhs._expr, c), new_latex, OP_TYPE::DIV, lhs);
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> operator-(Ran const c, CFunction<Dom, Ran> const &rhs) {
-        std::string new_latex = Latex::fmt_const(c, false);
-        new_latex.append(" - ");
-        new_latex.append(Latex::parenthesize_if(rhs._latex, OP_TYPE::SUB, rhs._last_op));
-        return CFunction<Dom, Ran>([c = c, rhs_f = rhs._f](Dom const z) noexcept { return c - rhs_f(z); }, new_latex, OP_TYPE::SUB);
+        if (rhs._is_constant()) return CFunction<Dom, Ran>::Constant(c - rhs._constant());
+        if (!PRESERVE_NAN) {
+            if (c == Ran{0}) return -rhs;
+            if (rhs._last_is(OPCODE::NEG)) return *rhs._operand + c;
+            if (rhs._last_is(OPCODE::ADDC)) return (c - rhs._constant()) - *rhs._operand;
+            if (rhs._last_is(OPCODE::SUBC)) return (c + rhs._constant()) - *rhs._operand;
+            if (rhs._last_is(OPCODE::CSUB)) return CFunction<Dom, Ran>::_shift(*rhs._operand, c - rhs._constant());
+        }
+        Latex::Text::ptr const new_latex = Latex::join({Latex::fmt_const(c, false), " - ", Latex::parenthesize_if(rhs._latex, OP_TYPE::SUB, rhs._last_op)});
+        return CFunction<Dom, Ran>(Expr::WithConst(OPCODE::CSUB, rhs._expr, c), new_latex, OP_TYPE::SUB, rhs);
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> operator/(Ran const c, CFunction<Dom, Ran> const &rhs) {
-        std::string new_latex = " \\frac{";
-        new_latex.append(Latex::fmt_const(c, false));
-        new_latex.append("}{");
-        new_latex.append(Latex::parenthesize_if(rhs._latex, OP_TYPE::DIV, rhs._last_op));
-        new_latex.append("}");
-        return CFunction<Dom, Ran>([c = c, rhs_f = rhs._f](Dom const z) noexcept { return c / rhs_f(z); }, new_latex, OP_TYPE::DIV);
+        if (rhs._is_constant()) return CFunction<Dom, Ran>::Constant(c / rhs._constant());
+        if (!PRESERVE_NAN) {
+            if (c == Ran{0}) return CFunction<Dom, Ran>::Constant(0);
+            if (rhs._last_is(OPCODE::MULC)) return (c / rhs._constant()) / *rhs._operand;
+            if (rhs._last_is(OPCODE::DIVC)) return (c * rhs._constant()) / *rhs._operand;
+            if (rhs._last_is(OPCODE::CDIV)) return *rhs._operand * (c / rhs._constant());
+        }
+        Latex::Text::ptr const new_latex = Latex::join({" \\frac{", Latex::fmt_const(c, false), "}{",
+                                                        Latex::parenthesize_if(rhs._latex, OP_TYPE::DIV, rhs._last_op), "}"});
+        return CFunction<Dom, Ran>(Expr::WithConst(OPCODE::CDIV, rhs._expr, c), new_latex, OP_TYPE::DIV, rhs);
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> CFunction<Dom, Ran>::pow(Ran const c) const {
-        std::string new_latex = "{";
-        new_latex.append(Latex::parenthesize_if(this->_latex, OP_TYPE::LPOW, this->_last_op));
-        new_latex.append("}^{");
-        new_latex.append(Latex::fmt_const(c, false));
-        new_latex.append("}");
-        return CFunction<Dom, Ran>([c = c, old_f = this->_f](Dom const z) noexcept { return std::pow(old_f(z), c); }, new_latex, OP_TYPE::LPOW);
+        if (this->_is_constant()) return CFunction<Dom, Ran>::Constant(std::pow(this->_constant(), c));
+        if (!PRESERVE_NAN) {
+            if (c == Ran{1}) return *this;
+            if (c == Ran{0}) return CFunction<Dom, Ran>::Constant(1);
+        }
+        Latex::Text::ptr const new_latex = Latex::join({"{", Latex::parenthesize_if(this->_latex, OP_TYPE::LPOW, this->_last_op), "}^{",
+                                                        Latex::fmt_const(c, false), "}"});
+        return CFunction<Dom, Ran>(Expr::WithConst(OPCODE::POWC, this->_expr, c), new_latex, OP_TYPE::LPOW, *this);
     }
 
     template<typename Dom, typename Ran>
     CFunction<Dom, Ran> CFunction<Dom, Ran>::lpow(Ran const c) const {
-        std::string new_latex = "{";
-        new_latex.append(Latex::fmt_const(c, true));
-        new_latex.append("}^{");
-        new_latex.append(Latex::parenthesize_if(this->_latex, OP_TYPE::LPOW, this->_last_op));
-        new_latex.append("}");
-        return CFunction<Dom, Ran>([c = c, old_f = this->_f](Dom const z) noexcept { return std::pow(c, old_f(z)); }, new_latex, OP_TYPE::LPOW);
+        if (this->_is_constant()) return CFunction<Dom, Ran>::Constant(std::pow(c, this->_constant()));
+        if (c == Ran{1} && !PRESERVE_NAN) return CFunction<Dom, Ran>::Constant(1);
+        Latex::Text::ptr const new_latex = Latex::join({"{", Latex::fmt_const(c, true), "}^{",
+                                                        Latex::parenthesize_if(this->_latex, OP_TYPE::LPOW, this->_last_op), "}"});
+        return CFunction<Dom, Ran>(Expr::WithConst(OPCODE::CPOW, this->_expr, c), new_latex, OP_TYPE::LPOW, *this);
+    }
+
+    template<typename Dom, typename Ran>
+    template<typename Predicate>
+    CComparison<Dom> CFunction<Dom, Ran>::_compare(CFunction const &rhs, char const *symbol, Condition::Kind const kind,
+                                                   Predicate const &predicate) const {
+        Latex::Text::ptr const new_latex = Latex::join({this->_latex, symbol, rhs._latex});
+        // Over arrays, both functions run through the array path before their values are compared.
+        return CComparison<Dom>([lhs_f = *this, rhs_f = rhs, predicate](Dom const z) noexcept { return predicate(lhs_f(z), rhs_f(z)); },
+                                [lhs_f = *this, rhs_f = rhs, predicate](Dom const *RESTRICT z, uint64_t *RESTRICT mask, size_t const n) {
+                                    std::vector<Ran> lhs_values(n), rhs_values(n);
+                                    lhs_f(z, lhs_values.data(), n);
+                                    rhs_f(z, rhs_values.data(), n);
+                                    pack_mask(mask, n, [&](size_t const j) { return predicate(lhs_values[j], rhs_values[j]); });
+                                }, new_latex, std::make_shared<Condition const>(Condition{kind, is_real<Ran>, this->_expr, rhs._expr}));
     }
 
     template<typename Dom, typename Ran>
     CComparison<Dom> CFunction<Dom, Ran>::operator>(CFunction<Dom, Ran> const &rhs) const {
-        std::string new_latex = this->_latex;
-        new_latex.append(" > ");
-        new_latex.append(rhs._latex);
-        return CComparison<Dom>([lhs_f = this->_f, rhs_f = rhs._f](Dom const z) noexcept { return lhs_f(z) > rhs_f(z); },
-                                     new_latex);
+        return this->_compare(rhs, " > ", Condition::Kind::GT, [](Ran const lhs_z, Ran const rhs_z) { return lhs_z > rhs_z; });
     }
 
     template<typename Dom, typename Ran>
     CComparison<Dom> CFunction<Dom, Ran>::operator<(CFunction<Dom, Ran> const &rhs) const {
-        std::string new_latex = this->_latex;
-        new_latex.append(" < ");
-        new_latex.append(rhs._latex);
-        return CComparison<Dom>([lhs_f = this->_f, rhs_f = rhs._f](Dom const z) noexcept { return lhs_f(z) < rhs_f(z); },
-                                     new_latex);
+        return this->_compare(rhs, " < ", Condition::Kind::LT, [](Ran const lhs_z, Ran const rhs_z) { return lhs_z < rhs_z; });
     }
 
     template<typename Dom, typename Ran>
     CComparison<Dom> CFunction<Dom, Ran>::operator==(CFunction<Dom, Ran> const &rhs) const {
-        std::string new_latex = this->_latex;
-        new_latex.append(" \\eq ");
-        new_latex.append(rhs._latex);
-        return CComparison<Dom>([lhs_f = this->_f, rhs_f = rhs._f](Dom const z) noexcept {
-            return Traits<Ran>::close(lhs_f(z), rhs_f(z));
-        }, new_latex);
+        return this->_compare(rhs, " \\eq ", Condition::Kind::EQ, [](Ran const lhs_z, Ran const rhs_z) { return Traits<Ran>::close(lhs_z, rhs_z); });
     }
 
     template<typename Dom, typename Ran>
     CComparison<Dom> CFunction<Dom, Ran>::operator>=(CFunction<Dom, Ran> const &rhs) const {
-        std::string new_latex = this->_latex;
-        new_latex.append(" \\ge ");
-        new_latex.append(rhs._latex);
-        return CComparison<Dom>([lhs_f = this->_f, rhs_f = rhs._f](Dom const z) noexcept { return lhs_f(z) >= rhs_f(z) || Traits<Ran>::close(lhs_f(z), rhs_f(z)); },
-                                     new_latex);
+        return this->_compare(rhs, " \\ge ", Condition::Kind::GE, [](Ran const lhs_z, Ran const rhs_z) { return lhs_z >= rhs_z || Traits<Ran>::close(lhs_z, rhs_z); });
     }
 
     template<typename Dom, typename Ran>
     CComparison<Dom> CFunction<Dom, Ran>::operator<=(CFunction<Dom, Ran> const &rhs) const {
-        std::string new_latex = this->_latex;
-        new_latex.append(" \\le ");
-        new_latex.append(rhs._latex);
-        return CComparison<Dom>([lhs_f = this->_f, rhs_f = rhs._f](Dom const z) noexcept { return lhs_f(z) <= rhs_f(z) || Traits<Ran>::close(lhs_f(z), rhs_f(z)); },
-                                     new_latex);
+        return this->_compare(rhs, " \\le ", Condition::Kind::LE, [](Ran const lhs_z, Ran const rhs_z) { return lhs_z <= rhs_z || Traits<Ran>::close(lhs_z, rhs_z); });
     }
 
     template<typename Dom, typename Ran>
     CComparison<Dom> CFunction<Dom, Ran>::operator!=(CFunction<Dom, Ran> const &rhs) const {
-        std::string new_latex = this->_latex;
-        new_latex.append(" \\ne ");
-        new_latex.append(rhs._latex);
-        return CComparison<Dom>([lhs_f = this->_f, rhs_f = rhs._f](Dom const z) noexcept {
-            return !Traits<Ran>::close(lhs_f(z), rhs_f(z));
-        }, new_latex);
+        return this->_compare(rhs, " \\ne ", Condition::Kind::NE, [](Ran const lhs_z, Ran const rhs_z) { return !Traits<Ran>::close(lhs_z, rhs_z); });
     }
 }
@@ -12,6 +12,9 @@ cdef class Comparison:
     self.realcomparison = realcomparison.copy() if realcomparison is not None else None
     self.complexcomparison = complexcomparison.copy() if complexcomparison is not None else None
 
+  def __reduce__(Comparison self):
+    return Comparison, (self.realcomparison, self.complexcomparison)
+
   def __call__(Comparison self, x):
     """Evaluate the comparison at a point or on an np.ndarray of points."""
     if self.realcomparison is None and self.complexcomparison is None:
@@ -9,10 +9,17 @@ cdef class ComplexComparison:
   @cython.boundscheck(False)
   @cython.wraparound(False)
   cdef np.ndarray[cbool] _call_array(ComplexComparison self, np.ndarray[const COMPLEX] z):
-    cdef np.ndarray[cbool] result = np.zeros_like(z, dtype=bool)
-    for i in range(z.shape[0]):
-      result[i] = self.ccomparison.eval(z[i])
-    return result
+    """Evaluate the comparison on an np.ndarray, into a mask of bits that is then unpacked."""
+    cdef size_t i, n = z.shape[0]
+    cdef uint64_t[::1] mask = np.empty((n + 63) // 64 + 1, dtype=np.uint64)
+    cdef np.npy_bool[::1] result = np.empty(n, dtype=np.bool_)
+    if n == 0:
+      return np.asarray(result, dtype=bool)
+    with nogil:
+      self.ccomparison._call_array(&z[0], &mask[0], n)
+    for i in range(n):
+      result[i] = (mask[i >> 6] >> (i & 63)) & 1
+    return np.asarray(result, dtype=bool)
 
   def copy(ComplexComparison self):
     """Create a copy of the object."""
@@ -20,6 +27,24 @@ cdef class ComplexComparison:
     result.ccomparison = CComparison[COMPLEX](self.ccomparison)
     return result
 
+  def to_bytes(ComplexComparison self):
+    """The comparison in libcalculus' binary format, which from_bytes(), libcalculus.loads() and pickle read back."""
+    cdef string data
+    with nogil:
+      data = dump_comparison[COMPLEX](self.ccomparison)
+    return <bytes>data
+
+  @staticmethod
+  def from_bytes(const unsigned char[::1] data not None):
+    """Load a comparison from what to_bytes() returned, in bytes or any other buffer such as a memory-mapped file."""
+    cdef ComplexComparison result = ComplexComparison()
+    with nogil:
+      result.ccomparison = load_comparison[COMPLEX](_data(data), data.shape[0])
+    return result
+
+  def __reduce__(ComplexComparison self):
+    return loads, (self.to_bytes(),)
+
   def __call__(ComplexComparison self, z):
     if isinstance(z, (int, float, complex)):
       return self.ccomparison.eval(z)
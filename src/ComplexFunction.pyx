@@ -1,25 +1,23 @@
 # distutils: language = c++
 from CFunction cimport *
-from cython.parallel import prange
 
 cdef class ComplexFunction:
   cdef CFunction[COMPLEX, COMPLEX] cfunction
 
-  @cython.nonecheck(False)
-  @cython.boundscheck(False)
-  @cython.wraparound(False)
-  cdef np.ndarray[COMPLEX] _call_array(ComplexFunction self, np.ndarray[const COMPLEX] z):
-    """Evaluate the function on an np.ndarray."""
-    cdef COMPLEX[::1] result = np.empty(z.size, dtype=complex)
-    cdef size_t i, n = z.size
-    if Globals.NUM_THREADS > 1:
-      # Use threading instead of SIMD.
-      for i in prange(n, nogil=True, num_threads=Globals.NUM_THREADS):
-        result[i] = self.cfunction(z[i])
-    else:
-        # Use SIMD
-        self.cfunction._call_array(&z[0], &result[0], n)
-    return np.asarray(result)
+  cdef _call_array(ComplexFunction self, np.ndarray z, out, where):
+    """Evaluate the function on an np.ndarray of any strides, into out or a new array, where where holds."""
+    dtype = np.result_type(z.dtype, np.complex64) if z.dtype in (np.float32, np.complex64, np.longdouble, np.clongdouble) else np.dtype(complex)
+    cdef _Operands a = _Operands(z, out, where, dtype, dtype)
+    cdef char kind = ord(dtype.char)
+    # The C++ side splits the array between the threads of its pool.
+    with nogil:
+      if kind == b'F':
+        self.cfunction._call_strided(<COMPLEX_SINGLE *>a.z_data, <COMPLEX_SINGLE *>a.out_data, a.where_data, a.ndim, a.shape.data(), a.strides.data())
+      elif kind == b'G':
+        self.cfunction._call_strided(<COMPLEX_EXTENDED *>a.z_data, <COMPLEX_EXTENDED *>a.out_data, a.where_data, a.ndim, a.shape.data(), a.strides.data())
+      else:
+        self.cfunction._call_strided(<COMPLEX *>a.z_data, <COMPLEX *>a.out_data, a.where_data, a.ndim, a.shape.data(), a.strides.data())
+    return a.result()
 
   def copy(ComplexFunction self):
     """Create a copy of the object."""
@@ -27,21 +25,90 @@ cdef class ComplexFunction:
     result.cfunction = CFunction[COMPLEX, COMPLEX](self.cfunction)
     return result
 
-  def __call__(ComplexFunction self, z):
-    """Evaluate the function at a point or on an np.ndarray of points."""
-    if isinstance(z, (int, float, complex)):
+  def __call__(ComplexFunction self, z, out=None, where=True):
+    """Evaluate the function at a point or on an np.ndarray of points; arrays of float32 or complex64 are evaluated in
+    single precision, and of longdouble or clongdouble in extended precision, into arrays of that precision. As with
+    NumPy's ufuncs, the values are written into out if it is given, which z is broadcast to and which they are cast into
+    under the 'same_kind' rule, and only where where holds, and a 0-d array without out gives a scalar; arrays of any
+    strides are read and written in place."""
+    if out is None and where is True and isinstance(z, (int, float, complex)):
       return self.cfunction(z)
-    elif isinstance(z, np.ndarray) and z.dtype == complex:
-      return self._call_array(z.ravel()).reshape(z.shape)
-    elif isinstance(z, np.ndarray) and np.issubdtype(z.dtype, np.number):
-      return self._call_array(z.ravel().astype(complex, copy=False)).reshape(z.shape)
+    elif isinstance(z, (int, float, complex)) or (isinstance(z, np.ndarray) and np.issubdtype(z.dtype, np.number)):
+      return self._call_array(np.asarray(z), out, where)
     else:
       raise NotImplementedError(type(z))
 
+  def evaluate_grid(ComplexFunction self, re_range, im_range, size_t nx, size_t ny, str output="value", size_t downsample=1):
+    """Evaluate the function over the grid of nx real parts from re_range[0] to re_range[1] by ny imaginary parts from
+    im_range[0] to im_range[1], into an array of ny rows of nx values, as over np.meshgrid of their np.linspace but
+    without building the points. output "abs" or "arg" returns only the moduli or the arguments of the values; with
+    "abs", downsample returns the largest modulus over every downsample by downsample block of points instead."""
+    cdef Grid kind
+    if output == "value":
+      kind = GRID_VALUE
+    elif output == "abs":
+      kind = GRID_ABS
+    elif output == "arg":
+      kind = GRID_ARG
+    else:
+      raise ValueError(f"unknown output {output!r}; expected 'value', 'abs' or 'arg'")
+    if downsample == 0 or (downsample > 1 and kind != GRID_ABS):
+      raise ValueError("downsample applies only to output='abs', and must be positive")
+    cdef COMPLEX lo = complex(re_range[0], im_range[0]), hi = complex(re_range[1], im_range[1])
+    cdef size_t rows = (ny + downsample - 1) // downsample, cols = (nx + downsample - 1) // downsample
+    cdef np.ndarray result = np.empty((rows, cols), dtype=complex if kind == GRID_VALUE else float)
+    cdef COMPLEX[:, ::1] values
+    cdef REAL[:, ::1] reals
+    cdef void *data
+    if result.size == 0:
+      return result
+    if kind == GRID_VALUE:
+      values = result
+      data = &values[0, 0]
+    else:
+      reals = result
+      data = &reals[0, 0]
+    with nogil:
+      self.cfunction.grid(lo, hi, nx, ny, kind, downsample, data)
+    return result
+
   def latex(ComplexFunction self, str varname="z"):
     """Generate LaTeX markup for the function."""
     return self.cfunction.latex(varname.encode()).decode()
 
+  def compile(ComplexFunction self):
+    """Compile the function to native code, which evaluates it faster; the result is cached on disk."""
+    cdef ComplexFunction F = ComplexFunction()
+    with nogil:
+      F.cfunction = self.cfunction.compile()
+    return F
+
+  def deduplicated(ComplexFunction self):
+    """The number of operations shared with an identical subexpression instead of being evaluated separately."""
+    return self.cfunction.deduplicated()
+
+  def memory_usage(ComplexFunction self):
+    """The number of bytes the function holds, including the parts it shares with the functions it was built from."""
+    return self.cfunction.memory()
+
+  def to_bytes(ComplexFunction self):
+    """The function in libcalculus' binary format, which from_bytes(), libcalculus.loads() and pickle read back."""
+    cdef string data
+    with nogil:
+      data = dump[COMPLEX, COMPLEX](self.cfunction)
+    return <bytes>data
+
+  @staticmethod
+  def from_bytes(const unsigned char[::1] data not None):
+    """Load a function from what to_bytes() returned, in bytes or any other buffer such as a memory-mapped file."""
+    cdef ComplexFunction F = ComplexFunction()
+    with nogil:
+      F.cfunction = load_function[COMPLEX, COMPLEX](_data(data), data.shape[0])
+    return F
+
+  def __reduce__(ComplexFunction self):
+    return loads, (self.to_bytes(),)
+
   def _compose(ComplexFunction self, ComplexFunction rhs not None):
     """Compose the function with another ComplexFunction."""
     cdef ComplexFunction F = ComplexFunction()
@@ -1,24 +1,22 @@
 # distutils: language = c++
-from cython.parallel import prange
 
 cdef class Contour:
   cdef CFunction[REAL, COMPLEX] cfunction
 
-  @cython.nonecheck(False)
-  @cython.boundscheck(False)
-  @cython.wraparound(False)
-  cdef np.ndarray[REAL] _call_array(Contour self, np.ndarray[const REAL] t):
-    """Evaluate the function on an np.ndarray."""
-    cdef COMPLEX[::1] result = np.empty(t.size, dtype=complex)
-    cdef size_t i, n = t.size
-    if Globals.NUM_THREADS > 1:
-      # Use threading instead of SIMD.
-      for i in prange(n, nogil=True, num_threads=Globals.NUM_THREADS):
-        result[i] = self.cfunction(t[i])
-    else:
-        # Use SIMD
-        self.cfunction._call_array(&t[0], &result[0], n)
-    return np.asarray(result)
+  cdef _call_array(Contour self, np.ndarray t, out, where):
+    """Evaluate the function on an np.ndarray of any strides, into out or a new array, where where holds."""
+    dtype = t.dtype if t.dtype in (np.float32, np.longdouble) else np.dtype(np.double)
+    cdef _Operands a = _Operands(t, out, where, dtype, np.result_type(dtype, np.complex64))
+    cdef char kind = ord(dtype.char)
+    # The C++ side splits the array between the threads of its pool.
+    with nogil:
+      if kind == b'f':
+        self.cfunction._call_strided(<REAL_SINGLE *>a.z_data, <COMPLEX_SINGLE *>a.out_data, a.where_data, a.ndim, a.shape.data(), a.strides.data())
+      elif kind == b'g':
+        self.cfunction._call_strided(<REAL_EXTENDED *>a.z_data, <COMPLEX_EXTENDED *>a.out_data, a.where_data, a.ndim, a.shape.data(), a.strides.data())
+      else:
+        self.cfunction._call_strided(<REAL *>a.z_data, <COMPLEX *>a.out_data, a.where_data, a.ndim, a.shape.data(), a.strides.data())
+    return a.result()
 
   def copy(Contour self):
     """Create a copy of the object."""
@@ -26,14 +24,16 @@ cdef class Contour:
     result.cfunction = CFunction[REAL, COMPLEX](self.cfunction)
     return result
 
-  def __call__(Contour self, t):
-    """Evaluate the function at a point or on an np.ndarray of points."""
-    if isinstance(t, (int, float, complex)):
+  def __call__(Contour self, t, out=None, where=True):
+    """Evaluate the function at a point or on an np.ndarray of points; arrays of float32 are evaluated in single
+    precision, and of longdouble in extended precision, into arrays of that precision. As with NumPy's ufuncs, the
+    values are written into out if it is given, which t is broadcast to and which they are cast into under the
+    'same_kind' rule, and only where where holds, and a 0-d array without out gives a scalar; arrays of any strides are
+    read and written in place."""
+    if out is None and where is True and isinstance(t, (int, float, complex)):
       return self.cfunction(t)
-    elif isinstance(t, np.ndarray) and t.dtype == np.double:
-      return self._call_array(t.ravel()).reshape(t.shape)
-    elif isinstance(t, np.ndarray) and np.issubdtype(t.dtype, np.number):
-      return self._call_array(t.ravel().astype(np.double, copy=False)).reshape(t.shape)
+    elif isinstance(t, (int, float)) or (isinstance(t, np.ndarray) and np.issubdtype(t.dtype, np.number)):
+      return self._call_array(np.asarray(t), out, where)
     else:
       raise NotImplementedError(type(t))
 
@@ -41,6 +41,47 @@ cdef class Contour:
     """Generate LaTeX markup for the function."""
     return self.cfunction.latex(varname.encode()).decode()
 
+  def compile(Contour self):
+    """Compile the function to native code, which evaluates it faster; the result is cached on disk."""
+    cdef Contour F = Contour()
+    with nogil:
+      F.cfunction = self.cfunction.compile()
+    return F
+
+  def approximate(Contour self, REAL a, REAL b, REAL tol = 1e-10):
+    """A piecewise Chebyshev interpolant of the function over [a, b], to within tol times its largest magnitude there
+    (or tol where that is below 1), which is cheap to evaluate, and which is differentiated and integrated exactly."""
+    cdef Contour F = Contour()
+    with nogil:
+      F.cfunction = self.cfunction.approximate(a, b, tol)
+    return F
+
+  def deduplicated(Contour self):
+    """The number of operations shared with an identical subexpression instead of being evaluated separately."""
+    return self.cfunction.deduplicated()
+
+  def memory_usage(Contour self):
+    """The number of bytes the function holds, including the parts it shares with the functions it was built from."""
+    return self.cfunction.memory()
+
+  def to_bytes(Contour self):
+    """The contour in libcalculus' binary format, which from_bytes(), libcalculus.loads() and pickle read back."""
+    cdef string data
+    with nogil:
+      data = dump[REAL, COMPLEX](self.cfunction)
+    return <bytes>data
+
+  @staticmethod
+  def from_bytes(const unsigned char[::1] data not None):
+    """Load a contour from what to_bytes() returned, in bytes or any other buffer such as a memory-mapped file."""
+    cdef Contour F = Contour()
+    with nogil:
+      F.cfunction = load_function[REAL, COMPLEX](_data(data), data.shape[0])
+    return F
+
+  def __reduce__(Contour self):
+    return loads, (self.to_bytes(),)
+
   def _compose_real(Contour self, RealFunction rhs):
     """Compose the contour with a RealFunction, producing another Contour."""
     cdef Contour F = Contour()
@@ -184,6 +225,10 @@ cdef class Contour:
     else:
       raise NotImplementedError(type(lhs), type(rhs))
 
+  def length(Contour self, const REAL start=0., const REAL end=1., const REAL tol=1e-3):
+    """The length of the contour between two values of t; exact for contours of line segments and arcs, and otherwise integrated to a tolerance tol."""
+    return Length(self.cfunction, start, end, tol).value
+
   def index(Contour self, const COMPLEX z0, const REAL start=0., const REAL end=1.):
     """Computes the index of z0 with respect to the contour."""
     assert np.allclose(self(start), self(end)), "Index defined only for closed contour."
@@ -472,11 +517,55 @@ cdef class Contour:
     return F
 
   @staticmethod
-  def Line(const complex z1, const complex z2):
+  def Line(const COMPLEX z1, const COMPLEX z2):
     """A contour that represents a line running from z1 to z2, with t running from 0 to 1."""
-    return (1 - Contour.Identity()) * z1 + Contour.Identity() * z2
+    cdef Contour F = Contour()
+    F.cfunction = CFunction[REAL, COMPLEX].Line(z1, z2)
+    return F
 
   @staticmethod
   def Sphere(const COMPLEX center=0., const REAL radius=1., const cbool ccw=False):
     """A contour that represents a circle around a center with a given a radius, with t running from 0 to 1, possibly running counterclockwise."""
-    return center + (-1. if ccw else 1.) * radius * (ComplexFunction.Exp() @ (2j * M_PI * Contour.Identity()))
+    cdef Contour F = Contour()
+    F.cfunction = CFunction[REAL, COMPLEX].Arc(center, (-1. if ccw else 1.) * radius, 0., 2 * M_PI)
+    return F
+
+  @staticmethod
+  def Arc(const COMPLEX center, const REAL radius, const REAL start_angle, const REAL end_angle):
+    """A contour that represents a circular arc around a center, from start_angle to end_angle, with t running from 0 to 1."""
+    cdef Contour F = Contour()
+    F.cfunction = CFunction[REAL, COMPLEX].Arc(center, radius, start_angle, end_angle)
+    return F
+
+  @staticmethod
+  def Polyline(points, const cbool closed=False):
+    """A contour that represents line segments through a sequence of points, possibly back to the first one, with t running from 0 to 1 at constant speed."""
+    cdef COMPLEX[::1] points_ = np.ascontiguousarray(points, dtype=complex)
+    cdef Contour F = Contour()
+    if points_.shape[0] < 2:
+      raise ValueError("A polyline needs at least two points.")
+    F.cfunction = CFunction[REAL, COMPLEX].Polyline(&points_[0], points_.shape[0], closed)
+    return F
+
+  @staticmethod
+  def Rectangle(const COMPLEX z1, const COMPLEX z2):
+    """A contour that represents the boundary of the rectangle with opposite corners z1 and z2, counterclockwise when z1 is the lower left one, with t running from 0 to 1 at constant speed."""
+    cdef Contour F = Contour()
+    F.cfunction = CFunction[REAL, COMPLEX].Rectangle(z1, z2)
+    return F
+
+  @staticmethod
+  def Concat(*contours):
+    """A contour that represents contours of line segments and arcs one after another, with t running from 0 to 1 and each taking a share of it in proportion to its length."""
+    cdef vector[CFunction[REAL, COMPLEX]] cfunctions
+    cdef Contour F = Contour()
+    for contour in contours:
+      if isinstance(contour, Function):
+        contour = (<Function>contour).contour
+      if not isinstance(contour, Contour):
+        raise TypeError(f"Cannot concatenate {type(contour)}.")
+      cfunctions.push_back((<Contour>contour).cfunction)
+    if cfunctions.size() == 0:
+      raise ValueError("Nothing to concatenate.")
+    F.cfunction = CFunction[REAL, COMPLEX].Concat(cfunctions.data(), cfunctions.size())
+    return F
@@ -0,0 +1,104 @@
+#include "CFunction.h"
+#include <stdexcept>
+
+namespace libcalculus {
+    using Path = Tape::Path;
+    using Contour = CFunction<REAL, COMPLEX>;
+
+    /* The expression of a piece, for the LaTeX output. */
+    static Contour piece_expression(Path::Piece const &piece) {
+        Contour const t, s = piece.start == 0. ? t : t - COMPLEX{piece.start};
+        if (piece.omega == 0.) return s * piece.b + piece.a;
+        return CFunction<COMPLEX, COMPLEX>::Exp().compose(s * COMPLEX{0., piece.omega}) * piece.b + piece.a;
+    }
+
+    /* Joins paths end to end over [0, 1], each over a share of the interval in proportion to its length, or over
+     * equal shares if none has a length. */
+    static std::shared_ptr<Path const> join(std::vector<std::shared_ptr<Path const>> const &paths) {
+        std::vector<REAL> lengths;
+        REAL total = 0.;
+        for (std::shared_ptr<Path const> const &path : paths) {
+            lengths.push_back(path->length(path->pieces.front().start, path->pieces.back().end));
+            total += lengths.back();
+        }
+
+        auto result = std::make_shared<Path>();
+        REAL offset = 0.;
+        for (size_t k = 0; k < paths.size(); ++k) {
+            REAL const share = total > 0. ? lengths[k] / total : 1. / paths.size();
+            if (share == 0.) continue;
+            REAL const start = paths[k]->pieces.front().start, scale = share / (paths[k]->pieces.back().end - start);
+            for (Path::Piece piece : paths[k]->pieces) {
+                piece.start = offset + (piece.start - start) * scale;
+                piece.end = offset + (piece.end - start) * scale;
+                if (piece.omega == 0.) piece.b /= scale;
+                else piece.omega /= scale;
+                result->pieces.push_back(piece);
+            }
+            offset += share;
+        }
+        result->pieces.back().end = 1.;
+        return result;
+    }
+
+    template<>
+    Contour Contour::Trace(std::shared_ptr<Path const> const &path) {
+        std::vector<Path::Piece> const &pieces = path->pieces;
+        if (pieces.empty()) throw std::invalid_argument("a path needs at least one piece");
+        if (pieces.size() == 1 && pieces[0].omega == 0. && pieces[0].b == 0.) return Contour::Constant(pieces[0].a);
+        if (pieces.size() == 1) {
+            Contour const expression = piece_expression(pieces[0]);
+            return Contour(Tape::Trace(path), expression._latex, expression._last_op);
+        }
+
+        std::vector<Latex::Text::ptr> latex{Latex::Text::Literal("\\begin{cases} ")};
+        for (size_t k = 0; k < pieces.size(); ++k) {
+            latex.push_back(piece_expression(pieces[k])._latex);
+            if (k + 1 < pieces.size()) latex.push_back(Latex::Text::Literal(" & ;\\;" LATEX_VAR " < " + Latex::fmt_const(pieces[k].end) + " \\\\ "));
+            else latex.push_back(Latex::Text::Literal(" & ;\\;\\text{else}\\end{cases} "));
+        }
+        return Contour(Tape::Trace(path), Latex::Text::Join(latex), OP_TYPE::IF);
+    }
+
+    template<>
+    Contour Contour::Line(COMPLEX const z1, COMPLEX const z2) {
+        return Contour::Trace(std::make_shared<Path const>(Path{{{0., 1., z1, z2 - z1}}}));
+    }
+
+    template<>
+    Contour Contour::Arc(COMPLEX const center, REAL const radius, REAL const start_angle, REAL const end_angle) {
+        return Contour::Trace(std::make_shared<Path const>(Path{{{0., 1., center, std::polar(radius, start_angle), end_angle - start_angle}}}));
+    }
+
+    template<>
+    Contour Contour::Polyline(COMPLEX const *points, size_t const n, bool const closed) {
+        if (n < 2) throw std::invalid_argument("a polyline needs at least two points");
+        std::vector<std::shared_ptr<Path const>> segments;
+        for (size_t k = 0; k + 1 < n + closed; ++k) {
+            COMPLEX const start = points[k], end = points[(k + 1) % n];
+            segments.push_back(std::make_shared<Path const>(Path{{{0., 1., start, end - start}}}));
+        }
+        return Contour::Trace(join(segments));
+    }
+
+    template<>
+    Contour Contour::Rectangle(COMPLEX const z1, COMPLEX const z2) {
+        // Counterclockwise when z1 is the lower left corner and z2 the upper right one.
+        COMPLEX const corners[4] = {z1, {std::real(z2), std::imag(z1)}, z2, {std::real(z1), std::imag(z2)}};
+        return Contour::Polyline(corners, 4, true);
+    }
+
+    template<>
+    Contour Contour::Concat(Contour const *contours, size_t const n) {
+        if (n == 0) throw std::invalid_argument("nothing to concatenate");
+        std::vector<std::shared_ptr<Path const>> paths;
+        for (size_t k = 0; k < n; ++k) {
+            std::shared_ptr<Path const> path = contours[k].path();
+            // Constant contours are single points, without a path of their own.
+            if (!path && contours[k]._is_constant()) path = std::make_shared<Path const>(Path{{{0., 1., contours[k]._constant(), 0.}}});
+            if (!path) throw std::invalid_argument("only contours of line segments and arcs can be concatenated");
+            paths.push_back(path);
+        }
+        return Contour::Trace(join(paths));
+    }
+}
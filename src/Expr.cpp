@@ -0,0 +1,215 @@
+#include "Expr.h"
+#include <memory_resource>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace libcalculus {
+    /* Nodes are small and made in large numbers, one per operation, so they come from pools of equally sized blocks;
+     * the resource is never destroyed, as static functions may release their nodes after it would be. */
+    static std::pmr::memory_resource *node_pool() {
+        static auto *const pool = new std::pmr::synchronized_pool_resource();
+        return pool;
+    }
+    static std::mutex build_mutex;
+
+    template<typename... Args>
+    static inline Expr::ptr make_node(Args &&...args) {
+        return std::allocate_shared<Expr>(std::pmr::polymorphic_allocator<Expr>(node_pool()), std::forward<Args>(args)...);
+    }
+
+    Expr::Expr(Kind const kind, OPCODE const op, bool const dom_real, bool const ran_real, COMPLEX const c, ptr const &a,
+               ptr const &b, Tape::ptr const &tape)
+        : kind{kind}, op{op}, dom_real{dom_real}, ran_real{ran_real}, c{c}, a{a}, b{b}, cached{tape}, built{tape != nullptr} {}
+
+    Expr::~Expr() {
+        // Releasing the operands one by one, rather than recursively, so that long chains of operations do not overflow
+        // the stack; nodes with no other owner are only reachable from here, and are emptied before they are destroyed.
+        std::vector<ptr> pending;
+        auto const release = [&](ptr &node) {
+            if (node && node.use_count() == 1) pending.push_back(std::move(node));
+            node.reset();
+        };
+        release(this->a);
+        release(this->b);
+        while (!pending.empty()) {
+            ptr node = std::move(pending.back());
+            pending.pop_back();
+            Expr &orphan = const_cast<Expr &>(*node);
+            release(orphan.a);
+            release(orphan.b);
+        }
+    }
+
+    Tape::ptr const &Expr::tape() const {
+        if (!this->built.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(build_mutex);
+            if (!this->built.load(std::memory_order_relaxed)) {
+                this->cached = this->build();
+                this->built.store(true, std::memory_order_release);
+            }
+        }
+        return this->cached;
+    }
+
+    /* The nodes are laid out on one tape in postorder, each once per argument it is applied to; the tapes of nodes that
+     * have already been built are copied as they are. Finalizing the tape then merges what the nodes have in common. */
+    Tape::ptr Expr::build() const {
+        struct Frame {
+            Expr const *expr;
+            uint32_t var, first = 0;
+            unsigned char stage = 0;
+        };
+        struct KeyHash {
+            inline size_t operator()(std::pair<Expr const *, uint32_t> const &key) const noexcept {
+                return std::hash<void const *>()(key.first) ^ (size_t{key.second} * 0x9E3779B97F4A7C15ULL);
+            }
+        };
+        Tape result;
+        result.push({OPCODE::VAR, this->dom_real});
+        std::unordered_map<std::pair<Expr const *, uint32_t>, uint32_t, KeyHash> done;
+        std::vector<Frame> stack{{this, 0}};
+        uint32_t value = 0; // The instruction computing the last node finished.
+        while (!stack.empty()) {
+            Frame &frame = stack.back();
+            Expr const &expr = *frame.expr;
+            uint32_t const var = frame.var;
+            if (frame.stage == 0) {
+                if (auto const it = done.find({&expr, var}); it != done.end()) {
+                    value = it->second;
+                    stack.pop_back();
+                    continue;
+                }
+                if (expr.built.load(std::memory_order_acquire)) {
+                    value = result.append(*expr.cached, var);
+                    done.emplace(std::make_pair(&expr, var), value);
+                    stack.pop_back();
+                    continue;
+                }
+            }
+
+            bool finished = false;
+            switch (expr.kind) {
+                case Kind::LEAF:
+                    break; // Leaves are always built.
+                case Kind::UNARY:
+                case Kind::WITH_CONST:
+                    if (frame.stage++ == 0) {
+                        stack.push_back({expr.a.get(), var});
+                    } else {
+                        value = result.push({expr.op, expr.ran_real, value, 0, 0, expr.c});
+                        finished = true;
+                    }
+                    break;
+                case Kind::BINARY:
+                    if (frame.stage == 0) {
+                        frame.stage = 1;
+                        stack.push_back({expr.a.get(), var});
+                    } else if (frame.stage == 1) {
+                        frame.stage = 2;
+                        frame.first = value;
+                        stack.push_back({expr.b.get(), var});
+                    } else {
+                        value = result.push({expr.op, expr.ran_real, frame.first, value});
+                        finished = true;
+                    }
+                    break;
+                case Kind::COMPOSE:
+                    // The inner function first, and then the outer one applied to it.
+                    if (frame.stage == 0) {
+                        frame.stage = 1;
+                        stack.push_back({expr.b.get(), var});
+                    } else if (frame.stage == 1) {
+                        frame.stage = 2;
+                        stack.push_back({expr.a.get(), value});
+                    } else {
+                        finished = true;
+                    }
+                    break;
+            }
+            if (finished) {
+                done.emplace(std::make_pair(&expr, var), value);
+                stack.pop_back();
+            }
+        }
+        result.root = value;
+        return result.finalize();
+    }
+
+    bool Expr::identity() const noexcept {
+        switch (this->kind) {
+            case Kind::LEAF: return this->cached->root == 0;
+            case Kind::COMPOSE: return this->a->identity() && this->b->identity();
+            default: return false;
+        }
+    }
+
+    bool Expr::single() const noexcept {
+        switch (this->kind) {
+            case Kind::LEAF: return this->cached->code.size() == 2;
+            case Kind::UNARY: case Kind::WITH_CONST: return this->a->identity();
+            case Kind::BINARY: return this->a->identity() && this->b->identity();
+            case Kind::COMPOSE: return (this->a->identity() && this->b->single()) || (this->b->identity() && this->a->single());
+        }
+        return false;
+    }
+
+    OPCODE Expr::last() const noexcept {
+        switch (this->kind) {
+            case Kind::LEAF: return this->cached->last();
+            case Kind::COMPOSE: return this->a->identity() ? this->b->last() : this->a->last();
+            default: return this->op;
+        }
+    }
+
+    COMPLEX Expr::last_const() const noexcept {
+        switch (this->kind) {
+            case Kind::LEAF: return this->cached->last_const();
+            case Kind::COMPOSE: return this->a->identity() ? this->b->last_const() : this->a->last_const();
+            default: return this->c;
+        }
+    }
+
+    size_t Expr::memory(std::unordered_set<void const *> &seen) const {
+        size_t result = 0;
+        std::vector<Expr const *> pending{this};
+        while (!pending.empty()) {
+            Expr const *expr = pending.back();
+            pending.pop_back();
+            if (!seen.insert(expr).second) continue;
+            result += sizeof(Expr);
+            if (expr->built.load(std::memory_order_acquire)) result += expr->cached->memory(seen);
+            if (expr->a) pending.push_back(expr->a.get());
+            if (expr->b) pending.push_back(expr->b.get());
+        }
+        return result;
+    }
+
+    /* Construction */
+    Expr::ptr Expr::Leaf(Tape::ptr const &tape) {
+        return make_node(Kind::LEAF, tape->last(), tape->dom_real(), tape->ran_real(), COMPLEX{0.}, nullptr, nullptr, tape);
+    }
+
+    Expr::ptr Expr::Variable(bool const dom_real, bool const ran_real) {
+        // Every function starts out as the argument, so the four kinds of it are shared.
+        static ptr const variables[2][2] = {{Expr::Leaf(Tape::Variable(false, false)), Expr::Leaf(Tape::Variable(false, true))},
+                                            {Expr::Leaf(Tape::Variable(true, false)), Expr::Leaf(Tape::Variable(true, true))}};
+        return variables[dom_real][ran_real];
+    }
+
+    Expr::ptr Expr::Unary(OPCODE const op, ptr const &x) {
+        return make_node(Kind::UNARY, op, x->dom_real, x->ran_real && op != OPCODE::WIDEN, COMPLEX{0.}, x, nullptr, nullptr);
+    }
+
+    Expr::ptr Expr::Binary(OPCODE const op, ptr const &lhs, ptr const &rhs) {
+        return make_node(Kind::BINARY, op, lhs->dom_real, lhs->ran_real, COMPLEX{0.}, lhs, rhs, nullptr);
+    }
+
+    Expr::ptr Expr::WithConst(OPCODE const op, ptr const &x, COMPLEX const c) {
+        return make_node(Kind::WITH_CONST, op, x->dom_real, x->ran_real, c, x, nullptr, nullptr);
+    }
+
+    Expr::ptr Expr::Compose(ptr const &lhs, ptr const &rhs) {
+        return make_node(Kind::COMPOSE, OPCODE::VAR, rhs->dom_real, lhs->ran_real, COMPLEX{0.}, lhs, rhs, nullptr);
+    }
+}
@@ -16,19 +16,26 @@ cdef class Function:
   def copy(Function self):
     return Function(self.realfunction, self.contour, self.complexfunction)
 
+  def __reduce__(Function self):
+    return Function, (self.realfunction, self.contour, self.complexfunction)
+
   def __hash__(Function self):
     return id(self)
 
-  def __call__(Function self, x):
-    """Evaluate the function at a point or on an np.ndarray of points."""
+  def __call__(Function self, x, out=None, where=True):
+    """Evaluate the function at a point or on an np.ndarray of points, into out if it is given and only where where
+    holds, as NumPy's ufuncs do."""
+    if out is not None or where is not True:
+      x = np.asarray(x)
     if _isrealscalar(x):
       return self.realfunction.cfunction(<REAL>x) if self.realfunction is not None else \
              self.contour.cfunction(<REAL>x) if self.contour is not None else \
              self.complexfunction.cfunction(<COMPLEX>x)
     elif _isrealarray(x):
-      return self.realfunction._call_array(x.ravel().astype(np.double, copy=False)) if self.realfunction is not None else \
-             self.contour._call_array(x.ravel().astype(np.double, copy=False)) if self.contour is not None else \
-             self.complexfunction._call_array(x.ravel().astype(complex, copy=False))
+      # The classes themselves pick the precision from the dtype.
+      return self.realfunction(x, out, where) if self.realfunction is not None else \
+             self.contour(x, out, where) if self.contour is not None else \
+             self.complexfunction(x, out, where)
     elif _iscomplexscalar(x):
       if self.complexfunction is not None:
         return self.complexfunction.cfunction(<COMPLEX>x)
@@ -36,7 +43,7 @@ cdef class Function:
         raise ValueError(f"This function cannot accept input of type {type(x)}.")
     elif _iscomplexarray(x):
       if self.complexfunction is not None:
-        return self.complexfunction._call_array(x.ravel().astype(complex, copy=False)).reshape(x.shape)
+        return self.complexfunction(x, out, where)
       else:
         raise ValueError(f"This function cannot accept input of type {type(x)}.")
     else:
@@ -51,6 +58,40 @@ cdef class Function:
     elif self.complexfunction is not None:
       return self.complexfunction.cfunction.latex(varname.encode()).decode()
 
+  def compile(Function self):
+    """Compile the function to native code, which evaluates it faster; the result is cached on disk."""
+    return Function(self.realfunction.compile() if self.realfunction is not None else None,
+                    self.contour.compile() if self.contour is not None else None,
+                    self.complexfunction.compile() if self.complexfunction is not None else None)
+
+  def approximate(Function self, REAL a, REAL b, REAL tol = 1e-10):
+    """Piecewise Chebyshev interpolants of the real and contour forms of the function over [a, b]; see
+    RealFunction.approximate()."""
+    if self.realfunction is None and self.contour is None:
+      raise ValueError("only functions of a real variable can be approximated")
+    return Function(self.realfunction.approximate(a, b, tol) if self.realfunction is not None else None,
+                    self.contour.approximate(a, b, tol) if self.contour is not None else None,
+                    None)
+
+  def evaluate_grid(Function self, re_range, im_range, size_t nx, size_t ny, str output="value", size_t downsample=1):
+    """Evaluate the complex form of the function over a grid of the complex plane; see ComplexFunction.evaluate_grid()."""
+    if self.complexfunction is None:
+      raise ValueError("only functions of a complex variable are evaluated over grids")
+    return self.complexfunction.evaluate_grid(re_range, im_range, nx, ny, output, downsample)
+
+  def deduplicated(Function self):
+    """The number of operations shared with an identical subexpression instead of being evaluated separately."""
+    if self.realfunction is not None:
+      return self.realfunction.deduplicated()
+    elif self.contour is not None:
+      return self.contour.deduplicated()
+    elif self.complexfunction is not None:
+      return self.complexfunction.deduplicated()
+
+  def memory_usage(Function self):
+    """The number of bytes the function holds across its real, contour and complex forms."""
+    return sum(f.memory_usage() for f in (self.realfunction, self.contour, self.complexfunction) if f is not None)
+
   def __neg__(Function self):
     """The additive inverse of the function."""
     return Function(-self.realfunction if self.realfunction is not None else None,
@@ -61,8 +102,11 @@ cdef class Function:
     """Add the function in-place with a constant or another function."""
     if isinstance(rhs, Function):
       if self.realfunction is not None and (<Function>rhs).realfunction is not None: self.realfunction += (<Function>rhs).realfunction
+      else: self.realfunction = None
       if self.contour is not None and (<Function>rhs).contour is not None: self.contour += (<Function>rhs).contour
+      else: self.contour = None
       if self.complexfunction is not None and (<Function>rhs).complexfunction is not None: self.complexfunction += (<Function>rhs).complexfunction
+      else: self.complexfunction = None
     elif _isrealscalar(rhs):
       if self.realfunction is not None: self.realfunction += <REAL>rhs
       if self.contour is not None: self.contour += <COMPLEX>rhs
@@ -79,8 +123,11 @@ cdef class Function:
     """Subtract a constant or another function from the function, in-place."""
     if isinstance(rhs, Function):
       if self.realfunction is not None and (<Function>rhs).realfunction is not None: self.realfunction -= (<Function>rhs).realfunction
+      else: self.realfunction = None
       if self.contour is not None and (<Function>rhs).contour is not None: self.contour -= (<Function>rhs).contour
+      else: self.contour = None
       if self.complexfunction is not None and (<Function>rhs).complexfunction is not None: self.complexfunction -= (<Function>rhs).complexfunction
+      else: self.complexfunction = None
     elif _isrealscalar(rhs):
       if self.realfunction is not None: self.realfunction -= <REAL>rhs
       if self.contour is not None: self.contour -= <COMPLEX>rhs
@@ -97,8 +144,11 @@ cdef class Function:
     """Multiply the function in-place with a constant or another function."""
     if isinstance(rhs, Function):
       if self.realfunction is not None and (<Function>rhs).realfunction is not None: self.realfunction *= (<Function>rhs).realfunction
+      else: self.realfunction = None
       if self.contour is not None and (<Function>rhs).contour is not None: self.contour *= (<Function>rhs).contour
+      else: self.contour = None
       if self.complexfunction is not None and (<Function>rhs).complexfunction is not None: self.complexfunction *= (<Function>rhs).complexfunction
+      else: self.complexfunction = None
     elif _isrealscalar(rhs):
       if self.realfunction is not None: self.realfunction *= <REAL>rhs
       if self.contour is not None: self.contour *= <COMPLEX>rhs
@@ -115,8 +165,11 @@ cdef class Function:
     """Divide the function in-place by a constant or another function."""
     if isinstance(rhs, Function):
       if self.realfunction is not None and (<Function>rhs).realfunction is not None: self.realfunction /= (<Function>rhs).realfunction
+      else: self.realfunction = None
       if self.contour is not None and (<Function>rhs).contour is not None: self.contour /= (<Function>rhs).contour
+      else: self.contour = None
       if self.complexfunction is not None and (<Function>rhs).complexfunction is not None: self.complexfunction /= (<Function>rhs).complexfunction
+      else: self.complexfunction = None
     elif _isrealscalar(rhs):
       if self.realfunction is not None: self.realfunction /= <REAL>rhs
       if self.contour is not None: self.contour /= <COMPLEX>rhs
@@ -134,7 +187,9 @@ cdef class Function:
     if isinstance(rhs, Function):
       self.realfunction = None # negative or fractional powers cause NaNs in RealFunction
       if self.contour is not None and (<Function>rhs).contour is not None: self.contour **= (<Function>rhs).contour
+      else: self.contour = None
       if self.complexfunction is not None and (<Function>rhs).complexfunction is not None: self.complexfunction **= (<Function>rhs).complexfunction
+      else: self.complexfunction = None
     elif _isrealscalar(rhs):
       if self.realfunction is not None and rhs >= 0 and float(rhs).is_integer(): # negative or fractional powers cause NaNs in RealFunction
         self.realfunction **= <REAL>rhs
@@ -0,0 +1,213 @@
+#include "Jit.h"
+#include "Kernels.h"
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#if defined(__unix__)
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+namespace libcalculus {
+    namespace Jit {
+        static char const *const COMPILER_FLAGS = "-std=c++2a -O3 -fopenmp -fno-math-errno -fno-trapping-math -shared -fPIC";
+
+        /* The expression computing an inlined instruction from its operands $x and $y; matches apply() in Tape.cpp. */
+        static std::string expression(OPCODE const op, bool const real) {
+            switch (op) {
+                case OPCODE::WIDEN: return "COMPLEX($x)";
+                case OPCODE::ADD: case OPCODE::ADDC: return "$x + $y";
+                case OPCODE::SUB: case OPCODE::SUBC: return "$x - $y";
+                case OPCODE::CSUB: return "$y - $x";
+                case OPCODE::MUL: case OPCODE::MULC: return "$y * $x";
+                case OPCODE::DIV: case OPCODE::DIVC: return "$x / $y";
+                case OPCODE::CDIV: return "$y / $x";
+                case OPCODE::POW: case OPCODE::POWC: return "std::pow($x, $y)";
+                case OPCODE::CPOW: return "std::pow($y, $x)";
+                case OPCODE::NEG: return "-$x";
+                case OPCODE::RE: return "std::real($x)";
+                case OPCODE::IM: return "std::imag($x)";
+                case OPCODE::CONJ: return real ? "$x" : "std::conj($x)";
+                case OPCODE::ABS: return "std::abs($x)";
+                default: return "";
+            }
+        }
+
+        static inline bool is_inlined(Instruction const &instr) noexcept {
+            return instr.op != OPCODE::OPAQUE && instr.op != OPCODE::IF && instr.op != OPCODE::DERIVATIVE && instr.op != OPCODE::PATH &&
+                   instr.op != OPCODE::CHEBYSHEV && !Kernels::has_kernel(instr.op, instr.real);
+        }
+
+        static std::string fmt_double(double const x) {
+            if (std::isnan(x)) return "__builtin_nan(\"\")";
+            if (std::isinf(x)) return x > 0 ? "__builtin_inf()" : "(-__builtin_inf())";
+            std::ostringstream oss;
+            oss << std::hexfloat << x;
+            return "(" + oss.str() + ")";
+        }
+
+        static std::string substitute(std::string expr, std::string const &x, std::string const &y) {
+            for (size_t pos; (pos = expr.find("$x")) != std::string::npos;) expr.replace(pos, 2, x);
+            for (size_t pos; (pos = expr.find("$y")) != std::string::npos;) expr.replace(pos, 2, y);
+            return expr;
+        }
+
+        /* The generated function evaluates the tape over blocks of points like the interpreter. Each run of inlined
+         * instructions becomes one loop keeping its values in locals; values used outside their run, and the values
+         * of instructions evaluated by the callback, live in per-block buffers. */
+        std::string source(Tape const &tape) {
+            size_t const n = tape.code.size();
+            auto const type = [&](uint32_t const i) { return tape.code[i].real ? "double" : "COMPLEX"; };
+
+            std::vector<size_t> run(n, 0); // Which run (or call) each instruction belongs to.
+            for (size_t i = 1; i < n; ++i) {
+                run[i] = run[i - 1] + (i == 1 || !is_inlined(tape.code[i]) || !is_inlined(tape.code[i - 1]));
+            }
+            std::vector<bool> buffered(n, false);
+            for (size_t i = 1; i < n; ++i) {
+                Instruction const &instr = tape.code[i];
+                if (!is_inlined(instr) && i != tape.root) buffered[i] = true;
+                if (instr.op == OPCODE::CONST) continue;
+                if (instr.a != 0 && (!is_inlined(instr) || run[instr.a] != run[i])) buffered[instr.a] = true;
+                if (is_binary(instr.op) && instr.b != 0 && run[instr.b] != run[i]) buffered[instr.b] = true;
+            }
+
+            std::ostringstream src;
+            src << "// Generated by libcalculus.\n"
+                   "#include <algorithm>\n#include <complex>\n#include <cstddef>\n#include <cstdint>\n#include <memory>\n\n"
+                   "using COMPLEX = std::complex<double>;\n"
+                   "using Callback = void (*)(void const *, uint32_t, void const *, void const *, void *, size_t);\n\n"
+                   "extern \"C\" void libcalculus_run(void const *z_, void *result_, size_t const n, void const *tape, Callback const callback) {\n"
+                << "    auto const *z = static_cast<" << type(0) << " const *>(z_);\n"
+                << "    auto *result = static_cast<" << type(tape.root) << " *>(result_);\n"
+                << "    size_t const block = std::min<size_t>(n, " << TAPE_BLOCK_SIZE << ");\n";
+            size_t n_buffers = 0;
+            for (size_t i = 1; i < n; ++i) n_buffers += buffered[i];
+            if (n_buffers > 0) src << "    std::unique_ptr<COMPLEX[]> buffers{new COMPLEX[" << n_buffers << " * block]};\n";
+            for (size_t i = 1, k = 0; i < n; ++i) {
+                if (buffered[i]) src << "    auto *const b" << i << " = reinterpret_cast<" << type(i) << " *>(buffers.get() + " << k++ << " * block);\n";
+            }
+
+            src << "    for (size_t start = 0; start < n; start += block) {\n"
+                   "        size_t const m = std::min(block, n - start);\n";
+            if (tape.root == 0) src << "        std::copy_n(z + start, m, result + start);\n";
+            for (size_t i = 1; i < n;) {
+                Instruction const &instr = tape.code[i];
+                if (!is_inlined(instr)) {
+                    src << "        callback(tape, " << i << ", " << (instr.a == 0 ? "z + start" : "b" + std::to_string(instr.a))
+                        << ", nullptr, " << (i == tape.root ? "result + start" : "b" + std::to_string(i)) << ", m);\n";
+                    ++i;
+                    continue;
+                }
+
+                size_t end = i;
+                while (end < n && run[end] == run[i]) ++end;
+                auto const operand = [&](uint32_t const j) {
+                    if (j == 0) return std::string("z[start + j]");
+                    return (run[j] == run[i] ? "v" : "b") + std::to_string(j) + (run[j] == run[i] ? "" : "[j]");
+                };
+                src << "        #pragma omp simd\n"
+                       "        for (size_t j = 0; j < m; ++j) {\n";
+                for (; i < end; ++i) {
+                    Instruction const &instr = tape.code[i];
+                    std::string value;
+                    if (instr.op == OPCODE::CONST) {
+                        value = instr.real ? fmt_double(std::real(instr.c))
+                                           : "COMPLEX(" + fmt_double(std::real(instr.c)) + ", " + fmt_double(std::imag(instr.c)) + ")";
+                    } else {
+                        std::string const y = is_binary(instr.op) ? operand(instr.b)
+                                            : instr.real ? fmt_double(std::real(instr.c))
+                                            : "COMPLEX(" + fmt_double(std::real(instr.c)) + ", " + fmt_double(std::imag(instr.c)) + ")";
+                        value = substitute(expression(instr.op, instr.real), operand(instr.a), y);
+                    }
+                    src << "            " << type(i) << " const v" << i << " = " << value << ";\n";
+                    if (buffered[i]) src << "            b" << i << "[j] = v" << i << ";\n";
+                    if (i == tape.root) src << "            result[start + j] = v" << i << ";\n";
+                }
+                src << "        }\n";
+            }
+            src << "    }\n}\n";
+            return src.str();
+        }
+
+        /* FNV-1a, which unlike std::hash is the same in every process and build. */
+        static uint64_t hash(std::string const &s) noexcept {
+            uint64_t h = 0xCBF29CE484222325ULL;
+            for (unsigned char const c : s) h = (h ^ c) * 0x100000001B3ULL;
+            return h;
+        }
+
+        static std::filesystem::path cache_dir() {
+            if (char const *dir = std::getenv("LIBCALCULUS_CACHE_DIR")) return dir;
+            if (char const *dir = std::getenv("XDG_CACHE_HOME")) return std::filesystem::path(dir) / "libcalculus";
+            if (char const *dir = std::getenv("HOME")) return std::filesystem::path(dir) / ".cache" / "libcalculus";
+            return std::filesystem::temp_directory_path() / "libcalculus";
+        }
+
+        static std::string read_file(std::filesystem::path const &path) {
+            std::ifstream file(path, std::ios::binary);
+            std::ostringstream contents;
+            contents << file.rdbuf();
+            return contents.str();
+        }
+
+        static std::string quote(std::string const &s) {
+            std::string result = "'";
+            for (char const c : s) result += c == '\'' ? std::string("'\\''") : std::string(1, c);
+            return result + "'";
+        }
+
+        Tape::ptr compile(Tape const &tape) {
+#if defined(__unix__)
+            char const *cxx = std::getenv("CXX");
+            std::string const compiler = cxx != nullptr && *cxx != '\0' ? cxx : "g++";
+            std::string const src = source(tape);
+            char name[32];
+            std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash(compiler + "\n" + COMPILER_FLAGS + "\n" + src)));
+
+            std::filesystem::path const dir = cache_dir();
+            std::filesystem::path const lib_path = dir / (std::string(name) + ".so"), src_path = dir / (std::string(name) + ".cpp");
+            // The source is stored next to the shared object, so a hash collision is detected rather than loading the wrong code.
+            if (!std::filesystem::exists(lib_path) || read_file(src_path) != src) {
+                static std::atomic<unsigned> counter{0};
+                std::string const tmp = std::string(name) + "." + std::to_string(getpid()) + "." + std::to_string(counter++);
+                std::filesystem::path const tmp_src = dir / (tmp + ".cpp"), tmp_lib = dir / (tmp + ".so"), tmp_log = dir / (tmp + ".log");
+                std::filesystem::create_directories(dir);
+                std::ofstream(tmp_src, std::ios::binary) << src;
+                std::string const command = compiler + " " + COMPILER_FLAGS + " -o " + quote(tmp_lib) + " " + quote(tmp_src) + " > " + quote(tmp_log) + " 2>&1";
+                int const status = std::system(command.c_str());
+                std::string const log = read_file(tmp_log);
+                std::filesystem::remove(tmp_log);
+                if (status != 0) {
+                    std::filesystem::remove(tmp_src);
+                    std::filesystem::remove(tmp_lib);
+                    throw std::runtime_error("compilation failed: " + command + "\n" + log);
+                }
+                // Renaming is atomic, so concurrent compilations of the same function never see a partial file.
+                std::filesystem::rename(tmp_lib, lib_path);
+                std::filesystem::rename(tmp_src, src_path);
+            }
+
+            void *const handle = dlopen(lib_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+            if (handle == nullptr) throw std::runtime_error(std::string("cannot load compiled function: ") + dlerror());
+            auto const run = reinterpret_cast<Tape::Native::Function>(dlsym(handle, "libcalculus_run"));
+            if (run == nullptr) {
+                dlclose(handle);
+                throw std::runtime_error("cannot load compiled function: " + lib_path.string());
+            }
+
+            Tape result = tape;
+            result.native = std::make_shared<Tape::Native const>(Tape::Native{std::shared_ptr<void>(handle, dlclose), run});
+            return std::make_shared<Tape const>(std::move(result));
+#else
+            throw std::runtime_error("compilation to native code is only supported on POSIX systems");
+#endif
+        }
+    }
+}
@@ -0,0 +1,440 @@
+#include "Kernels.h"
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+namespace libcalculus {
+    namespace Kernels {
+        /* Scalar building blocks. They avoid branches and library calls, and are always inlined, so that loops over
+         * them vectorize; each one assumes a finite argument, and returns NaN or an inaccurate value outside of its
+         * kernel's range. */
+        static inline double constexpr INF = std::numeric_limits<double>::infinity();
+        static inline double constexpr NaN = std::numeric_limits<double>::quiet_NaN();
+        static inline double constexpr ROUND = 0x1.8p52; // x + ROUND - ROUND rounds x to an integer.
+        static inline double constexpr LOG2E = 1.44269504088896338700e+00;
+        static inline double constexpr LN2_HI = 6.93147180369123816490e-01, LN2_LO = 1.90821492927058770002e-10;
+        static inline double constexpr LN2 = 6.93147180559945286227e-01;
+        static inline double constexpr PIO2_HI = 1.57079632679489655800e+00, PIO2_LO = 6.12323399573676603587e-17;
+        static inline double constexpr PI_HI = 3.14159265358979311600e+00, PI_LO = 1.22464679914735317720e-16;
+        static inline double constexpr TRIG_MAX = 823549.6; // 2^19 * pi / 2, up to which the reduction below is exact enough.
+        static inline double constexpr HYP_MAX = 709.; // Largest argument for which exp() does not overflow.
+        static inline double constexpr INV_MAX = 1e150, INV_MIN = 1e-150; // Squares of these neither overflow nor underflow.
+
+        [[gnu::always_inline]] static inline int64_t bits(double const x) noexcept { return std::bit_cast<int64_t>(x); }
+        [[gnu::always_inline]] static inline double from_bits(int64_t const b) noexcept { return std::bit_cast<double>(b); }
+        [[gnu::always_inline]] static inline double copysign(double const x, double const y) noexcept {
+            return from_bits((bits(x) & INT64_MAX) | (bits(y) & INT64_MIN));
+        }
+        // Compared as a double rather than as an integer, which keeps every mask in a loop the same width.
+        [[gnu::always_inline]] static inline bool signbit(double const x) noexcept { return copysign(1., x) < 0.; }
+        [[gnu::always_inline]] static inline bool finite(double const x) noexcept { return x - x == 0.; }
+
+        /* 2^k for an integer k in [-1022, 1023]. */
+        [[gnu::always_inline]] static inline double pow2(double const k) noexcept { return from_bits((bits(k + ROUND) - bits(ROUND) + 1023) << 52); }
+
+        /* Splits x = k ln2 + r with |r| <= ln2 / 2, returning expm1(r) and setting k. */
+        [[gnu::always_inline]] static inline double expm1_reduced(double const x, double &k) noexcept {
+            k = (x * LOG2E + ROUND) - ROUND;
+            double const r = (x - k * LN2_HI) - k * LN2_LO;
+            return r + r * r * (1. / 2 + r * (1. / 6 + r * (1. / 24 + r * (1. / 120 + r * (1. / 720 + r * (1. / 5040
+                   + r * (1. / 40320 + r * (1. / 362880 + r * (1. / 3628800 + r * (1. / 39916800 + r * (1. / 479001600
+                   + r * (1. / 6227020800.))))))))))));
+        }
+
+        [[gnu::always_inline]] static inline double exp(double const x) noexcept {
+            double k;
+            double const p = expm1_reduced(std::min(std::max(x, -746.), 710.), k);
+            // Scale in two steps so that results near the ends of the range neither overflow nor flush early.
+            double const k1 = (k * .5 + ROUND) - ROUND;
+            return (1. + p) * pow2(k1) * pow2(k - k1);
+        }
+
+        /* For |x| <= HYP_MAX. */
+        [[gnu::always_inline]] static inline double expm1(double const x) noexcept {
+            double k;
+            double const p = expm1_reduced(std::max(x, -60.), k), s = pow2(k);
+            return s * p + (s - 1.);
+        }
+
+        [[gnu::always_inline]] static inline double log(double const x) noexcept {
+            static double constexpr Lg1 = 6.666666666666735130e-01, Lg2 = 3.999999999940941908e-01,
+                                    Lg3 = 2.857142874366239149e-01, Lg4 = 2.222219843214978396e-01,
+                                    Lg5 = 1.818357216161805012e-01, Lg6 = 1.531383769920937332e-01,
+                                    Lg7 = 1.479819860511658591e-01;
+            bool const subnormal = x < 0x1p-1022;
+            int64_t const b = bits(subnormal ? x * 0x1p54 : x);
+            // The exponent, converted to double by placing it in the mantissa of 2^52.
+            double e = from_bits(0x4330000000000000 | ((b >> 52) & 0x7ff)) - (0x1p52 + 1023.) - (subnormal ? 54. : 0.);
+            double m = from_bits((b & 0x000fffffffffffff) | 0x3ff0000000000000);
+            bool const high = m > 1.41421356237309504880;
+            m = high ? .5 * m : m;
+            e = high ? e + 1. : e;
+
+            double const f = m - 1., hfsq = .5 * f * f, s = f / (2. + f), z = s * s, w = z * z;
+            double const R = w * (Lg2 + w * (Lg4 + w * Lg6)) + z * (Lg1 + w * (Lg3 + w * (Lg5 + w * Lg7)));
+            double const result = e * LN2_HI - ((hfsq - (s * (hfsq + R) + e * LN2_LO)) - f);
+            return x > 0. ? (x == INF ? INF : result) : (x == 0. ? -INF : NaN);
+        }
+
+        [[gnu::always_inline]] static inline double log1p(double const x) noexcept {
+            double const u = 1. + x;
+            return log(u) + (x - (u - 1.)) / u;
+        }
+
+        /* For |x| <= TRIG_MAX. */
+        [[gnu::always_inline]] static inline void sincos(double const x, double &sin, double &cos) noexcept {
+            static double constexpr TWO_OVER_PI = 6.36619772367581382433e-01;
+            static double constexpr PIO2_1 = 1.57079632673412561417e+00, PIO2_2 = 6.07710050630396597660e-11,
+                                    PIO2_3 = 2.02226624879595063154e-21;
+            static double constexpr S1 = -1.66666666666666324348e-01, S2 = 8.33333333332248946124e-03,
+                                    S3 = -1.98412698298579493134e-04, S4 = 2.75573137070700676789e-06,
+                                    S5 = -2.50507602534068634195e-08, S6 = 1.58969099521155010221e-10;
+            static double constexpr C1 = 4.16666666666666019037e-02, C2 = -1.38888888888741095749e-03,
+                                    C3 = 2.48015872894767294178e-05, C4 = -2.75573143513906633035e-07,
+                                    C5 = 2.08757232129817482790e-09, C6 = -1.13596475577881948265e-11;
+            double const t = x * TWO_OVER_PI + ROUND, n = t - ROUND;
+            int64_t const q = bits(t) - bits(ROUND);
+            double const r = ((x - n * PIO2_1) - n * PIO2_2) - n * PIO2_3;
+
+            double const z = r * r;
+            double const s = r + z * r * (S1 + z * (S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)))));
+            double const hz = .5 * z, w = 1. - hz;
+            double const c = w + (((1. - w) - hz) + z * z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6))))));
+
+            double const s_q = (q & 1) ? c : s, c_q = (q & 1) ? s : c;
+            sin = (q & 2) ? -s_q : s_q;
+            cos = ((q + 1) & 2) ? -c_q : c_q;
+        }
+
+        /* For |x| <= HYP_MAX. */
+        [[gnu::always_inline]] static inline void sinhcosh(double const x, double &sinh, double &cosh) noexcept {
+            double const a = std::abs(x), em = expm1(a), e = em + 1.;
+            sinh = copysign(.5 * (em + em / e), x);
+            cosh = a < 1. ? 1. + .5 * em * em / e : .5 * e + .5 / e;
+        }
+
+        [[gnu::always_inline]] static inline double tanh(double const x) noexcept {
+            double const a = std::abs(x), em = expm1(std::min(2. * a, 60.));
+            // Once tanh exceeds 1 / 2, 1 - 2 / (e^2x + 1) rounds to 1 exactly where the true value does.
+            return copysign(a < .55 ? em / (em + 2.) : 1. - 2. / (em + 2.), x);
+        }
+
+        [[gnu::always_inline]] static inline double atan(double const x) noexcept {
+            static double constexpr aT0 = 3.33333333333329318027e-01, aT1 = -1.99999999998764832476e-01,
+                                    aT2 = 1.42857142725034663711e-01, aT3 = -1.11111104054623557880e-01,
+                                    aT4 = 9.09088713343650656196e-02, aT5 = -7.69187620504482999495e-02,
+                                    aT6 = 6.66107313738753120669e-02, aT7 = -5.83357013379057348645e-02,
+                                    aT8 = 4.97687799461593236017e-02, aT9 = -3.65315727442169155270e-02,
+                                    aT10 = 1.62858201153657823623e-02;
+            // Reduce |x| to a small t with atan|x| = hi + lo + atan t.
+            double const a = std::abs(x);
+            double num, den, hi, lo;
+            if (a < 7. / 16) { num = a; den = 1.; hi = lo = 0.; }
+            else if (a < 11. / 16) { num = 2. * a - 1.; den = 2. + a; hi = 4.63647609000806093515e-01; lo = 2.26987774529616870924e-17; }
+            else if (a < 19. / 16) { num = a - 1.; den = a + 1.; hi = 7.85398163397448278999e-01; lo = 3.06161699786838301793e-17; }
+            else if (a < 39. / 16) { num = a - 1.5; den = 1. + 1.5 * a; hi = 9.82793723247329054082e-01; lo = 1.39033110312309984516e-17; }
+            else { num = -1.; den = a; hi = PIO2_HI; lo = PIO2_LO; }
+            double const t = num / den, z = t * t, w = z * z;
+            double const s1 = z * (aT0 + w * (aT2 + w * (aT4 + w * (aT6 + w * (aT8 + w * aT10)))));
+            double const s2 = w * (aT1 + w * (aT3 + w * (aT5 + w * (aT7 + w * aT9))));
+            return copysign(hi - ((t * (s1 + s2) - lo) - t), x);
+        }
+
+        [[gnu::always_inline]] static inline double atan2(double const y, double const x) noexcept {
+            double const ax = std::abs(x), ay = std::abs(y), M = std::max(ax, ay), m = std::min(ax, ay);
+            double base = atan(M > 0. ? m / M : 0.);
+            base = ay > ax ? (PIO2_HI - base) + PIO2_LO : base;
+            base = signbit(x) ? (PI_HI - base) + PI_LO : base;
+            return x == x && y == y ? copysign(base, y) : NaN;
+        }
+
+        [[gnu::always_inline]] static inline double hypot(double const x, double const y) noexcept {
+            double const M = std::max(std::abs(x), std::abs(y)), m = std::min(std::abs(x), std::abs(y));
+            double const r = M > 0. ? m / M : 0.;
+            return M * std::sqrt(1. + r * r);
+        }
+
+        [[gnu::always_inline]] static inline double asin(double const x) noexcept {
+            return std::abs(x) <= 1. ? atan2(x, std::sqrt((1. - x) * (1. + x))) : NaN;
+        }
+        [[gnu::always_inline]] static inline double acos(double const x) noexcept {
+            return std::abs(x) <= 1. ? atan2(std::sqrt((1. - x) * (1. + x)), x) : NaN;
+        }
+
+        [[gnu::always_inline]] static inline double asinh(double const x) noexcept {
+            double const a = std::abs(x), s = std::sqrt(a * a + 1.);
+            bool const huge = a > 0x1p28, large = a > 2.;
+            double const small_arg = a + a * a / (1. + s);
+            double const u = huge ? a : large ? 2. * a + 1. / (s + a) : 1. + small_arg;
+            double const correction = huge ? LN2 : large ? 0. : (small_arg - (u - 1.)) / u;
+            return copysign(log(u) + correction, x);
+        }
+
+        [[gnu::always_inline]] static inline double acosh(double const x) noexcept {
+            double const t = x - 1.;
+            bool const huge = x > 0x1p28, large = x > 2.;
+            double const small_arg = t + std::sqrt(2. * t + t * t);
+            double const u = huge ? x : large ? 2. * x - 1. / (x + std::sqrt(x * x - 1.)) : 1. + small_arg;
+            double const correction = huge ? LN2 : large ? 0. : (small_arg - (u - 1.)) / u;
+            return x >= 1. ? log(u) + correction : NaN;
+        }
+
+        [[gnu::always_inline]] static inline double atanh(double const x) noexcept {
+            double const a = std::abs(x);
+            return copysign(.5 * log1p(a < .5 ? 2. * a + 2. * a * a / (1. - a) : 2. * a / (1. - a)), x);
+        }
+
+        /* Complex building blocks, on split real and imaginary parts. */
+        [[gnu::always_inline]] static inline void crecip(double const x, double const y, double &re, double &im) noexcept {
+            // Smith's algorithm, dividing by the larger component, arranged as in libgcc so that zeros get the same signs.
+            bool const x_larger = std::abs(x) >= std::abs(y);
+            double const r = x_larger ? y / x : x / y, d = x_larger ? x + y * r : x * r + y;
+            re = x_larger ? 1. / d : (r + 0.) / d;
+            im = x_larger ? (0. - r) / d : -1. / d;
+        }
+
+        [[gnu::always_inline]] static inline void cexp(double const x, double const y, double &re, double &im) noexcept {
+            double s, c;
+            sincos(y, s, c);
+            double const e = exp(x);
+            re = e * c;
+            im = e * s;
+        }
+
+        [[gnu::always_inline]] static inline void clog(double const x, double const y, double &re, double &im) noexcept {
+            double const M = std::max(std::abs(x), std::abs(y)), m = std::min(std::abs(x), std::abs(y));
+            double const h = hypot(x, y);
+            // Near the unit circle, log|z| = log1p(|z|^2 - 1) / 2 avoids cancelling against 1.
+            re = h > .5 && h < 2. ? .5 * log1p((M - 1.) * (M + 1.) + m * m) : log(h);
+            im = atan2(y, x);
+        }
+
+        /* The principal square root, with the same branch cut as std::sqrt. */
+        [[gnu::always_inline]] static inline void csqrt(double const x, double const y, double &re, double &im) noexcept {
+            double const t = std::sqrt(.5 * (std::abs(x) + hypot(x, y)));
+            double const u = t > 0. ? std::abs(y) / (2. * t) : 0.;
+            re = signbit(x) ? u : t;
+            im = signbit(x) ? copysign(t, y) : (t > 0. ? y / (2. * t) : y);
+        }
+
+        [[gnu::always_inline]] static inline void csin(double const x, double const y, double &re, double &im) noexcept {
+            double s, c, sh, ch;
+            sincos(x, s, c);
+            sinhcosh(y, sh, ch);
+            re = s * ch;
+            im = c * sh;
+        }
+
+        [[gnu::always_inline]] static inline void ccos(double const x, double const y, double &re, double &im) noexcept {
+            double s, c, sh, ch;
+            sincos(x, s, c);
+            sinhcosh(y, sh, ch);
+            re = c * ch;
+            im = -s * sh;
+        }
+
+        [[gnu::always_inline]] static inline void ctan(double const x, double const y, double &re, double &im) noexcept {
+            double s, c, sh, ch;
+            sincos(x, s, c);
+            sinhcosh(y, sh, ch);
+            double const d = c * c + sh * sh;
+            re = s * c / d;
+            im = sh * ch / d;
+        }
+
+        [[gnu::always_inline]] static inline void cdiv(double const a, double const b, double const c, double const d, double &re, double &im) noexcept {
+            double u, v;
+            crecip(c, d, u, v);
+            re = a * u - b * v;
+            im = a * v + b * u;
+        }
+
+        /* log(1 + w), accurate for small w. */
+        [[gnu::always_inline]] static inline void clog1p(double const x, double const y, double &re, double &im) noexcept {
+            re = .5 * log1p(x * (2. + x) + y * y);
+            im = atan2(y, 1. + x);
+        }
+
+        /* asinh(z) = log1p(z + z^2 / (sqrt(z^2 + 1) + 1)), computed in the right half-plane and extended by oddness. */
+        [[gnu::always_inline]] static inline void casinh(double const x, double const y, double &re, double &im) noexcept {
+            double const sign = signbit(x) ? -1. : 1., a = sign * x, b = sign * y;
+            double const sq_re = (a - b) * (a + b), sq_im = 2. * a * b;
+            double sr, si, qr, qi, lr, li;
+            csqrt((1. - b) * (1. + b) + a * a, sq_im, sr, si);
+            cdiv(sq_re, sq_im, sr + 1., si, qr, qi);
+            clog1p(a + qr, b + qi, lr, li);
+            re = sign * lr;
+            im = sign * li;
+        }
+
+        /* atanh(z) = (log1p(z) - log1p(-z)) / 2. */
+        [[gnu::always_inline]] static inline void catanh(double const x, double const y, double &re, double &im) noexcept {
+            double const d = (1. - x) * (1. - x) + y * y;
+            // Away from 0, the ratio |1 + z|^2 / |1 - z|^2 is accurate where log1p's argument would approach -1.
+            bool const small = std::abs(x) < .5;
+            double const arg = small ? 4. * x / d : ((1. + x) * (1. + x) + y * y) / d;
+            double const u = small ? 1. + arg : arg;
+            re = .25 * (log(u) + (small ? (arg - (u - 1.)) / u : 0.));
+            im = .5 * atan2(2. * y, (1. - x) * (1. + x) - y * y);
+        }
+
+        /* acosh(z) = 2 log(p + m) with p = sqrt((z + 1) / 2), m = sqrt((z - 1) / 2); as p^2 - 1 = m^2,
+         * p + m = 1 + m + m^2 / (p + 1). */
+        [[gnu::always_inline]] static inline void cacosh(double const x, double const y, double &re, double &im) noexcept {
+            double pr, pi, mr, mi, qr, qi, lr, li;
+            csqrt(.5 * (x + 1.), .5 * y, pr, pi);
+            csqrt(.5 * (x - 1.), .5 * y, mr, mi);
+            cdiv(.5 * (x - 1.), .5 * y, pr + 1., pi, qr, qi);
+            clog1p(mr + qr, mi + qi, lr, li);
+            re = 2. * lr;
+            im = 2. * li;
+        }
+
+        /* Kahan's acos: Re acos(z) = 2 atan2(Re sqrt(1 - z), Re sqrt(1 + z)),
+         * Im acos(z) = asinh(Im(conj(sqrt(1 + z)) sqrt(1 - z))); unlike pi / 2 - asin(z), accurate near z = 1. */
+        [[gnu::always_inline]] static inline void cacos(double const x, double const y, double &re, double &im) noexcept {
+            double pr, pi, mr, mi;
+            csqrt(1. + x, y, pr, pi);
+            csqrt(1. - x, -y, mr, mi);
+            re = 2. * atan2(mr, pr);
+            im = asinh(pr * mi - pi * mr);
+        }
+
+        /* The kernels, by opcode. */
+        template<OPCODE op>
+        [[gnu::always_inline]] static inline double kernel(double const x) noexcept {
+            if constexpr (op == OPCODE::ARG) return signbit(x) ? PI_HI : 0.;
+            else if constexpr (op == OPCODE::EXP) return exp(x);
+            else if constexpr (op == OPCODE::LN) return log(x);
+            else if constexpr (op >= OPCODE::SIN && op <= OPCODE::COT) {
+                double s, c;
+                sincos(x, s, c);
+                if constexpr (op == OPCODE::SIN) return s;
+                else if constexpr (op == OPCODE::COS) return c;
+                else if constexpr (op == OPCODE::TAN) return s / c;
+                else if constexpr (op == OPCODE::SEC) return 1. / c;
+                else if constexpr (op == OPCODE::CSC) return 1. / s;
+                else return c / s;
+            }
+            else if constexpr (op == OPCODE::SINH || op == OPCODE::COSH || op == OPCODE::SECH || op == OPCODE::CSCH) {
+                double sh, ch;
+                sinhcosh(x, sh, ch);
+                if constexpr (op == OPCODE::SINH) return sh;
+                else if constexpr (op == OPCODE::COSH) return ch;
+                else if constexpr (op == OPCODE::SECH) return 1. / ch;
+                else return 1. / sh;
+            }
+            else if constexpr (op == OPCODE::TANH) return tanh(x);
+            else if constexpr (op == OPCODE::COTH) return 1. / tanh(x);
+            else if constexpr (op == OPCODE::ARCSIN) return asin(x);
+            else if constexpr (op == OPCODE::ARCCOS) return acos(x);
+            else if constexpr (op == OPCODE::ARCTAN) return atan(x);
+            else if constexpr (op == OPCODE::ARCCSC) return asin(1. / x);
+            else if constexpr (op == OPCODE::ARCSEC) return acos(1. / x);
+            else if constexpr (op == OPCODE::ARCCOT) return atan(1. / x);
+            else if constexpr (op == OPCODE::ARSINH) return asinh(x);
+            else if constexpr (op == OPCODE::ARCOSH) return acosh(x);
+            else if constexpr (op == OPCODE::ARTANH) return atanh(x);
+            else if constexpr (op == OPCODE::ARCSCH) return asinh(1. / x);
+            else if constexpr (op == OPCODE::ARSECH) return acosh(1. / x);
+            else if constexpr (op == OPCODE::ARCOTH) return atanh(1. / x);
+        }
+
+        template<OPCODE op>
+        [[gnu::always_inline]] static inline void kernel(double x, double y, double &re, double &im) noexcept {
+            // Reciprocal functions: apply the kernel, then invert its result.
+            if constexpr (op == OPCODE::SEC || op == OPCODE::CSC || op == OPCODE::COT
+                          || op == OPCODE::SECH || op == OPCODE::CSCH || op == OPCODE::COTH) {
+                static OPCODE constexpr inner = op == OPCODE::SEC ? OPCODE::COS : op == OPCODE::CSC ? OPCODE::SIN
+                                              : op == OPCODE::COT ? OPCODE::TAN : op == OPCODE::SECH ? OPCODE::COSH
+                                              : op == OPCODE::CSCH ? OPCODE::SINH : OPCODE::TANH;
+                double u, v;
+                kernel<inner>(x, y, u, v);
+                crecip(u, v, re, im);
+                return;
+            }
+            // Inverse reciprocal functions: invert the argument, then apply the kernel.
+            else if constexpr (op == OPCODE::ARCCSC || op == OPCODE::ARCSEC || op == OPCODE::ARCCOT
+                               || op == OPCODE::ARCSCH || op == OPCODE::ARSECH || op == OPCODE::ARCOTH) {
+                static OPCODE constexpr inner = op == OPCODE::ARCCSC ? OPCODE::ARCSIN : op == OPCODE::ARCSEC ? OPCODE::ARCCOS
+                                              : op == OPCODE::ARCCOT ? OPCODE::ARCTAN : op == OPCODE::ARCSCH ? OPCODE::ARSINH
+                                              : op == OPCODE::ARSECH ? OPCODE::ARCOSH : OPCODE::ARTANH;
+                double u, v;
+                crecip(x, y, u, v);
+                kernel<inner>(u, v, re, im);
+                return;
+            }
+            else if constexpr (op == OPCODE::ABS) { re = hypot(x, y); im = 0.; }
+            else if constexpr (op == OPCODE::ARG) { re = atan2(y, x); im = 0.; }
+            else if constexpr (op == OPCODE::EXP) cexp(x, y, re, im);
+            else if constexpr (op == OPCODE::LN) clog(x, y, re, im);
+            else if constexpr (op == OPCODE::SIN) csin(x, y, re, im);
+            else if constexpr (op == OPCODE::COS) ccos(x, y, re, im);
+            else if constexpr (op == OPCODE::TAN) ctan(x, y, re, im);
+            // The hyperbolic functions are rotations of the circular ones: sinh(z) = -i sin(iz), and so on.
+            else if constexpr (op == OPCODE::SINH) { csin(-y, x, im, re); im = -im; }
+            else if constexpr (op == OPCODE::COSH) ccos(-y, x, re, im);
+            else if constexpr (op == OPCODE::TANH) { ctan(-y, x, im, re); im = -im; }
+            else if constexpr (op == OPCODE::ARSINH) casinh(x, y, re, im);
+            else if constexpr (op == OPCODE::ARTANH) catanh(x, y, re, im);
+            else if constexpr (op == OPCODE::ARCOSH) cacosh(x, y, re, im);
+            // asin(z) = -i asinh(iz), atan(z) = -i atanh(iz).
+            else if constexpr (op == OPCODE::ARCSIN) { casinh(-y, x, im, re); im = -im; }
+            else if constexpr (op == OPCODE::ARCTAN) { catanh(-y, x, im, re); im = -im; }
+            else if constexpr (op == OPCODE::ARCCOS) cacos(x, y, re, im);
+        }
+
+        template<OPCODE op, typename T>
+        bool in_range(T const x) noexcept {
+            // Zeros, and complex arguments on either axis, go to the standard library too: the kernels do not give
+            // the zeros in their results the signs that C99 Annex G does, which decide the side of a branch cut that
+            // operations after them land on.
+            if constexpr (std::is_same<T, REAL>::value) {
+                if constexpr (op == OPCODE::ARG) return x == x;
+                else if constexpr (op >= OPCODE::SIN && op <= OPCODE::COT) return std::abs(x) <= TRIG_MAX && x != 0.;
+                else if constexpr (op == OPCODE::SINH || op == OPCODE::COSH || op == OPCODE::SECH || op == OPCODE::CSCH)
+                    return std::abs(x) <= HYP_MAX && x != 0.;
+                else return finite(x) && x != 0.;
+            } else {
+                double const re = std::real(x), im = std::imag(x), M = std::max(std::abs(re), std::abs(im));
+                double const m = std::min(std::abs(re), std::abs(im));
+                if constexpr (op == OPCODE::ABS || op == OPCODE::ARG) return finite(re) && finite(im);
+                if (m == 0.) return false;
+                if constexpr (op == OPCODE::LN) return finite(re) && finite(im) && M >= 0x1p-1022;
+                else if constexpr (op == OPCODE::EXP) return std::abs(re) <= HYP_MAX && std::abs(im) <= TRIG_MAX;
+                else if constexpr (op == OPCODE::SIN || op == OPCODE::COS || op == OPCODE::SEC || op == OPCODE::CSC)
+                    return std::abs(re) <= TRIG_MAX && std::abs(im) <= HYP_MAX;
+                else if constexpr (op == OPCODE::SINH || op == OPCODE::COSH || op == OPCODE::SECH || op == OPCODE::CSCH)
+                    return std::abs(re) <= HYP_MAX && std::abs(im) <= TRIG_MAX;
+                // tan and tanh square sinh, so they stop at half the range.
+                else if constexpr (op == OPCODE::TAN || op == OPCODE::COT) return std::abs(re) <= TRIG_MAX && std::abs(im) <= HYP_MAX / 2;
+                else if constexpr (op == OPCODE::TANH || op == OPCODE::COTH) return std::abs(re) <= HYP_MAX / 2 && std::abs(im) <= TRIG_MAX;
+                else if constexpr (op == OPCODE::ARCCSC || op == OPCODE::ARCSEC || op == OPCODE::ARCCOT
+                                   || op == OPCODE::ARCSCH || op == OPCODE::ARSECH || op == OPCODE::ARCOTH)
+                    return M >= INV_MIN && M <= INV_MAX && m >= INV_MIN;
+                else return M <= INV_MAX && m >= INV_MIN;
+            }
+        }
+
+        template<OPCODE op, typename T>
+        SIMD_CLONES void run(T const *RESTRICT x, T *RESTRICT result, size_t const n) noexcept {
+            if constexpr (std::is_same<T, REAL>::value) {
+                #pragma omp simd
+                for (size_t i = 0; i < n; ++i) {
+                    result[i] = kernel<op>(x[i]);
+                }
+            } else {
+                // Work on the interleaved parts directly; the compiler de-interleaves them into vector registers.
+                double const *RESTRICT in = reinterpret_cast<double const *>(x);
+                double *RESTRICT out = reinterpret_cast<double *>(result);
+                #pragma omp simd
+                for (size_t i = 0; i < n; ++i) {
+                    double re, im;
+                    kernel<op>(in[2 * i], in[2 * i + 1], re, im);
+                    out[2 * i] = re;
+                    out[2 * i + 1] = im;
+                }
+            }
+        }
+    }
+}
@@ -1,8 +1,143 @@
 #include "Latex.h"
 #include "CFunction.h"
+#include <deque>
+#include <mutex>
 
 namespace libcalculus {
     namespace Latex {
+        static std::mutex render_mutex;
+
+        Text::Text(Kind const kind, std::string const &literal, std::vector<ptr> const &parts)
+            : kind{kind}, literal{literal}, parts{parts} {}
+
+        Text::~Text() {
+            // Released one by one, rather than recursively, for the deep texts of long expressions; see ~Expr().
+            std::vector<ptr> pending;
+            auto const release = [&](std::vector<ptr> &parts) {
+                for (ptr &part : parts) {
+                    if (part.use_count() == 1) pending.push_back(std::move(part));
+                }
+                parts.clear();
+            };
+            release(this->parts);
+            while (!pending.empty()) {
+                ptr text = std::move(pending.back());
+                pending.pop_back();
+                release(const_cast<Text &>(*text).parts);
+            }
+        }
+
+        std::string const &Text::render() const {
+            if (this->kind == Kind::LITERAL) return this->literal;
+            if (!this->done.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(render_mutex);
+                if (!this->done.load(std::memory_order_relaxed)) {
+                    this->render_into(this->rendered);
+                    this->done.store(true, std::memory_order_release);
+                }
+            }
+            return this->rendered;
+        }
+
+        /* Writes the text out without recursion: a stack holds the texts left to write, each with the substitutions in
+         * effect for it - the text its variable stands for, itself under the substitutions around it. Strings are
+         * written up to their next variable, and then the rest of the string waits under what replaces it. Texts that
+         * have been rendered before are written as strings. */
+        void Text::render_into(std::string &out) const {
+            struct Env {
+                Text const *inner;
+                Env const *parent;
+            };
+            struct Item {
+                Text const *text;
+                Env const *env;
+                size_t offset;
+            };
+            std::deque<Env> envs;
+            std::vector<Item> stack{{this, nullptr, 0}};
+            size_t constexpr var_length = sizeof(LATEX_VAR) - 1;
+            while (!stack.empty()) {
+                Item const item = stack.back();
+                stack.pop_back();
+                Text const &text = *item.text;
+                std::string const *string = text.kind == Kind::LITERAL ? &text.literal
+                                            : text.done.load(std::memory_order_acquire) ? &text.rendered : nullptr;
+                if (string != nullptr) {
+                    for (size_t pos = item.offset;;) {
+                        size_t const var = string->find(LATEX_VAR, pos);
+                        if (var == std::string::npos) {
+                            out.append(*string, pos, std::string::npos);
+                            break;
+                        }
+                        out.append(*string, pos, var - pos);
+                        pos = var + var_length;
+                        if (item.env == nullptr) {
+                            out.append(LATEX_VAR);
+                            continue;
+                        }
+                        stack.push_back({item.text, item.env, pos});
+                        stack.push_back({item.env->inner, item.env->parent, 0});
+                        break;
+                    }
+                } else if (text.kind == Kind::JOIN) {
+                    for (size_t k = text.parts.size(); k-- > 0;) stack.push_back({text.parts[k].get(), item.env, 0});
+                } else {
+                    envs.push_back({text.parts[1].get(), item.env});
+                    stack.push_back({text.parts[0].get(), &envs.back(), 0});
+                }
+            }
+        }
+
+        size_t Text::memory(std::unordered_set<void const *> &seen) const {
+            size_t result = 0;
+            std::vector<Text const *> pending{this};
+            while (!pending.empty()) {
+                Text const *text = pending.back();
+                pending.pop_back();
+                if (!seen.insert(text).second) continue;
+                result += sizeof(Text) + text->literal.capacity() + text->parts.capacity() * sizeof(ptr);
+                if (text->done.load(std::memory_order_acquire)) result += text->rendered.capacity();
+                for (ptr const &part : text->parts) pending.push_back(part.get());
+            }
+            return result;
+        }
+
+        Text::ptr Text::Literal(std::string const &literal) {
+            return std::make_shared<Text const>(Kind::LITERAL, literal, std::vector<ptr>{});
+        }
+
+        Text::ptr Text::Join(std::vector<ptr> const &parts) {
+            return std::make_shared<Text const>(Kind::JOIN, std::string{}, parts);
+        }
+
+        Text::ptr Text::Substitute(ptr const &outer, ptr const &inner) {
+            return std::make_shared<Text const>(Kind::SUBSTITUTE, std::string{}, std::vector<ptr>{outer, inner});
+        }
+
+        Text::ptr variable() {
+            static Text::ptr const text = Text::Literal(LATEX_VAR);
+            return text;
+        }
+
+        Text::ptr join(std::initializer_list<Part> const parts) {
+            std::vector<Text::ptr> texts;
+            texts.reserve(parts.size());
+            for (Part const &part : parts) texts.push_back(part.text);
+            return Text::Join(texts);
+        }
+
+        std::string with_var(std::string const &markup, std::string const &varname) {
+            std::string result;
+            size_t constexpr var_length = sizeof(LATEX_VAR) - 1;
+            size_t pos = 0;
+            for (size_t var; (var = markup.find(LATEX_VAR, pos)) != std::string::npos; pos = var + var_length) {
+                result.append(markup, pos, var - pos);
+                result.append(varname);
+            }
+            result.append(markup, pos, std::string::npos);
+            return result;
+        }
+
         std::string _parenthesize(std::string const &expr) {
             std::string result = " \\left( ";
             result.append(expr);
@@ -10,7 +145,11 @@ namespace libcalculus {
             return result;
         }
 
-        std::string parenthesize_if(std::string const &expr, OP_TYPE const new_op, OP_TYPE const last_op) {
+        Text::ptr _parenthesize(Text::ptr const &expr) {
+            return join({" \\left( ", expr, " \\right) "});
+        }
+
+        Text::ptr parenthesize_if(Text::ptr const &expr, OP_TYPE const new_op, OP_TYPE const last_op) {
             if (new_op == OP_TYPE::FUNC || new_op == OP_TYPE::DIV || new_op == OP_TYPE::RPOW) return expr;
             else if (((last_op == OP_TYPE::ADD || last_op == OP_TYPE::SUB) && (new_op == OP_TYPE::MUL || new_op == OP_TYPE::NEG))
                      || (last_op != OP_TYPE::NOP && new_op == OP_TYPE::LPOW)
@@ -38,6 +177,6 @@ namespace libcalculus {
         }
     }
 
-    template<> CFunction<COMPLEX, COMPLEX> CFunction<COMPLEX, COMPLEX>::Constant(COMPLEX c) { return CFunction([=](COMPLEX z) { return c; }, Latex::fmt_const(c, false),
+    template<> CFunction<COMPLEX, COMPLEX> CFunction<COMPLEX, COMPLEX>::Constant(COMPLEX c) { return CFunction(Tape::Constant(false, c, false), Latex::Text::Literal(Latex::fmt_const(c, false)),
                                                 (std::real(c) < 0 || std::imag(c) != 0.) ? OP_TYPE::ADD : OP_TYPE::NOP); }
 }
@@ -0,0 +1,83 @@
+#include "Profile.h"
+#include "Tape.h"
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace libcalculus {
+    namespace Profile {
+        /* The counts of a tape, kept with a weak pointer to it, so that those of a tape that is gone are not taken for
+         * those of another one allocated at the same address. */
+        struct Entry {
+            std::weak_ptr<Tape const> tape;
+            std::vector<Node> nodes;
+        };
+
+        static std::mutex mutex;
+        static std::unordered_map<Tape const *, Entry> entries;
+        static Numeric totals;
+
+        void record(Tape const &tape, Node const *nodes) {
+            std::weak_ptr<Tape const> owner = tape.weak_from_this();
+            if (owner.expired()) return;
+            std::lock_guard<std::mutex> const lock(mutex);
+            auto it = entries.find(&tape);
+            if (it == entries.end() || it->second.tape.lock().get() != &tape) {
+                // A new tape: drop the entries of those that are gone.
+                std::erase_if(entries, [](auto const &entry) { return entry.second.tape.expired(); });
+                it = entries.insert_or_assign(&tape, Entry{std::move(owner), std::vector<Node>(tape.code.size())}).first;
+            }
+            for (size_t i = 0; i < tape.code.size(); ++i) {
+                Node &node = it->second.nodes[i];
+                node.calls += nodes[i].calls;
+                node.points += nodes[i].points;
+                node.seconds += nodes[i].seconds;
+            }
+        }
+
+        void record(Numeric const &numeric) {
+            std::lock_guard<std::mutex> const lock(mutex);
+            totals.integrals += numeric.integrals;
+            totals.passes += numeric.passes;
+            totals.evaluations += numeric.evaluations;
+            totals.intervals += numeric.intervals;
+            totals.error += numeric.error;
+            totals.derivatives += numeric.derivatives;
+            totals.halvings += numeric.halvings;
+            totals.unconverged += numeric.unconverged;
+        }
+
+        std::vector<Node> nodes(Tape const &tape) {
+            std::lock_guard<std::mutex> const lock(mutex);
+            auto const it = entries.find(&tape);
+            if (it == entries.end() || it->second.tape.lock().get() != &tape) return std::vector<Node>(tape.code.size());
+            return it->second.nodes;
+        }
+
+        Numeric numeric() {
+            std::lock_guard<std::mutex> const lock(mutex);
+            return totals;
+        }
+
+        void reset() {
+            std::lock_guard<std::mutex> const lock(mutex);
+            entries.clear();
+            totals = Numeric{};
+        }
+
+        char const *name(OPCODE const op) noexcept {
+            static char const *const NAMES[] = {
+                "var", "const", "widen", "opaque", "if", "derivative", "path",
+                "add", "sub", "mul", "div", "pow",
+                "addc", "subc", "csub", "mulc", "divc", "cdiv", "powc", "cpow", "neg",
+                "re", "im", "conj", "abs", "arg", "exp", "ln",
+                "sin", "cos", "tan", "sec", "csc", "cot",
+                "sinh", "cosh", "tanh", "sech", "csch", "coth",
+                "arcsin", "arccos", "arctan", "arccsc", "arcsec", "arccot",
+                "arsinh", "arcosh", "artanh", "arcsch", "arsech", "arcoth",
+                "chebyshev",
+            };
+            return NAMES[static_cast<size_t>(op)];
+        }
+    }
+}
@@ -0,0 +1,52 @@
+# distutils: language = c++
+from Definitions cimport *
+from Profile cimport Numeric, numeric, reset
+
+cdef extern from "Profile.h":
+  cbool PROFILE "libcalculus::Profile::enabled"
+
+def profile(flag=None):
+  """Get or set whether evaluation and the numeric routines record what they do, for profile_report(). Recording times
+  every instruction of a function as it runs, so it slows evaluation down; while it is off, nothing is recorded."""
+  global PROFILE
+  if flag is not None:
+    PROFILE = flag
+  return PROFILE
+
+def profile_reset():
+  """Discard everything recorded so far."""
+  reset()
+
+cdef list _profiled_nodes(vector[ProfiledNode] nodes):
+  return [{"index": node.index, "op": node.op.decode(), "latex": node.latex.decode(),
+           "operands": tuple(node.operands),
+           "calls": node.counts.calls, "points": node.counts.points, "seconds": node.counts.seconds}
+          for node in nodes]
+
+def profile_report(f=None, str varname=None):
+  """What was recorded since profiling was enabled or last reset. "integration" counts the integrals computed by
+  quadrature, the passes of refinement, the evaluations of the integrands, the intervals they ended with and the sum
+  of their error estimates; "differentiation" counts the values of numeric derivatives, the halvings of the step, and
+  those that ran out of step before converging.
+
+  Given a function, "nodes" lists the instructions it is evaluated by, in the order they run: the operation, the
+  indices of its operands, the LaTeX of the subexpression it computes, and the calls that ran it, the points it was
+  evaluated at and the seconds it took. For a Function, "nodes" holds those of each of its real, contour and complex
+  forms. Piecewise functions count the time of their branches in the instruction choosing between them; compiled
+  functions are not profiled."""
+  cdef Numeric totals = numeric()
+  report = {"integration": {"integrals": totals.integrals, "passes": totals.passes, "evaluations": totals.evaluations,
+                            "intervals": totals.intervals, "error": totals.error},
+            "differentiation": {"derivatives": totals.derivatives, "halvings": totals.halvings, "unconverged": totals.unconverged}}
+  if isinstance(f, ComplexFunction):
+    report["nodes"] = _profiled_nodes(Profiled[COMPLEX, COMPLEX]((<ComplexFunction>f).cfunction, (varname or "z").encode()))
+  elif isinstance(f, Contour):
+    report["nodes"] = _profiled_nodes(Profiled[REAL, COMPLEX]((<Contour>f).cfunction, (varname or "t").encode()))
+  elif isinstance(f, RealFunction):
+    report["nodes"] = _profiled_nodes(Profiled[REAL, REAL]((<RealFunction>f).cfunction, (varname or "t").encode()))
+  elif isinstance(f, Function):
+    parts = {"real": (<Function>f).realfunction, "contour": (<Function>f).contour, "complex": (<Function>f).complexfunction}
+    report["nodes"] = {kind: profile_report(part, varname or "x")["nodes"] for kind, part in parts.items() if part is not None}
+  elif f is not None:
+    raise TypeError(f"cannot profile {type(f)}")
+  return report
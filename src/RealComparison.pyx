@@ -14,10 +14,17 @@ cdef class RealComparison:
   @cython.boundscheck(False)
   @cython.wraparound(False)
   cdef np.ndarray[cbool] _call_array(RealComparison self, np.ndarray[const REAL] t):
-    cdef np.ndarray[cbool] result = np.zeros_like(t, dtype=bool)
-    for i in range(t.shape[0]):
-      result[i] = self.ccomparison.eval(t[i])
-    return result
+    """Evaluate the comparison on an np.ndarray, into a mask of bits that is then unpacked."""
+    cdef size_t i, n = t.shape[0]
+    cdef uint64_t[::1] mask = np.empty((n + 63) // 64 + 1, dtype=np.uint64)
+    cdef np.npy_bool[::1] result = np.empty(n, dtype=np.bool_)
+    if n == 0:
+      return np.asarray(result, dtype=bool)
+    with nogil:
+      self.ccomparison._call_array(&t[0], &mask[0], n)
+    for i in range(n):
+      result[i] = (mask[i >> 6] >> (i & 63)) & 1
+    return np.asarray(result, dtype=bool)
 
   def copy(RealComparison self):
     """Create a copy of the object."""
@@ -25,6 +32,24 @@ cdef class RealComparison:
     result.ccomparison = CComparison[REAL](self.ccomparison)
     return result
 
+  def to_bytes(RealComparison self):
+    """The comparison in libcalculus' binary format, which from_bytes(), libcalculus.loads() and pickle read back."""
+    cdef string data
+    with nogil:
+      data = dump_comparison[REAL](self.ccomparison)
+    return <bytes>data
+
+  @staticmethod
+  def from_bytes(const unsigned char[::1] data not None):
+    """Load a comparison from what to_bytes() returned, in bytes or any other buffer such as a memory-mapped file."""
+    cdef RealComparison result = RealComparison()
+    with nogil:
+      result.ccomparison = load_comparison[REAL](_data(data), data.shape[0])
+    return result
+
+  def __reduce__(RealComparison self):
+    return loads, (self.to_bytes(),)
+
   def __call__(RealComparison self, t):
     if isinstance(t, (int, float)):
       return self.ccomparison.eval(t)
@@ -1,24 +1,22 @@
 # distutils: language = c++
-from cython.parallel import prange
 
 cdef class RealFunction:
   cdef CFunction[REAL, REAL] cfunction
 
-  @cython.nonecheck(False)
-  @cython.boundscheck(False)
-  @cython.wraparound(False)
-  cdef np.ndarray[REAL] _call_array(RealFunction self, np.ndarray[const REAL] t):
-    """Evaluate the function on an np.ndarray."""
-    cdef REAL[::1] result = np.empty(t.size, dtype=np.double)
-    cdef size_t i, n = t.size
-    if Globals.NUM_THREADS > 1:
-      # Use threading instead of SIMD.
-      for i in prange(n, nogil=True, num_threads=Globals.NUM_THREADS):
-        result[i] = self.cfunction(t[i])
-    else:
-      # Use SIMD
-      self.cfunction._call_array(&t[0], &result[0], n)
-    return np.asarray(result)
+  cdef _call_array(RealFunction self, np.ndarray t, out, where):
+    """Evaluate the function on an np.ndarray of any strides, into out or a new array, where where holds."""
+    dtype = t.dtype if t.dtype in (np.float32, np.longdouble) else np.dtype(np.double)
+    cdef _Operands a = _Operands(t, out, where, dtype, dtype)
+    cdef char kind = ord(dtype.char)
+    # The C++ side splits the array between the threads of its pool.
+    with nogil:
+      if kind == b'f':
+        self.cfunction._call_strided(<REAL_SINGLE *>a.z_data, <REAL_SINGLE *>a.out_data, a.where_data, a.ndim, a.shape.data(), a.strides.data())
+      elif kind == b'g':
+        self.cfunction._call_strided(<REAL_EXTENDED *>a.z_data, <REAL_EXTENDED *>a.out_data, a.where_data, a.ndim, a.shape.data(), a.strides.data())
+      else:
+        self.cfunction._call_strided(<REAL *>a.z_data, <REAL *>a.out_data, a.where_data, a.ndim, a.shape.data(), a.strides.data())
+    return a.result()
 
   def copy(RealFunction self):
     """Create a copy of the object."""
@@ -26,14 +24,16 @@ cdef class RealFunction:
     result.cfunction = CFunction[REAL, REAL](self.cfunction)
     return result
 
-  def __call__(RealFunction self, t):
-    """Evaluate the function at a point or on an np.ndarray of points."""
-    if isinstance(t, (int, float, complex)):
+  def __call__(RealFunction self, t, out=None, where=True):
+    """Evaluate the function at a point or on an np.ndarray of points; arrays of float32 are evaluated in single
+    precision, and of longdouble in extended precision, into arrays of that precision. As with NumPy's ufuncs, the
+    values are written into out if it is given, which t is broadcast to and which they are cast into under the
+    'same_kind' rule, and only where where holds, and a 0-d array without out gives a scalar; arrays of any strides are
+    read and written in place."""
+    if out is None and where is True and isinstance(t, (int, float, complex)):
       return self.cfunction(t)
-    elif isinstance(t, np.ndarray) and t.dtype == np.double:
-      return self._call_array(t.ravel()).reshape(t.shape)
-    elif isinstance(t, np.ndarray) and np.issubdtype(t.dtype, np.number):
-      return self._call_array(t.ravel().astype(np.double, copy=False)).reshape(t.shape)
+    elif isinstance(t, (int, float)) or (isinstance(t, np.ndarray) and np.issubdtype(t.dtype, np.number)):
+      return self._call_array(np.asarray(t), out, where)
     else:
       raise NotImplementedError(type(t))
 
@@ -41,6 +41,47 @@ cdef class RealFunction:
     """Generate LaTeX markup for the function."""
     return self.cfunction.latex(varname.encode()).decode()
 
+  def compile(RealFunction self):
+    """Compile the function to native code, which evaluates it faster; the result is cached on disk."""
+    cdef RealFunction F = RealFunction()
+    with nogil:
+      F.cfunction = self.cfunction.compile()
+    return F
+
+  def approximate(RealFunction self, REAL a, REAL b, REAL tol = 1e-10):
+    """A piecewise Chebyshev interpolant of the function over [a, b], to within tol times its largest magnitude there
+    (or tol where that is below 1), which is cheap to evaluate, and which is differentiated and integrated exactly."""
+    cdef RealFunction F = RealFunction()
+    with nogil:
+      F.cfunction = self.cfunction.approximate(a, b, tol)
+    return F
+
+  def deduplicated(RealFunction self):
+    """The number of operations shared with an identical subexpression instead of being evaluated separately."""
+    return self.cfunction.deduplicated()
+
+  def memory_usage(RealFunction self):
+    """The number of bytes the function holds, including the parts it shares with the functions it was built from."""
+    return self.cfunction.memory()
+
+  def to_bytes(RealFunction self):
+    """The function in libcalculus' binary format, which from_bytes(), libcalculus.loads() and pickle read back."""
+    cdef string data
+    with nogil:
+      data = dump[REAL, REAL](self.cfunction)
+    return <bytes>data
+
+  @staticmethod
+  def from_bytes(const unsigned char[::1] data not None):
+    """Load a function from what to_bytes() returned, in bytes or any other buffer such as a memory-mapped file."""
+    cdef RealFunction F = RealFunction()
+    with nogil:
+      F.cfunction = load_function[REAL, REAL](_data(data), data.shape[0])
+    return F
+
+  def __reduce__(RealFunction self):
+    return loads, (self.to_bytes(),)
+
   def _compose(RealFunction self, RealFunction rhs not None):
     """Compose the function with another RealFunction."""
     cdef RealFunction F = RealFunction()
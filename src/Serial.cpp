@@ -0,0 +1,586 @@
+#include "Serial.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace libcalculus {
+    namespace Serial {
+        static inline uint32_t constexpr NONE = UINT32_MAX; // A reference to nothing.
+        static inline uint32_t constexpr BYTE_ORDER_MARK = 0x01020304;
+
+        struct Header {
+            char magic[8];
+            uint32_t version, byte_order, object, records;
+            uint64_t size;
+        };
+        static_assert(sizeof(Header) == 32);
+        static char constexpr MAGIC[8] = {'l', 'i', 'b', 'c', 'a', 'l', 'c', '\0'};
+
+        static inline void malformed(char const *what) {
+            throw std::invalid_argument(std::string("malformed libcalculus data: ") + what);
+        }
+
+        template<typename Dom, typename Ran>
+        static inline Object constexpr function_object() {
+            if constexpr (!is_real<Dom>) return Object::COMPLEX_FUNCTION;
+            else if constexpr (!is_real<Ran>) return Object::CONTOUR;
+            else return Object::REAL_FUNCTION;
+        }
+
+        template<typename Dom>
+        static inline Object constexpr comparison_object() {
+            return is_real<Dom> ? Object::REAL_COMPARISON : Object::COMPLEX_COMPARISON;
+        }
+
+        /* Writing */
+        Writer::Writer(Object const object) {
+            Header header{};
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            header.byte_order = BYTE_ORDER_MARK;
+            header.object = object;
+            this->out.append(reinterpret_cast<char const *>(&header), sizeof(Header));
+        }
+
+        std::string Writer::finish() {
+            Header header;
+            std::memcpy(&header, this->out.data(), sizeof(Header));
+            header.records = this->records;
+            header.size = this->out.size();
+            std::memcpy(this->out.data(), &header, sizeof(Header));
+            return std::move(this->out);
+        }
+
+        uint32_t Writer::id(Record const type, void const *object) const {
+            if (object == nullptr) return NONE;
+            auto const &ids = this->ids[static_cast<size_t>(type)];
+            auto const it = ids.find(object);
+            return it == ids.end() ? NONE : it->second;
+        }
+
+        Tape const *Writer::tape(Expr const &expr) const {
+            if (expr.kind == Expr::Kind::LEAF || (this->roots.count(&expr) && expr.built.load(std::memory_order_acquire)))
+                return expr.cached.get();
+            return nullptr;
+        }
+
+        /* Records are written in postorder, without recursion, so that deep expressions and texts fit on the stack. */
+        void Writer::visit(Record const type, void const *object) {
+            std::vector<std::pair<Item, bool>> stack{{{type, object}, false}};
+            while (!stack.empty()) {
+                auto const [item, expanded] = stack.back();
+                if (item.object == nullptr || this->id(item.type, item.object) != NONE) {
+                    stack.pop_back();
+                } else if (expanded) {
+                    stack.pop_back();
+                    this->emit(item);
+                } else {
+                    stack.back().second = true;
+                    for (Item const &child : this->children(item)) {
+                        if (child.object != nullptr && this->id(child.type, child.object) == NONE) stack.push_back({child, false});
+                    }
+                }
+            }
+        }
+
+        std::vector<Writer::Item> Writer::children(Item const &item) const {
+            std::vector<Item> result;
+            switch (item.type) {
+                case Record::TEXT:
+                    for (Latex::Text::ptr const &part : static_cast<Latex::Text const *>(item.object)->parts) result.push_back({Record::TEXT, part.get()});
+                    break;
+                case Record::CONDITION: {
+                    Condition const &condition = *static_cast<Condition const *>(item.object);
+                    result = {{Record::EXPR, condition.lhs.get()}, {Record::EXPR, condition.rhs.get()},
+                              {Record::CONDITION, condition.a.get()}, {Record::CONDITION, condition.b.get()}};
+                    break;
+                }
+                case Record::TAPE: {
+                    Tape const &tape = *static_cast<Tape const *>(item.object);
+                    if (!tape.opaques.empty()) throw std::invalid_argument("functions of opaque callables cannot be written out");
+                    for (auto const &branch : tape.branches) {
+                        result.insert(result.end(), {{Record::TAPE, branch->then_.get()}, {Record::TAPE, branch->else_.get()},
+                                                     {Record::TEXT, branch->latex.get()}, {Record::CONDITION, branch->condition.get()}});
+                    }
+                    for (auto const &diff : tape.diffs) result.push_back({Record::TAPE, diff->f.get()});
+                    for (auto const &path : tape.paths) result.push_back({Record::PATH, path.get()});
+                    for (auto const &chebyshev : tape.chebyshevs) result.push_back({Record::CHEBYSHEV, chebyshev.get()});
+                    break;
+                }
+                case Record::CHEBYSHEV:
+                    result.push_back({Record::TEXT, static_cast<Tape::Chebyshev const *>(item.object)->latex.get()});
+                    break;
+                case Record::EXPR: {
+                    Expr const &expr = *static_cast<Expr const *>(item.object);
+                    result = {{Record::EXPR, expr.a.get()}, {Record::EXPR, expr.b.get()}, {Record::TAPE, this->tape(expr)}};
+                    break;
+                }
+                default:
+                    break;
+            }
+            return result;
+        }
+
+        void Writer::emit(Item const &item) {
+            this->put(item.type);
+            switch (item.type) {
+                case Record::TEXT: {
+                    Latex::Text const &text = *static_cast<Latex::Text const *>(item.object);
+                    this->put(text.kind);
+                    if (text.kind == Latex::Text::Kind::LITERAL) {
+                        this->put(static_cast<uint32_t>(text.literal.size()));
+                        this->out.append(text.literal);
+                    } else {
+                        this->put(static_cast<uint32_t>(text.parts.size()));
+                        for (Latex::Text::ptr const &part : text.parts) this->put(this->id(Record::TEXT, part.get()));
+                    }
+                    break;
+                }
+                case Record::PATH: {
+                    Tape::Path const &path = *static_cast<Tape::Path const *>(item.object);
+                    this->put(static_cast<uint32_t>(path.pieces.size()));
+                    for (Tape::Path::Piece const &piece : path.pieces) {
+                        for (REAL const x : {piece.start, piece.end, piece.a.real(), piece.a.imag(), piece.b.real(), piece.b.imag(), piece.omega}) this->put(x);
+                    }
+                    break;
+                }
+                case Record::CHEBYSHEV: {
+                    Tape::Chebyshev const &chebyshev = *static_cast<Tape::Chebyshev const *>(item.object);
+                    this->put(this->id(Record::TEXT, chebyshev.latex.get()));
+                    this->put(chebyshev.error);
+                    this->put(static_cast<uint32_t>(chebyshev.pieces.size()));
+                    for (Tape::Chebyshev::Piece const &piece : chebyshev.pieces) {
+                        this->put(piece.start);
+                        this->put(piece.end);
+                        this->put(static_cast<uint32_t>(piece.coeffs.size()));
+                        for (COMPLEX const c : piece.coeffs) {
+                            this->put(c.real());
+                            this->put(c.imag());
+                        }
+                    }
+                    break;
+                }
+                case Record::CONDITION: {
+                    Condition const &condition = *static_cast<Condition const *>(item.object);
+                    this->put(condition.kind);
+                    this->put(condition.ran_real);
+                    this->put(this->id(Record::EXPR, condition.lhs.get()));
+                    this->put(this->id(Record::EXPR, condition.rhs.get()));
+                    this->put(this->id(Record::CONDITION, condition.a.get()));
+                    this->put(this->id(Record::CONDITION, condition.b.get()));
+                    break;
+                }
+                case Record::TAPE: {
+                    Tape const &tape = *static_cast<Tape const *>(item.object);
+                    this->put(tape.native != nullptr);
+                    this->put(static_cast<uint32_t>(tape.code.size()));
+                    this->put(tape.root);
+                    this->put(tape.n_regs);
+                    this->put(static_cast<uint64_t>(tape.deduplicated));
+                    for (size_t i = 0; i < tape.code.size(); ++i) {
+                        Instruction const &instr = tape.code[i];
+                        this->put(instr.op);
+                        this->put(instr.real);
+                        this->put(instr.a);
+                        this->put(instr.b);
+                        this->put(instr.aux);
+                        this->put(instr.c.real());
+                        this->put(instr.c.imag());
+                        this->put(tape.dst[i]);
+                    }
+                    this->put(static_cast<uint32_t>(tape.branches.size()));
+                    for (auto const &branch : tape.branches) {
+                        this->put(this->id(Record::TAPE, branch->then_.get()));
+                        this->put(this->id(Record::TAPE, branch->else_.get()));
+                        this->put(this->id(Record::TEXT, branch->latex.get()));
+                        this->put(this->id(Record::CONDITION, branch->condition.get()));
+                    }
+                    this->put(static_cast<uint32_t>(tape.diffs.size()));
+                    for (auto const &diff : tape.diffs) {
+                        this->put(this->id(Record::TAPE, diff->f.get()));
+                        this->put(static_cast<uint64_t>(diff->order));
+                    }
+                    this->put(static_cast<uint32_t>(tape.paths.size()));
+                    for (auto const &path : tape.paths) this->put(this->id(Record::PATH, path.get()));
+                    this->put(static_cast<uint32_t>(tape.chebyshevs.size()));
+                    for (auto const &chebyshev : tape.chebyshevs) this->put(this->id(Record::CHEBYSHEV, chebyshev.get()));
+                    break;
+                }
+                case Record::EXPR: {
+                    Expr const &expr = *static_cast<Expr const *>(item.object);
+                    this->put(expr.kind);
+                    this->put(expr.op);
+                    this->put(expr.dom_real);
+                    this->put(expr.ran_real);
+                    this->put(expr.c.real());
+                    this->put(expr.c.imag());
+                    this->put(this->id(Record::EXPR, expr.a.get()));
+                    this->put(this->id(Record::EXPR, expr.b.get()));
+                    this->put(this->id(Record::TAPE, this->tape(expr)));
+                    break;
+                }
+                default:
+                    break;
+            }
+            auto &ids = this->ids[static_cast<size_t>(item.type)];
+            ids.emplace(item.object, ids.size());
+            ++this->records;
+        }
+
+        template<typename Dom, typename Ran>
+        void Writer::function(CFunction<Dom, Ran> const &f) {
+            this->roots.insert(f._expr.get());
+            if (f._operand) this->roots.insert(f._operand->_expr.get());
+            this->visit(Record::EXPR, f._expr.get());
+            this->visit(Record::TEXT, f._latex.get());
+            if (f._operand) {
+                this->visit(Record::EXPR, f._operand->_expr.get());
+                this->visit(Record::TEXT, f._operand->_latex.get());
+            }
+            this->put(Record::FUNCTION);
+            this->put(this->id(Record::EXPR, f._expr.get()));
+            this->put(this->id(Record::TEXT, f._latex.get()));
+            this->put(static_cast<uint8_t>(f._last_op));
+            this->put(f._operand ? this->id(Record::EXPR, f._operand->_expr.get()) : NONE);
+            this->put(f._operand ? this->id(Record::TEXT, f._operand->_latex.get()) : NONE);
+            this->put(static_cast<uint8_t>(f._operand ? f._operand->_last_op : OP_TYPE::NOP));
+            ++this->records;
+        }
+
+        template<typename Dom>
+        void Writer::comparison(CComparison<Dom> const &c) {
+            this->visit(Record::CONDITION, c.condition.get());
+            this->visit(Record::TEXT, c.latex.get());
+            this->put(Record::COMPARISON);
+            this->put(this->id(Record::CONDITION, c.condition.get()));
+            this->put(this->id(Record::TEXT, c.latex.get()));
+            ++this->records;
+        }
+
+        template<typename Dom, typename Ran>
+        std::string dump(CFunction<Dom, Ran> const &f) {
+            Writer writer(function_object<Dom, Ran>());
+            writer.function(f);
+            return writer.finish();
+        }
+
+        template<typename Dom>
+        std::string dump(CComparison<Dom> const &c) {
+            Writer writer(comparison_object<Dom>());
+            writer.comparison(c);
+            return writer.finish();
+        }
+
+        /* Reading */
+        Reader::Reader(char const *data, size_t const size) : cursor{data}, end{data + size} {
+            Header header;
+            if (data == nullptr || size < sizeof(Header)) malformed("too short");
+            std::memcpy(&header, data, sizeof(Header));
+            if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) malformed("not libcalculus data");
+            if (header.byte_order != BYTE_ORDER_MARK) throw std::invalid_argument("libcalculus data written on a machine of another byte order");
+            if (header.version > VERSION) throw std::invalid_argument("libcalculus data written by a newer version");
+            if (header.size > size) malformed("truncated");
+            if (header.object > Object::REAL_COMPARISON || header.records == 0) malformed("unknown object");
+            this->object = static_cast<Object>(header.object);
+            this->version = header.version;
+            this->records = header.records;
+            this->cursor += sizeof(Header);
+            this->end = data + header.size;
+        }
+
+        template<typename T>
+        T Reader::get() {
+            if constexpr (std::is_same<T, bool>::value) {
+                return this->get<uint8_t>() != 0;
+            } else {
+                if (static_cast<size_t>(this->end - this->cursor) < sizeof(T)) malformed("truncated");
+                T value;
+                std::memcpy(&value, this->cursor, sizeof(T));
+                this->cursor += sizeof(T);
+                return value;
+            }
+        }
+
+        template<typename T>
+        T Reader::ref(std::vector<T> const &table, bool const optional) {
+            uint32_t const id = this->get<uint32_t>();
+            if (id == NONE && optional) return nullptr;
+            if (id >= table.size()) malformed("reference to a missing record");
+            return table[id];
+        }
+
+        void Reader::read(Record const root) {
+            for (uint32_t k = 0; k + 1 < this->records; ++k) {
+                switch (this->get<Record>()) {
+                    case Record::TEXT: this->text(); break;
+                    case Record::PATH: this->path(); break;
+                    case Record::CHEBYSHEV: this->chebyshev(); break;
+                    case Record::CONDITION: this->condition(); break;
+                    case Record::TAPE: this->tape(); break;
+                    case Record::EXPR: this->expr(); break;
+                    default: malformed("unknown record");
+                }
+            }
+            if (this->get<Record>() != root) malformed("unknown object");
+        }
+
+        void Reader::text() {
+            auto const kind = this->get<Latex::Text::Kind>();
+            uint32_t const n = this->get<uint32_t>();
+            if (kind == Latex::Text::Kind::LITERAL) {
+                if (static_cast<size_t>(this->end - this->cursor) < n) malformed("truncated");
+                this->texts.push_back(Latex::Text::Literal(std::string(this->cursor, n)));
+                this->cursor += n;
+            } else if (kind == Latex::Text::Kind::JOIN) {
+                std::vector<Latex::Text::ptr> parts;
+                parts.reserve(std::min<size_t>(n, this->end - this->cursor));
+                for (uint32_t k = 0; k < n; ++k) parts.push_back(this->ref(this->texts));
+                this->texts.push_back(Latex::Text::Join(parts));
+            } else if (kind == Latex::Text::Kind::SUBSTITUTE && n == 2) {
+                Latex::Text::ptr const outer = this->ref(this->texts), inner = this->ref(this->texts);
+                this->texts.push_back(Latex::Text::Substitute(outer, inner));
+            } else malformed("unknown text");
+        }
+
+        void Reader::path() {
+            uint32_t const n = this->get<uint32_t>();
+            if (n == 0) malformed("empty path");
+            Tape::Path path;
+            path.pieces.reserve(std::min<size_t>(n, this->end - this->cursor));
+            for (uint32_t k = 0; k < n; ++k) {
+                Tape::Path::Piece piece;
+                piece.start = this->get<REAL>();
+                piece.end = this->get<REAL>();
+                piece.a = {this->get<REAL>(), this->get<REAL>()};
+                piece.b = {this->get<REAL>(), this->get<REAL>()};
+                piece.omega = this->get<REAL>();
+                path.pieces.push_back(piece);
+            }
+            this->paths.push_back(std::make_shared<Tape::Path const>(std::move(path)));
+        }
+
+        void Reader::chebyshev() {
+            Tape::Chebyshev chebyshev;
+            chebyshev.latex = this->ref(this->texts);
+            chebyshev.error = this->get<REAL>();
+            uint32_t const n = this->get<uint32_t>();
+            if (n == 0) malformed("empty interpolant");
+            chebyshev.pieces.reserve(std::min<size_t>(n, this->end - this->cursor));
+            for (uint32_t k = 0; k < n; ++k) {
+                Tape::Chebyshev::Piece piece;
+                piece.start = this->get<REAL>();
+                piece.end = this->get<REAL>();
+                uint32_t const size = this->get<uint32_t>();
+                if (size == 0) malformed("empty interpolant");
+                piece.coeffs.reserve(std::min<size_t>(size, this->end - this->cursor));
+                for (uint32_t j = 0; j < size; ++j) piece.coeffs.push_back({this->get<REAL>(), this->get<REAL>()});
+                chebyshev.pieces.push_back(std::move(piece));
+            }
+            this->chebyshevs.push_back(std::make_shared<Tape::Chebyshev const>(std::move(chebyshev)));
+        }
+
+        void Reader::condition() {
+            Condition condition;
+            condition.kind = this->get<Condition::Kind>();
+            condition.ran_real = this->get<bool>();
+            condition.lhs = this->ref(this->exprs, true);
+            condition.rhs = this->ref(this->exprs, true);
+            condition.a = this->ref(this->conditions, true);
+            condition.b = this->ref(this->conditions, true);
+            if (condition.kind > Condition::Kind::AND) malformed("unknown condition");
+            if (condition.kind < Condition::Kind::NOT && (!condition.lhs || !condition.rhs ||
+                                                          condition.lhs->ran_real != condition.ran_real || condition.rhs->ran_real != condition.ran_real))
+                malformed("comparison of missing functions");
+            this->conditions.push_back(std::make_shared<Condition const>(std::move(condition)));
+        }
+
+        void Reader::tape() {
+            bool const compiled = this->get<bool>();
+            uint32_t const n = this->get<uint32_t>();
+            Tape tape;
+            tape.root = this->get<uint32_t>();
+            tape.n_regs = this->get<uint32_t>();
+            tape.deduplicated = this->get<uint64_t>();
+            if (n == 0 || tape.root >= n) malformed("tape without a root");
+            if (tape.n_regs > n) malformed("tape with more registers than instructions");
+            tape.code.reserve(std::min<size_t>(n, this->end - this->cursor));
+            tape.dst.reserve(tape.code.capacity());
+            for (uint32_t i = 0; i < n; ++i) {
+                Instruction instr;
+                instr.op = this->get<OPCODE>();
+                instr.real = this->get<bool>();
+                instr.a = this->get<uint32_t>();
+                instr.b = this->get<uint32_t>();
+                instr.aux = this->get<uint32_t>();
+                instr.c = {this->get<REAL>(), this->get<REAL>()};
+                tape.code.push_back(instr);
+                tape.dst.push_back(this->get<uint32_t>());
+            }
+            for (uint32_t k = this->get<uint32_t>(); k > 0; --k) {
+                Tape::ptr const then_ = this->ref(this->tapes), else_ = this->ref(this->tapes);
+                Latex::Text::ptr const latex = this->ref(this->texts);
+                std::shared_ptr<Condition const> const condition = this->ref(this->conditions, true);
+                bool const dom_real = tape.code[0].real;
+                if (then_->dom_real() != dom_real || else_->dom_real() != dom_real || then_->ran_real() != else_->ran_real())
+                    malformed("branches of another kind");
+                CComparison<REAL> real_cond;
+                CComparison<COMPLEX> complex_cond;
+                if (dom_real) real_cond = this->rebuild<REAL>(condition);
+                else complex_cond = this->rebuild<COMPLEX>(condition);
+                Tape::Branch branch = dom_real ? real_cond.branch(then_, else_) : complex_cond.branch(then_, else_);
+                branch.latex = latex;
+                tape.branches.push_back(std::make_shared<Tape::Branch const>(std::move(branch)));
+            }
+            for (uint32_t k = this->get<uint32_t>(); k > 0; --k) {
+                Tape::ptr const f = this->ref(this->tapes);
+                uint64_t const order = this->get<uint64_t>();
+                if (order > DERIVATIVE_MAX_ORDER) malformed("derivative of too high an order");
+                tape.diffs.push_back(std::make_shared<Tape::Diff const>(Tape::Diff{f, static_cast<size_t>(order)}));
+            }
+            for (uint32_t k = this->get<uint32_t>(); k > 0; --k) tape.paths.push_back(this->ref(this->paths));
+            if (this->version >= 2) {
+                for (uint32_t k = this->get<uint32_t>(); k > 0; --k) tape.chebyshevs.push_back(this->ref(this->chebyshevs));
+            }
+
+            // The tape is evaluated as it is, so it must not refer to anything it does not have. Every instruction but
+            // the argument resolves the registers of both its operands, whether it uses them or not.
+            if (tape.code[0].op != OPCODE::VAR) malformed("tape without an argument");
+            for (uint32_t i = 0; i < n; ++i) {
+                Instruction const &instr = tape.code[i];
+                if (instr.op > OPCODE::CHEBYSHEV || instr.op == OPCODE::OPAQUE || tape.dst[i] >= tape.n_regs ||
+                    (i > 0 && (instr.a >= i || instr.b >= i)) ||
+                    (instr.op == OPCODE::IF && instr.aux >= tape.branches.size()) ||
+                    (instr.op == OPCODE::DERIVATIVE && instr.aux >= tape.diffs.size()) ||
+                    (instr.op == OPCODE::PATH && instr.aux >= tape.paths.size()) ||
+                    (instr.op == OPCODE::CHEBYSHEV && instr.aux >= tape.chebyshevs.size()))
+                    malformed("invalid instruction");
+            }
+            Tape::ptr result = std::make_shared<Tape const>(std::move(tape));
+            if (compiled) {
+                try {
+                    result = Jit::compile(*result);
+                } catch (std::runtime_error const &) {}
+            }
+            this->tapes.push_back(result);
+        }
+
+        void Reader::expr() {
+            auto const kind = this->get<Expr::Kind>();
+            auto const op = this->get<OPCODE>();
+            bool const dom_real = this->get<bool>(), ran_real = this->get<bool>();
+            COMPLEX const c{this->get<REAL>(), this->get<REAL>()};
+            Expr::ptr const a = this->ref(this->exprs, true), b = this->ref(this->exprs, true);
+            Tape::ptr const tape = this->ref(this->tapes, true);
+            Expr::ptr node;
+            switch (kind) {
+                case Expr::Kind::LEAF:
+                    if (tape) node = Expr::Leaf(tape);
+                    break;
+                case Expr::Kind::UNARY:
+                    if (a && (op == OPCODE::NEG || op == OPCODE::WIDEN || (op >= OPCODE::RE && op <= OPCODE::ARCOTH))) node = Expr::Unary(op, a);
+                    break;
+                case Expr::Kind::BINARY:
+                    if (a && b && is_binary(op) && a->dom_real == b->dom_real && a->ran_real == b->ran_real) node = Expr::Binary(op, a, b);
+                    break;
+                case Expr::Kind::WITH_CONST:
+                    if (a && op >= OPCODE::ADDC && op <= OPCODE::CPOW) node = Expr::WithConst(op, a, c);
+                    break;
+                case Expr::Kind::COMPOSE:
+                    if (a && b && a->dom_real == b->ran_real) node = Expr::Compose(a, b);
+                    break;
+            }
+            if (!node || node->dom_real != dom_real || node->ran_real != ran_real) malformed("invalid expression");
+            if (tape && kind != Expr::Kind::LEAF) {
+                if (tape->dom_real() != dom_real || tape->ran_real() != ran_real) malformed("tape of another kind");
+                Expr &built = const_cast<Expr &>(*node);
+                built.cached = tape;
+                built.built.store(true, std::memory_order_release);
+            }
+            this->exprs.push_back(node);
+        }
+
+        template<typename Dom, typename Ran>
+        CComparison<Dom> Reader::compare(Condition const &condition) {
+            CFunction<Dom, Ran> const lhs(condition.lhs, Latex::variable(), OP_TYPE::NOP), rhs(condition.rhs, Latex::variable(), OP_TYPE::NOP);
+            if constexpr (is_real<Ran>) {
+                switch (condition.kind) {
+                    case Condition::Kind::GT: return lhs > rhs;
+                    case Condition::Kind::LT: return lhs < rhs;
+                    case Condition::Kind::GE: return lhs >= rhs;
+                    case Condition::Kind::LE: return lhs <= rhs;
+                    default: break;
+                }
+            }
+            if (condition.kind == Condition::Kind::EQ) return lhs == rhs;
+            if (condition.kind == Condition::Kind::NE) return lhs != rhs;
+            malformed("ordering of complex values");
+            return CComparison<Dom>();
+        }
+
+        /* The code evaluating a condition, made again by the same operators that made it; comparisons are shallow. */
+        template<typename Dom>
+        CComparison<Dom> Reader::rebuild(std::shared_ptr<Condition const> const &condition) const {
+            if (!condition) return CComparison<Dom>();
+            CComparison<Dom> result;
+            switch (condition->kind) {
+                case Condition::Kind::NOT: result = ~this->rebuild<Dom>(condition->a); break;
+                case Condition::Kind::OR: result = this->rebuild<Dom>(condition->a) | this->rebuild<Dom>(condition->b); break;
+                case Condition::Kind::AND: result = this->rebuild<Dom>(condition->a) & this->rebuild<Dom>(condition->b); break;
+                default:
+                    if (condition->lhs->dom_real != is_real<Dom> || condition->rhs->dom_real != is_real<Dom>) malformed("comparison of another kind");
+                    if (condition->ran_real && !is_real<Dom>) malformed("comparison of another kind");
+                    if constexpr (is_real<Dom>) {
+                        result = condition->ran_real ? Reader::compare<Dom, REAL>(*condition) : Reader::compare<Dom, COMPLEX>(*condition);
+                    } else {
+                        result = Reader::compare<Dom, COMPLEX>(*condition);
+                    }
+            }
+            result.condition = condition;
+            return result;
+        }
+
+        template<typename Dom, typename Ran>
+        CFunction<Dom, Ran> Reader::function() {
+            if (this->object != function_object<Dom, Ran>()) throw std::invalid_argument("libcalculus data of another kind of object");
+            this->read(Record::FUNCTION);
+            Expr::ptr const expr = this->ref(this->exprs);
+            Latex::Text::ptr const latex = this->ref(this->texts);
+            auto const last_op = this->get<uint8_t>();
+            Expr::ptr const operand_expr = this->ref(this->exprs, true);
+            Latex::Text::ptr const operand_latex = this->ref(this->texts, true);
+            auto const operand_last_op = this->get<uint8_t>();
+            if (last_op > OP_TYPE::IF || operand_last_op > OP_TYPE::IF) malformed("unknown operation");
+            for (Expr::ptr const &e : {expr, operand_expr}) {
+                if (e && (e->dom_real != is_real<Dom> || e->ran_real != is_real<Ran>)) malformed("function of another kind");
+            }
+            if (operand_expr && !operand_latex) malformed("operand without markup");
+            if (operand_expr) return CFunction<Dom, Ran>(expr, latex, static_cast<OP_TYPE>(last_op),
+                                                         CFunction<Dom, Ran>(operand_expr, operand_latex, static_cast<OP_TYPE>(operand_last_op)));
+            return CFunction<Dom, Ran>(expr, latex, static_cast<OP_TYPE>(last_op));
+        }
+
+        template<typename Dom>
+        CComparison<Dom> Reader::comparison() {
+            if (this->object != comparison_object<Dom>()) throw std::invalid_argument("libcalculus data of another kind of object");
+            this->read(Record::COMPARISON);
+            std::shared_ptr<Condition const> const condition = this->ref(this->conditions, true);
+            Latex::Text::ptr const latex = this->ref(this->texts);
+            CComparison<Dom> result = this->rebuild<Dom>(condition);
+            result.latex = latex;
+            return result;
+        }
+
+        Object object(char const *data, size_t const size) {
+            return Reader(data, size).object;
+        }
+
+        template<typename Dom, typename Ran>
+        CFunction<Dom, Ran> load_function(char const *data, size_t const size) {
+            return Reader(data, size).function<Dom, Ran>();
+        }
+
+        template<typename Dom>
+        CComparison<Dom> load_comparison(char const *data, size_t const size) {
+            return Reader(data, size).comparison<Dom>();
+        }
+    }
+}
@@ -0,0 +1,77 @@
+# distutils: language = c++
+from Definitions cimport *
+from concurrent.futures import ThreadPoolExecutor
+
+cdef _open_stream(array, mode, shape=None, dtype=None):
+  """An array to stream through: array itself, or the .npy file at the path array memory-mapped, created with shape
+  and dtype if mode is "w+"."""
+  if isinstance(array, (str, bytes, os.PathLike)):
+    if mode == "r":
+      array = np.load(array, mmap_mode="r")
+    else:
+      array = np.lib.format.open_memmap(array, mode="w+", dtype=dtype, shape=shape)
+  if not isinstance(array, np.ndarray):
+    raise TypeError(f"cannot stream through {type(array)}")
+  if not array.flags.c_contiguous:
+    raise ValueError("streamed arrays must be C-contiguous")
+  return array
+
+cdef _release(array, size_t start, size_t end):
+  """Drop the whole pages of the flat elements [start, end) of a memory-mapped array from the process, which reads
+  them back from the file if they are used again; written pages stay in the page cache until they are written out.
+  Arrays that are not memory-mapped are left as they are."""
+  mm = getattr(array, "_mmap", None)
+  if mm is None or not hasattr(mm, "madvise") or end <= start:
+    return
+  cdef size_t base = np.frombuffer(mm, dtype=np.uint8).ctypes.data
+  cdef size_t first = array.ctypes.data - base + start * array.itemsize, last = array.ctypes.data - base + end * array.itemsize
+  first = (first + mmap.PAGESIZE - 1) // mmap.PAGESIZE * mmap.PAGESIZE
+  last = last // mmap.PAGESIZE * mmap.PAGESIZE
+  if last > first:
+    mm.madvise(mmap.MADV_DONTNEED, first, last - first)
+
+def stream(f, input, output=None, size_t chunk_size=1 << 20):
+  """Evaluate f over an array too large for memory, chunk_size points at a time: input is an np.memmap or another
+  array, or the path of an .npy file, which is memory-mapped; output is the same, a path being created as an .npy file
+  of the input's shape, or None for a new array in memory. While the thread pool evaluates a chunk, the next one is
+  read in and the last one written out, and the pages of memory-mapped files are released once their chunk is done, so
+  that memory stays within a few chunks. Returns the output array."""
+  if chunk_size == 0:
+    raise ValueError("chunk_size must be positive")
+  z = _open_stream(input, "r")
+  dtype = f(np.zeros(1, dtype=z.dtype)).dtype
+  result = np.empty(z.shape, dtype=dtype) if output is None else _open_stream(output, "w+", z.shape, dtype)
+  if result.shape != z.shape or result.dtype != dtype:
+    raise ValueError(f"the output must be an array of shape {z.shape} and dtype {dtype}")
+  flat_z, flat_result = z.reshape(-1), result.reshape(-1)
+  cdef size_t n = flat_z.size
+  if n == 0:
+    return result
+
+  # Two buffers of input: one is evaluated while the other is filled. The reads and writes run one after the other on a
+  # thread of their own, which the evaluation does not hold the GIL against.
+  buffers = [np.empty(min(chunk_size, n), dtype=z.dtype) for _ in range(2)]
+  def read(size_t start, buffer):
+    cdef size_t end = min(start + chunk_size, n)
+    np.copyto(buffer[:end - start], flat_z[start:end])
+    _release(flat_z, start, end)
+  def write(size_t start, values):
+    flat_result[start:start + values.size] = values
+    _release(flat_result, start, start + values.size)
+
+  cdef size_t start
+  with ThreadPoolExecutor(max_workers=1) as io:
+    reading = io.submit(read, 0, buffers[0])
+    writing = None
+    for k, start in enumerate(range(0, n, chunk_size)):
+      reading.result()
+      if start + chunk_size < n:
+        reading = io.submit(read, start + chunk_size, buffers[(k + 1) % 2])
+      values = f(buffers[k % 2][:min(chunk_size, n - start)])
+      if writing is not None:
+        writing.result()
+      writing = io.submit(write, start, values)
+    writing.result()
+  if isinstance(result, np.memmap):
+    result.flush()
+  return result
@@ -0,0 +1,938 @@
+#include "Tape.h"
+#include "Kernels.h"
+#include "CComparison.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <type_traits>
+
+namespace libcalculus {
+    template<OPCODE op> using OpTag = std::integral_constant<OPCODE, op>;
+
+    /* Calls f with a compile-time tag for every opcode computed elementwise from one or two operands. */
+    template<typename F>
+    static inline void dispatch(OPCODE const op, F &&f) {
+        #define LIBCALCULUS_DISPATCH(OP) case OPCODE::OP: f(OpTag<OPCODE::OP>{}); break;
+        switch (op) {
+            LIBCALCULUS_DISPATCH(ADD) LIBCALCULUS_DISPATCH(SUB) LIBCALCULUS_DISPATCH(MUL) LIBCALCULUS_DISPATCH(DIV)
+            LIBCALCULUS_DISPATCH(POW) LIBCALCULUS_DISPATCH(ADDC) LIBCALCULUS_DISPATCH(SUBC) LIBCALCULUS_DISPATCH(CSUB)
+            LIBCALCULUS_DISPATCH(MULC) LIBCALCULUS_DISPATCH(DIVC) LIBCALCULUS_DISPATCH(CDIV) LIBCALCULUS_DISPATCH(POWC)
+            LIBCALCULUS_DISPATCH(CPOW) LIBCALCULUS_DISPATCH(NEG) LIBCALCULUS_DISPATCH(RE) LIBCALCULUS_DISPATCH(IM)
+            LIBCALCULUS_DISPATCH(CONJ) LIBCALCULUS_DISPATCH(ABS) LIBCALCULUS_DISPATCH(ARG) LIBCALCULUS_DISPATCH(EXP)
+            LIBCALCULUS_DISPATCH(LN) LIBCALCULUS_DISPATCH(SIN) LIBCALCULUS_DISPATCH(COS) LIBCALCULUS_DISPATCH(TAN)
+            LIBCALCULUS_DISPATCH(SEC) LIBCALCULUS_DISPATCH(CSC) LIBCALCULUS_DISPATCH(COT) LIBCALCULUS_DISPATCH(SINH)
+            LIBCALCULUS_DISPATCH(COSH) LIBCALCULUS_DISPATCH(TANH) LIBCALCULUS_DISPATCH(SECH) LIBCALCULUS_DISPATCH(CSCH)
+            LIBCALCULUS_DISPATCH(COTH) LIBCALCULUS_DISPATCH(ARCSIN) LIBCALCULUS_DISPATCH(ARCCOS) LIBCALCULUS_DISPATCH(ARCTAN)
+            LIBCALCULUS_DISPATCH(ARCCSC) LIBCALCULUS_DISPATCH(ARCSEC) LIBCALCULUS_DISPATCH(ARCCOT) LIBCALCULUS_DISPATCH(ARSINH)
+            LIBCALCULUS_DISPATCH(ARCOSH) LIBCALCULUS_DISPATCH(ARTANH) LIBCALCULUS_DISPATCH(ARCSCH) LIBCALCULUS_DISPATCH(ARSECH)
+            LIBCALCULUS_DISPATCH(ARCOTH)
+            default: break;
+        }
+        #undef LIBCALCULUS_DISPATCH
+    }
+
+    /* The elementwise semantics of every opcode; y is the second operand or the constant. */
+    template<OPCODE op, typename T>
+    static inline T apply(T const x, T const y) noexcept {
+        if constexpr (op == OPCODE::ADD || op == OPCODE::ADDC) return x + y;
+        else if constexpr (op == OPCODE::SUB || op == OPCODE::SUBC) return x - y;
+        else if constexpr (op == OPCODE::CSUB) return y - x;
+        else if constexpr (op == OPCODE::MUL || op == OPCODE::MULC) return y * x;
+        else if constexpr (op == OPCODE::DIV || op == OPCODE::DIVC) return x / y;
+        else if constexpr (op == OPCODE::CDIV) return y / x;
+        else if constexpr (op == OPCODE::POW || op == OPCODE::POWC) return std::pow(x, y);
+        else if constexpr (op == OPCODE::CPOW) return std::pow(y, x);
+        else if constexpr (op == OPCODE::NEG) return -x;
+        else if constexpr (op == OPCODE::RE) return std::real(x);
+        else if constexpr (op == OPCODE::IM) return std::imag(x);
+        else if constexpr (op == OPCODE::CONJ) {
+            if constexpr (is_real<T>) return x;
+            else return std::conj(x);
+        }
+        else if constexpr (op == OPCODE::ABS) return std::abs(x);
+        else if constexpr (op == OPCODE::ARG) return std::arg(x);
+        else if constexpr (op == OPCODE::EXP) return std::exp(x);
+        else if constexpr (op == OPCODE::LN) return std::log(x);
+        else if constexpr (op == OPCODE::SIN) return std::sin(x);
+        else if constexpr (op == OPCODE::COS) return std::cos(x);
+        else if constexpr (op == OPCODE::TAN) return std::tan(x);
+        else if constexpr (op == OPCODE::SEC) return T(1.) / std::cos(x);
+        else if constexpr (op == OPCODE::CSC) return T(1.) / std::sin(x);
+        else if constexpr (op == OPCODE::COT) return T(1.) / std::tan(x);
+        else if constexpr (op == OPCODE::SINH) return std::sinh(x);
+        else if constexpr (op == OPCODE::COSH) return std::cosh(x);
+        else if constexpr (op == OPCODE::TANH) return std::tanh(x);
+        else if constexpr (op == OPCODE::SECH) return T(1.) / std::cosh(x);
+        else if constexpr (op == OPCODE::CSCH) return T(1.) / std::sinh(x);
+        else if constexpr (op == OPCODE::COTH) return T(1.) / std::tanh(x);
+        else if constexpr (op == OPCODE::ARCSIN) return std::asin(x);
+        else if constexpr (op == OPCODE::ARCCOS) return std::acos(x);
+        else if constexpr (op == OPCODE::ARCTAN) return std::atan(x);
+        else if constexpr (op == OPCODE::ARCCSC) return std::asin(T(1.) / x);
+        else if constexpr (op == OPCODE::ARCSEC) return std::acos(T(1.) / x);
+        else if constexpr (op == OPCODE::ARCCOT) return std::atan(T(1.) / x);
+        else if constexpr (op == OPCODE::ARSINH) return std::asinh(x);
+        else if constexpr (op == OPCODE::ARCOSH) return std::acosh(x);
+        else if constexpr (op == OPCODE::ARTANH) return std::atanh(x);
+        else if constexpr (op == OPCODE::ARCSCH) return std::asinh(T(1.) / x);
+        else if constexpr (op == OPCODE::ARSECH) return std::acosh(T(1.) / x);
+        else if constexpr (op == OPCODE::ARCOTH) return std::atanh(T(1.) / x);
+    }
+
+    /* Evaluation */
+    static void native_callback(void const *tape, uint32_t const i, void const *x, void const *y, void *out, size_t const n) {
+        static_cast<Tape const *>(tape)->run_instruction(i, x, y, out, n);
+    }
+
+    COMPLEX Tape::operator()(COMPLEX const z) const {
+        if (this->native) {
+            REAL const real_z = std::real(z);
+            COMPLEX result = 0.; // A REAL result fills the real part.
+            this->native->run(this->dom_real() ? static_cast<void const *>(&real_z) : &z, &result, 1, this, native_callback);
+            return result;
+        }
+        COMPLEX small_regs[32];
+        std::vector<COMPLEX> large_regs;
+        COMPLEX *regs = small_regs;
+        if (this->n_regs > 32) {
+            large_regs.resize(this->n_regs);
+            regs = large_regs.data();
+        }
+
+        regs[this->dst[0]] = this->code[0].real ? COMPLEX{std::real(z)} : z;
+        auto const step = [&](size_t const i) {
+            Instruction const &instr = this->code[i];
+            COMPLEX const x = regs[this->dst[instr.a]];
+            COMPLEX const y = is_binary(instr.op) ? regs[this->dst[instr.b]] : instr.c;
+            COMPLEX &out = regs[this->dst[i]];
+            switch (instr.op) {
+                case OPCODE::CONST:
+                    out = instr.real ? COMPLEX{std::real(instr.c)} : instr.c;
+                    break;
+                case OPCODE::WIDEN:
+                    out = x;
+                    break;
+                case OPCODE::OPAQUE:
+                    out = (*this->opaques[instr.aux])(x);
+                    if (instr.real) out = std::real(out);
+                    break;
+                case OPCODE::IF: {
+                    Branch const &branch = *this->branches[instr.aux];
+                    out = branch.cond(x) ? (*branch.then_)(x) : (*branch.else_)(x);
+                    break;
+                }
+                case OPCODE::DERIVATIVE:
+                    out = this->diffs[instr.aux]->f->derivative(x, this->diffs[instr.aux]->order);
+                    if (instr.real) out = std::real(out);
+                    break;
+                case OPCODE::PATH:
+                    out = (*this->paths[instr.aux])(std::real(x));
+                    break;
+                case OPCODE::CHEBYSHEV:
+                    out = (*this->chebyshevs[instr.aux])(std::real(x));
+                    if (instr.real) out = std::real(out);
+                    break;
+                default:
+                    dispatch(instr.op, [&](auto tag) {
+                        if (instr.real) out = apply<decltype(tag)::value, REAL>(std::real(x), std::real(y));
+                        else out = apply<decltype(tag)::value, COMPLEX>(x, y);
+                    });
+            }
+        };
+        if (Profile::enabled) {
+            std::vector<Profile::Node> nodes(this->code.size());
+            for (size_t i = 1; i < this->code.size(); ++i) {
+                Profile::Clock::time_point const start = Profile::Clock::now();
+                step(i);
+                nodes[i].add(1, start);
+            }
+            Profile::record(*this, nodes.data());
+        } else {
+            for (size_t i = 1; i < this->code.size(); ++i) step(i);
+        }
+        return regs[this->dst[this->root]];
+    }
+
+    static inline bool is_finite(REAL const x) noexcept { return x - x == 0.; }
+    static inline bool is_finite(COMPLEX const z) noexcept { return is_finite(std::real(z)) && is_finite(std::imag(z)); }
+
+    template<OPCODE op, typename T>
+    static inline void block_binary(T const *RESTRICT x, T const *RESTRICT y, T *RESTRICT out, size_t const n) noexcept {
+        #pragma omp simd
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = apply<op, T>(x[i], y[i]);
+        }
+    }
+
+    template<OPCODE op, typename T>
+    static inline void block_unary(T const *RESTRICT x, T const y, T *RESTRICT out, size_t const n) noexcept {
+        if constexpr (Kernels::exists<op, T>) {
+            Kernels::run<op, T>(x, out, n);
+            // Special values and arguments the kernel cannot handle accurately go through the standard library.
+            for (size_t i = 0; i < n; ++i) {
+                if (!Kernels::in_range<op, T>(x[i]) || !is_finite(out[i])) out[i] = apply<op, T>(x[i], y);
+            }
+        } else {
+            #pragma omp simd
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = apply<op, T>(x[i], y);
+            }
+        }
+    }
+
+    /* Paths */
+    Tape::Path::Piece const &Tape::Path::piece(REAL const t) const noexcept {
+        // The first piece that ends after t, or else the last one.
+        return *std::upper_bound(this->pieces.begin(), this->pieces.end() - 1, t, [](REAL const t_, Piece const &piece) { return t_ < piece.end; });
+    }
+
+    static inline COMPLEX trace(Tape::Path::Piece const &piece, REAL const t) noexcept {
+        REAL const s = t - piece.start;
+        if (piece.omega == 0.) return piece.a + piece.b * s;
+        return piece.a + piece.b * COMPLEX{std::cos(piece.omega * s), std::sin(piece.omega * s)};
+    }
+
+    COMPLEX Tape::Path::operator()(REAL const t) const noexcept {
+        return trace(this->piece(t), t);
+    }
+
+    void Tape::Path::operator()(REAL const *RESTRICT t, COMPLEX *RESTRICT result, size_t const n) const {
+        if (this->pieces.size() > 1) {
+            for (size_t j = 0; j < n; ++j) result[j] = trace(this->piece(t[j]), t[j]);
+            return;
+        }
+        // A single line or arc, as most contours are, runs as straight loops over the points.
+        Piece const &piece = this->pieces[0];
+        if (piece.omega == 0.) {
+            #pragma omp simd
+            for (size_t j = 0; j < n; ++j) result[j] = piece.a + piece.b * (t[j] - piece.start);
+            return;
+        }
+        std::vector<REAL> phase(n), cos(n), sin(n);
+        #pragma omp simd
+        for (size_t j = 0; j < n; ++j) phase[j] = piece.omega * (t[j] - piece.start);
+        block_unary<OPCODE::COS, REAL>(phase.data(), 0., cos.data(), n);
+        block_unary<OPCODE::SIN, REAL>(phase.data(), 0., sin.data(), n);
+        #pragma omp simd
+        for (size_t j = 0; j < n; ++j) result[j] = piece.a + piece.b * COMPLEX{cos[j], sin[j]};
+    }
+
+    Tape::Path Tape::Path::derivative() const {
+        Path result;
+        for (Piece const &piece : this->pieces) {
+            if (piece.omega == 0.) result.pieces.push_back({piece.start, piece.end, piece.b, 0., 0.});
+            else result.pieces.push_back({piece.start, piece.end, 0., COMPLEX{0., piece.omega} * piece.b, piece.omega});
+        }
+        return result;
+    }
+
+    REAL Tape::Path::length(REAL const from, REAL const to) const noexcept {
+        REAL const lo = std::min(from, to), hi = std::max(from, to);
+        REAL result = 0.;
+        for (size_t k = 0; k < this->pieces.size(); ++k) {
+            Piece const &piece = this->pieces[k];
+            REAL const start = k == 0 ? lo : std::max(lo, piece.start), end = k + 1 == this->pieces.size() ? hi : std::min(hi, piece.end);
+            if (end > start) result += std::abs(piece.b) * (piece.omega == 0. ? 1. : std::abs(piece.omega)) * (end - start);
+        }
+        return result;
+    }
+
+    /* Chebyshev interpolants */
+    Tape::Chebyshev::Piece const &Tape::Chebyshev::piece(REAL const t) const noexcept {
+        // The first piece that ends after t, or else the last one.
+        return *std::upper_bound(this->pieces.begin(), this->pieces.end() - 1, t, [](REAL const t_, Piece const &piece) { return t_ < piece.end; });
+    }
+
+    template<typename T>
+    static inline T clenshaw(Tape::Chebyshev::Piece const &piece, REAL const t) noexcept {
+        REAL const width = piece.end - piece.start, s = 2. / width * t - (piece.start + piece.end) / width;
+        T b1 = 0., b2 = 0.;
+        for (size_t k = piece.coeffs.size(); k-- > 1;) {
+            T const b = from_complex<T>(piece.coeffs[k]) + 2. * s * b1 - b2;
+            b2 = b1;
+            b1 = b;
+        }
+        return from_complex<T>(piece.coeffs[0]) + s * b1 - b2;
+    }
+
+    /* The same over points of one piece, a coefficient at a time, so that the loops over the points run straight; s, b1
+     * and b2 are scratch space for n values. */
+    template<typename T>
+    static void clenshaw(Tape::Chebyshev::Piece const &piece, REAL const *RESTRICT t, T *RESTRICT result, size_t const n,
+                         REAL *RESTRICT s, T *RESTRICT b1, T *RESTRICT b2) {
+        REAL const width = piece.end - piece.start, scale = 2. / width, shift = (piece.start + piece.end) / width;
+        #pragma omp simd
+        for (size_t j = 0; j < n; ++j) {
+            s[j] = scale * t[j] - shift;
+            b1[j] = b2[j] = T{0.};
+        }
+        for (size_t k = piece.coeffs.size(); k-- > 1;) {
+            T const c = from_complex<T>(piece.coeffs[k]);
+            #pragma omp simd
+            for (size_t j = 0; j < n; ++j) {
+                T const b = c + 2. * s[j] * b1[j] - b2[j];
+                b2[j] = b1[j];
+                b1[j] = b;
+            }
+        }
+        T const c = from_complex<T>(piece.coeffs[0]);
+        #pragma omp simd
+        for (size_t j = 0; j < n; ++j) result[j] = c + s[j] * b1[j] - b2[j];
+    }
+
+    COMPLEX Tape::Chebyshev::operator()(REAL const t) const noexcept {
+        return clenshaw<COMPLEX>(this->piece(t), t);
+    }
+
+    void Tape::Chebyshev::operator()(REAL const *RESTRICT t, void *RESTRICT result, size_t const n, bool const real) const {
+        auto const run = [&]<typename T>(T *RESTRICT out) {
+            std::vector<REAL> s(n);
+            std::vector<T> b1(n), b2(n);
+            if (this->pieces.size() == 1) return clenshaw<T>(this->pieces[0], t, out, n, s.data(), b1.data(), b2.data());
+
+            // The points are sorted by piece, by counting those of each, so that every piece runs over its own.
+            std::vector<uint32_t> index(n);
+            uint32_t lo = this->pieces.size(), hi = 0;
+            for (size_t j = 0; j < n; ++j) {
+                index[j] = &this->piece(t[j]) - this->pieces.data();
+                lo = std::min(lo, index[j]);
+                hi = std::max(hi, index[j]);
+            }
+            if (n == 0) return;
+            std::vector<uint32_t> offsets(hi - lo + 2, 0), order(n);
+            for (size_t j = 0; j < n; ++j) ++offsets[index[j] - lo + 1];
+            for (size_t p = 1; p < offsets.size(); ++p) offsets[p] += offsets[p - 1];
+            std::vector<REAL> sorted(n);
+            std::vector<T> values(n);
+            std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+            for (size_t j = 0; j < n; ++j) {
+                uint32_t const k = next[index[j] - lo]++;
+                order[k] = j;
+                sorted[k] = t[j];
+            }
+            for (uint32_t p = lo; p <= hi; ++p) {
+                uint32_t const begin = offsets[p - lo], end = offsets[p - lo + 1];
+                if (begin < end) clenshaw<T>(this->pieces[p], sorted.data() + begin, values.data() + begin, end - begin, s.data(), b1.data(), b2.data());
+            }
+            for (size_t k = 0; k < n; ++k) out[order[k]] = values[k];
+        };
+        if (real) run(static_cast<REAL *>(result));
+        else run(static_cast<COMPLEX *>(result));
+    }
+
+    Tape::Chebyshev Tape::Chebyshev::derivative() const {
+        // With d_n = d_(n+1) = 0 past the last coefficient, d_(k-1) = d_(k+1) + 2k c_k, and d_0 counts half.
+        Chebyshev result{{}, this->error, this->latex};
+        for (Piece const &piece : this->pieces) {
+            size_t const n = piece.coeffs.size();
+            std::vector<COMPLEX> d(std::max<size_t>(n - 1, 1) + 2, 0.);
+            for (size_t k = n - 1; k > 0; --k) d[k - 1] = d[k + 1] + 2. * static_cast<REAL>(k) * piece.coeffs[k];
+            d[0] *= .5;
+            d.resize(std::max<size_t>(n - 1, 1));
+            REAL const scale = 2. / (piece.end - piece.start);
+            for (COMPLEX &c : d) c *= scale;
+            result.pieces.push_back({piece.start, piece.end, std::move(d)});
+        }
+        return result;
+    }
+
+    Tape::Chebyshev Tape::Chebyshev::antiderivative() const {
+        // C_k = (c_(k-1) - c_(k+1)) / 2k, with c_0 counting double, and C_0 matching the value where the previous piece ends.
+        Chebyshev result{{}, this->error, this->latex};
+        COMPLEX value = 0.;
+        for (Piece const &piece : this->pieces) {
+            size_t const n = piece.coeffs.size();
+            auto const c = [&](size_t const k) { return k < n ? piece.coeffs[k] : COMPLEX{0.}; };
+            REAL const scale = .5 * (piece.end - piece.start);
+            std::vector<COMPLEX> integral(n + 1, 0.);
+            for (size_t k = 1; k <= n; ++k) integral[k] = scale * ((k == 1 ? 2. : 1.) * c(k - 1) - c(k + 1)) / (2. * static_cast<REAL>(k));
+            COMPLEX start = 0., end = 0.;
+            for (size_t k = 1; k <= n; ++k) {
+                start += k % 2 ? -integral[k] : integral[k];
+                end += integral[k];
+            }
+            integral[0] = value - start;
+            value = integral[0] + end;
+            result.pieces.push_back({piece.start, piece.end, std::move(integral)});
+        }
+        return result;
+    }
+
+    Tape::Chebyshev Tape::Chebyshev::fit(Sampler const &f, REAL const a, REAL const b, REAL const tol) {
+        if (!(a < b)) throw std::invalid_argument("the interval of an approximation must have a < b");
+        if (!(tol > 0.)) throw std::invalid_argument("the tolerance of an approximation must be positive");
+        // Every piece is sampled at the Chebyshev points cos(pi j / N), and its coefficients are the discrete cosine
+        // transform of the samples; cosines[m] is cos(pi m / N), for m up to 2N.
+        size_t constexpr N = CHEBYSHEV_DEGREE;
+        std::vector<REAL> cosines(2 * N);
+        for (size_t m = 0; m < 2 * N; ++m) cosines[m] = std::cos(M_PI * static_cast<REAL>(m) / N);
+
+        Chebyshev result;
+        std::vector<std::pair<REAL, REAL>> pending{{a, b}};
+        REAL largest = 0., bound = tol;
+        while (!pending.empty()) {
+            // The pieces left to fit are sampled together, in one call over an array.
+            std::vector<REAL> t(pending.size() * (N + 1));
+            std::vector<COMPLEX> values(t.size());
+            for (size_t p = 0; p < pending.size(); ++p) {
+                REAL const mid = .5 * (pending[p].first + pending[p].second), half = .5 * (pending[p].second - pending[p].first);
+                for (size_t j = 0; j <= N; ++j) t[p * (N + 1) + j] = mid + half * cosines[j];
+            }
+            f(t.data(), values.data(), t.size());
+            for (COMPLEX const value : values) {
+                if (std::isfinite(std::abs(value))) largest = std::max(largest, std::abs(value));
+            }
+            bound = tol * std::max(largest, 1.);
+
+            std::vector<std::pair<REAL, REAL>> next;
+            for (size_t p = 0; p < pending.size(); ++p) {
+                auto const [lo, hi] = pending[p];
+                COMPLEX const *samples = values.data() + p * (N + 1);
+                std::vector<COMPLEX> coeffs(N + 1, 0.);
+                bool finite = true;
+                for (size_t k = 0; k <= N; ++k) {
+                    for (size_t j = 0; j <= N; ++j) coeffs[k] += (j == 0 || j == N ? .5 : 1.) * samples[j] * cosines[j * k % (2 * N)];
+                    coeffs[k] *= (k == 0 || k == N ? 1. : 2.) / N;
+                    finite = finite && std::isfinite(std::abs(coeffs[k]));
+                }
+                bool const converged = finite && std::abs(coeffs[N]) <= bound && std::abs(coeffs[N - 1]) <= bound && std::abs(coeffs[N - 2]) <= bound;
+                REAL const mid = .5 * (lo + hi);
+                size_t const pieces = result.pieces.size() + next.size() + (pending.size() - p);
+                if (!converged && pieces < CHEBYSHEV_MAX_PIECES && lo < mid && mid < hi) {
+                    next.push_back({lo, mid});
+                    next.push_back({mid, hi});
+                    continue;
+                }
+                // Trailing coefficients are dropped while they add up to under half the bound.
+                REAL dropped = 0.;
+                while (coeffs.size() > 1 && dropped + std::abs(coeffs.back()) <= .5 * bound) {
+                    dropped += std::abs(coeffs.back());
+                    coeffs.pop_back();
+                }
+                result.pieces.push_back({lo, hi, std::move(coeffs)});
+            }
+            pending = std::move(next);
+        }
+        std::sort(result.pieces.begin(), result.pieces.end(), [](Piece const &lhs, Piece const &rhs) { return lhs.start < rhs.start; });
+        result.error = bound;
+        return result;
+    }
+
+    std::vector<REAL> Tape::breakpoints() const {
+        std::vector<REAL> result;
+        for (Instruction const &instr : this->code) {
+            if (instr.op != OPCODE::PATH || instr.a != 0) continue;
+            std::vector<Path::Piece> const &pieces = this->paths[instr.aux]->pieces;
+            for (size_t k = 1; k < pieces.size(); ++k) result.push_back(pieces[k].start);
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    void Tape::operator()(void const *RESTRICT z, void *RESTRICT result, size_t const n) const {
+        if (this->native) return this->native->run(z, result, n, this, native_callback);
+        size_t const in_size = this->dom_real() ? sizeof(REAL) : sizeof(COMPLEX);
+        size_t const out_size = this->ran_real() ? sizeof(REAL) : sizeof(COMPLEX);
+        std::vector<COMPLEX> regs(this->n_regs * TAPE_BLOCK_SIZE);
+        std::vector<Profile::Node> nodes(Profile::enabled ? this->code.size() : 0);
+        for (size_t start = 0; start < n; start += TAPE_BLOCK_SIZE) {
+            size_t const m = std::min(TAPE_BLOCK_SIZE, n - start);
+            std::copy_n(static_cast<char const *>(z) + start * in_size, m * in_size,
+                        reinterpret_cast<char *>(&regs[this->dst[0] * TAPE_BLOCK_SIZE]));
+            this->run_block(reinterpret_cast<double *>(regs.data()), m, nodes.empty() ? nullptr : nodes.data());
+            std::copy_n(reinterpret_cast<char const *>(&regs[this->dst[this->root] * TAPE_BLOCK_SIZE]), m * out_size,
+                        static_cast<char *>(result) + start * out_size);
+        }
+        if (!nodes.empty()) Profile::record(*this, nodes.data());
+    }
+
+    /* Runs every instruction over m points; register r occupies TAPE_BLOCK_SIZE COMPLEX values at regs + 2 * r * TAPE_BLOCK_SIZE,
+     * holding m REAL or m COMPLEX values depending on the kind of the instruction that wrote it. */
+    void Tape::run_block(double *RESTRICT regs, size_t const m, Profile::Node *RESTRICT nodes) const {
+        auto const reg = [&](uint32_t const instr) { return regs + 2 * this->dst[instr] * TAPE_BLOCK_SIZE; };
+        if (nodes) {
+            for (uint32_t i = 1; i < this->code.size(); ++i) {
+                Profile::Clock::time_point const start = Profile::Clock::now();
+                this->run_instruction(i, reg(this->code[i].a), reg(this->code[i].b), reg(i), m);
+                nodes[i].add(m, start);
+            }
+            return;
+        }
+        for (uint32_t i = 1; i < this->code.size(); ++i) {
+            this->run_instruction(i, reg(this->code[i].a), reg(this->code[i].b), reg(i), m);
+        }
+    }
+
+    /* Runs a branch over m points at the precision F, given them in double precision as args and at the precision F as
+     * x: the condition runs over all the points at once, and each branch only over the points that take it, gathered
+     * together - those of the then-branch first, and then the others. run(tape, z, result, n) evaluates a branch. */
+    template<typename F, typename Run>
+    static void run_branch(Tape::Branch const &branch, bool const arg_real, bool const value_real, void const *RESTRICT args,
+                           void const *RESTRICT x_, void *RESTRICT out_, size_t const m, Run const &run) {
+        REAL const *RESTRICT real_args = static_cast<REAL const *>(args);
+        COMPLEX const *RESTRICT complex_args = static_cast<COMPLEX const *>(args);
+        size_t const arg_size = (arg_real ? 1 : 2) * sizeof(F), value_size = (value_real ? 1 : 2) * sizeof(F);
+        std::vector<uint64_t> mask(mask_words(m));
+        if (branch.cond_array) branch.cond_array(args, mask.data(), m);
+        else pack_mask(mask.data(), m, [&](size_t const j) { return branch.cond(arg_real ? COMPLEX{real_args[j]} : complex_args[j]); });
+        size_t n_then = 0;
+        for (size_t j = 0; j < m; ++j) n_then += mask_bit(mask.data(), j);
+        if (n_then == m || n_then == 0) return run(*(n_then == m ? branch.then_ : branch.else_), x_, out_, m);
+
+        std::vector<std::complex<F>> gathered_args(m), values(m);
+        std::vector<uint32_t> position(m);
+        char const *RESTRICT x = static_cast<char const *>(x_);
+        char *RESTRICT gathered = reinterpret_cast<char *>(gathered_args.data());
+        for (size_t j = 0, k_then = 0, k_else = n_then; j < m; ++j) {
+            position[j] = mask_bit(mask.data(), j) ? k_then++ : k_else++;
+            std::copy_n(x + j * arg_size, arg_size, gathered + position[j] * arg_size);
+        }
+        char *RESTRICT results = reinterpret_cast<char *>(values.data());
+        run(*branch.then_, gathered, results, n_then);
+        run(*branch.else_, gathered + n_then * arg_size, results + n_then * value_size, m - n_then);
+        char *RESTRICT out = static_cast<char *>(out_);
+        for (size_t j = 0; j < m; ++j) std::copy_n(results + position[j] * value_size, value_size, out + j * value_size);
+    }
+
+    /* Runs instruction i over m points, given the values of its operands; arrays are REAL or COMPLEX according to the
+     * kinds of the instructions that produce them. */
+    void Tape::run_instruction(uint32_t const i, void const *RESTRICT x_, void const *RESTRICT y_, void *RESTRICT out_, size_t const m) const {
+        Instruction const &instr = this->code[i];
+        bool const arg_real = this->code[instr.a].real;
+        REAL const *RESTRICT real_x = static_cast<REAL const *>(x_);
+        COMPLEX const *RESTRICT complex_x = static_cast<COMPLEX const *>(x_);
+        REAL *RESTRICT real_out = static_cast<REAL *>(out_);
+        COMPLEX *RESTRICT complex_out = static_cast<COMPLEX *>(out_);
+        switch (instr.op) {
+            case OPCODE::VAR:
+                break;
+            case OPCODE::CONST:
+                if (instr.real) std::fill_n(real_out, m, std::real(instr.c));
+                else std::fill_n(complex_out, m, instr.c);
+                break;
+            case OPCODE::WIDEN:
+                #pragma omp simd
+                for (size_t j = 0; j < m; ++j) complex_out[j] = real_x[j];
+                break;
+            case OPCODE::OPAQUE: {
+                Opaque const &f = *this->opaques[instr.aux];
+                for (size_t j = 0; j < m; ++j) {
+                    COMPLEX const value = f(arg_real ? COMPLEX{real_x[j]} : complex_x[j]);
+                    if (instr.real) real_out[j] = std::real(value);
+                    else complex_out[j] = value;
+                }
+                break;
+            }
+            case OPCODE::IF:
+                run_branch<REAL>(*this->branches[instr.aux], arg_real, instr.real, x_, x_, out_, m,
+                                 [](Tape const &tape, void const *z, void *result, size_t const n) { tape(z, result, n); });
+                break;
+            case OPCODE::DERIVATIVE: {
+                Diff const &diff = *this->diffs[instr.aux];
+                for (size_t j = 0; j < m; ++j) {
+                    COMPLEX const value = diff.f->derivative(arg_real ? COMPLEX{real_x[j]} : complex_x[j], diff.order);
+                    if (instr.real) real_out[j] = std::real(value);
+                    else complex_out[j] = value;
+                }
+                break;
+            }
+            case OPCODE::PATH:
+                (*this->paths[instr.aux])(real_x, complex_out, m);
+                break;
+            case OPCODE::CHEBYSHEV:
+                (*this->chebyshevs[instr.aux])(real_x, out_, m, instr.real);
+                break;
+            default:
+                dispatch(instr.op, [&](auto tag) {
+                    constexpr OPCODE op = decltype(tag)::value;
+                    if (is_binary(op) && instr.real) block_binary<op, REAL>(real_x, static_cast<REAL const *>(y_), real_out, m);
+                    else if (is_binary(op)) block_binary<op, COMPLEX>(complex_x, static_cast<COMPLEX const *>(y_), complex_out, m);
+                    else if (instr.real) block_unary<op, REAL>(real_x, std::real(instr.c), real_out, m);
+                    else block_unary<op, COMPLEX>(complex_x, instr.c, complex_out, m);
+                });
+        }
+    }
+
+    /* Converts n values to another precision. */
+    template<typename T, typename U>
+    static inline void convert(T const *RESTRICT x, U *RESTRICT out, size_t const n) noexcept {
+        #pragma omp simd
+        for (size_t j = 0; j < n; ++j) out[j] = static_cast<U>(x[j]);
+    }
+
+    template<typename F>
+    void Tape::evaluate(void const *RESTRICT z, void *RESTRICT result, size_t const n) const {
+        size_t const in_size = (this->dom_real() ? 1 : 2) * sizeof(F), out_size = (this->ran_real() ? 1 : 2) * sizeof(F);
+        std::vector<std::complex<F>> regs(this->n_regs * TAPE_BLOCK_SIZE);
+        std::vector<COMPLEX> wide(2 * TAPE_BLOCK_SIZE);
+        std::vector<Profile::Node> nodes(Profile::enabled ? this->code.size() : 0);
+        for (size_t start = 0; start < n; start += TAPE_BLOCK_SIZE) {
+            size_t const m = std::min(TAPE_BLOCK_SIZE, n - start);
+            std::copy_n(static_cast<char const *>(z) + start * in_size, m * in_size,
+                        reinterpret_cast<char *>(&regs[this->dst[0] * TAPE_BLOCK_SIZE]));
+            this->run_block(reinterpret_cast<F *>(regs.data()), wide.data(), m, nodes.empty() ? nullptr : nodes.data());
+            std::copy_n(reinterpret_cast<char const *>(&regs[this->dst[this->root] * TAPE_BLOCK_SIZE]), m * out_size,
+                        static_cast<char *>(result) + start * out_size);
+        }
+        if (!nodes.empty()) Profile::record(*this, nodes.data());
+    }
+
+    /* Runs every instruction over m points at the precision F, with the registers laid out as in the double precision
+     * run_block(); what is computed in double precision goes through wide, which holds two registers of COMPLEX. */
+    template<typename F>
+    void Tape::run_block(F *RESTRICT regs, COMPLEX *RESTRICT wide, size_t const m, Profile::Node *RESTRICT nodes) const {
+        using Complex = std::complex<F>;
+        auto const reg = [&](uint32_t const instr) { return regs + 2 * this->dst[instr] * TAPE_BLOCK_SIZE; };
+        COMPLEX *RESTRICT wide_out = wide + TAPE_BLOCK_SIZE;
+        // Widens or narrows m values of the kind of instruction i.
+        auto const widen = [&](uint32_t const i, F const *RESTRICT x, COMPLEX *RESTRICT out) {
+            if (this->code[i].real) convert(x, reinterpret_cast<REAL *>(out), m);
+            else convert(reinterpret_cast<Complex const *>(x), out, m);
+        };
+        auto const narrow = [&](uint32_t const i, COMPLEX const *RESTRICT x, F *RESTRICT out) {
+            if (this->code[i].real) convert(reinterpret_cast<REAL const *>(x), out, m);
+            else convert(x, reinterpret_cast<Complex *>(out), m);
+        };
+        auto const step = [&](uint32_t const i) {
+            Instruction const &instr = this->code[i];
+            F const *RESTRICT x = reg(instr.a);
+            F *RESTRICT out = reg(i);
+            switch (instr.op) {
+                case OPCODE::CONST:
+                    if (instr.real) std::fill_n(out, m, static_cast<F>(std::real(instr.c)));
+                    else std::fill_n(reinterpret_cast<Complex *>(out), m, static_cast<Complex>(instr.c));
+                    break;
+                case OPCODE::WIDEN:
+                    convert(x, reinterpret_cast<Complex *>(out), m);
+                    break;
+                case OPCODE::IF:
+                    widen(instr.a, x, wide);
+                    run_branch<F>(*this->branches[instr.aux], this->code[instr.a].real, instr.real, wide, x, out, m,
+                                  [](Tape const &tape, void const *z, void *result, size_t const n) { tape.evaluate<F>(z, result, n); });
+                    break;
+                case OPCODE::OPAQUE:
+                case OPCODE::DERIVATIVE:
+                case OPCODE::PATH:
+                case OPCODE::CHEBYSHEV:
+                    widen(instr.a, x, wide);
+                    this->run_instruction(i, wide, nullptr, wide_out, m);
+                    narrow(i, wide_out, out);
+                    break;
+                default:
+                    dispatch(instr.op, [&](auto tag) {
+                        constexpr OPCODE op = decltype(tag)::value;
+                        if (std::is_same<F, float>::value && Kernels::has_kernel(op, instr.real)) {
+                            // The kernels are faster in double precision than the scalar functions in float.
+                            widen(instr.a, x, wide);
+                            if (instr.real) block_unary<op, REAL>(reinterpret_cast<REAL *>(wide), std::real(instr.c), reinterpret_cast<REAL *>(wide_out), m);
+                            else block_unary<op, COMPLEX>(wide, instr.c, wide_out, m);
+                            narrow(i, wide_out, out);
+                        }
+                        else if (is_binary(op) && instr.real) block_binary<op, F>(x, reg(instr.b), out, m);
+                        else if (is_binary(op)) block_binary<op, Complex>(reinterpret_cast<Complex const *>(x), reinterpret_cast<Complex const *>(reg(instr.b)), reinterpret_cast<Complex *>(out), m);
+                        else if (instr.real) block_unary<op, F>(x, static_cast<F>(std::real(instr.c)), out, m);
+                        else block_unary<op, Complex>(reinterpret_cast<Complex const *>(x), static_cast<Complex>(instr.c), reinterpret_cast<Complex *>(out), m);
+                    });
+            }
+        };
+        if (nodes) {
+            for (uint32_t i = 1; i < this->code.size(); ++i) {
+                Profile::Clock::time_point const start = Profile::Clock::now();
+                step(i);
+                nodes[i].add(m, start);
+            }
+            return;
+        }
+        for (uint32_t i = 1; i < this->code.size(); ++i) step(i);
+    }
+
+    size_t Tape::memory(std::unordered_set<void const *> &seen) const {
+        if (!seen.insert(this).second) return 0;
+        size_t result = sizeof(Tape) + this->code.capacity() * sizeof(Instruction) + this->dst.capacity() * sizeof(uint32_t);
+        result += (this->opaques.capacity() + this->branches.capacity() + this->diffs.capacity() + this->paths.capacity()
+                   + this->chebyshevs.capacity()) * sizeof(ptr);
+        for (std::shared_ptr<Opaque const> const &opaque : this->opaques) {
+            if (seen.insert(opaque.get()).second) result += sizeof(Opaque);
+        }
+        for (std::shared_ptr<Branch const> const &branch : this->branches) {
+            if (!seen.insert(branch.get()).second) continue;
+            result += sizeof(Branch) + branch->latex->memory(seen) + branch->then_->memory(seen) + branch->else_->memory(seen);
+        }
+        for (std::shared_ptr<Diff const> const &diff : this->diffs) {
+            if (seen.insert(diff.get()).second) result += sizeof(Diff) + diff->f->memory(seen);
+        }
+        for (std::shared_ptr<Path const> const &path : this->paths) {
+            if (seen.insert(path.get()).second) result += sizeof(Path) + path->pieces.capacity() * sizeof(Path::Piece);
+        }
+        for (std::shared_ptr<Chebyshev const> const &chebyshev : this->chebyshevs) {
+            if (!seen.insert(chebyshev.get()).second) continue;
+            result += sizeof(Chebyshev) + chebyshev->pieces.capacity() * sizeof(Chebyshev::Piece) + chebyshev->latex->memory(seen);
+            for (Chebyshev::Piece const &piece : chebyshev->pieces) result += piece.coeffs.capacity() * sizeof(COMPLEX);
+        }
+        return result;
+    }
+
+    /* Construction */
+    uint32_t Tape::push(Instruction const &instr) {
+        this->code.push_back(instr);
+        return this->root = this->code.size() - 1;
+    }
+
+    /* Copies another tape's instructions into this one, substituting instruction var for its argument;
+     * returns the index of the other tape's result. */
+    uint32_t Tape::append(Tape const &other, uint32_t const var) {
+        std::vector<uint32_t> index(other.code.size());
+        index[0] = var;
+        for (size_t i = 1; i < other.code.size(); ++i) {
+            Instruction instr = other.code[i];
+            instr.a = index[instr.a];
+            instr.b = index[instr.b];
+            if (instr.op == OPCODE::OPAQUE) instr.aux += this->opaques.size();
+            else if (instr.op == OPCODE::IF) instr.aux += this->branches.size();
+            else if (instr.op == OPCODE::DERIVATIVE) instr.aux += this->diffs.size();
+            else if (instr.op == OPCODE::PATH) instr.aux += this->paths.size();
+            else if (instr.op == OPCODE::CHEBYSHEV) instr.aux += this->chebyshevs.size();
+            index[i] = this->push(instr);
+        }
+        this->opaques.insert(this->opaques.end(), other.opaques.begin(), other.opaques.end());
+        this->branches.insert(this->branches.end(), other.branches.begin(), other.branches.end());
+        this->diffs.insert(this->diffs.end(), other.diffs.begin(), other.diffs.end());
+        this->paths.insert(this->paths.end(), other.paths.begin(), other.paths.end());
+        this->chebyshevs.insert(this->chebyshevs.end(), other.chebyshevs.begin(), other.chebyshevs.end());
+        return this->root = index[other.root];
+    }
+
+    /* What makes two instructions compute the same values: opaque functions and branches are compared by identity,
+     * and constants bitwise. */
+    struct InstructionKey {
+        OPCODE op;
+        bool real;
+        uint32_t a, b;
+        void const *aux;
+        uint64_t c[2];
+
+        inline bool operator==(InstructionKey const &other) const noexcept {
+            return this->op == other.op && this->real == other.real && this->a == other.a && this->b == other.b &&
+                   this->aux == other.aux && this->c[0] == other.c[0] && this->c[1] == other.c[1];
+        }
+    };
+
+    struct InstructionKeyHash {
+        inline size_t operator()(InstructionKey const &key) const noexcept {
+            uint64_t h = static_cast<uint64_t>(key.op) << 1 | key.real;
+            for (uint64_t const x : {uint64_t{key.a} << 32 | key.b, reinterpret_cast<uint64_t>(key.aux), key.c[0], key.c[1]}) {
+                h = (h ^ x) * 0x9E3779B97F4A7C15ULL;
+                h ^= h >> 32;
+            }
+            return h;
+        }
+    };
+
+    static inline bool is_commutative(OPCODE const op) noexcept {
+        return op == OPCODE::ADD || op == OPCODE::MUL;
+    }
+
+    static inline size_t saturating_add(size_t const x, size_t const y) noexcept {
+        return x > SIZE_MAX - y ? SIZE_MAX : x + y;
+    }
+
+    /* Merges identical instructions, drops instructions that do not contribute to the result and allocates registers,
+     * so that array evaluation computes every distinct subexpression once and needs as few blocks of scratch memory
+     * as possible. */
+    Tape::ptr Tape::finalize() {
+        size_t const n = this->code.size();
+        // Hash-consing: operands are redirected to the first of any identical instructions, which makes the others dead.
+        std::vector<uint32_t> first(n);
+        std::unordered_map<InstructionKey, uint32_t, InstructionKeyHash> seen;
+        seen.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            Instruction &instr = this->code[i];
+            if (has_operand(instr.op)) instr.a = first[instr.a];
+            if (is_binary(instr.op)) instr.b = first[instr.b];
+            if (is_commutative(instr.op) && instr.a > instr.b) std::swap(instr.a, instr.b);
+            InstructionKey key{instr.op, instr.real, instr.a, instr.b, nullptr, {}};
+            if (instr.op == OPCODE::OPAQUE) key.aux = this->opaques[instr.aux].get();
+            else if (instr.op == OPCODE::IF) key.aux = this->branches[instr.aux].get();
+            else if (instr.op == OPCODE::DERIVATIVE) key.aux = this->diffs[instr.aux].get();
+            else if (instr.op == OPCODE::PATH) key.aux = this->paths[instr.aux].get();
+            else if (instr.op == OPCODE::CHEBYSHEV) key.aux = this->chebyshevs[instr.aux].get();
+            std::memcpy(key.c, &instr.c, sizeof(key.c));
+            first[i] = seen.emplace(key, i).first->second;
+        }
+        this->root = first[this->root];
+
+        std::vector<bool> live(n, false);
+        live[0] = live[this->root] = true;
+        for (size_t i = n; i-- > 1;) {
+            if (live[i] && has_operand(this->code[i].op)) {
+                live[this->code[i].a] = true;
+                if (is_binary(this->code[i].op)) live[this->code[i].b] = true;
+            }
+        }
+
+        Tape result;
+        std::vector<uint32_t> index(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (!live[i]) continue;
+            Instruction instr = this->code[i];
+            instr.a = index[instr.a];
+            instr.b = index[instr.b];
+            if (instr.op == OPCODE::OPAQUE) {
+                result.opaques.push_back(this->opaques[instr.aux]);
+                instr.aux = result.opaques.size() - 1;
+            } else if (instr.op == OPCODE::IF) {
+                result.branches.push_back(this->branches[instr.aux]);
+                instr.aux = result.branches.size() - 1;
+            } else if (instr.op == OPCODE::DERIVATIVE) {
+                result.diffs.push_back(this->diffs[instr.aux]);
+                instr.aux = result.diffs.size() - 1;
+            } else if (instr.op == OPCODE::PATH) {
+                result.paths.push_back(this->paths[instr.aux]);
+                instr.aux = result.paths.size() - 1;
+            } else if (instr.op == OPCODE::CHEBYSHEV) {
+                result.chebyshevs.push_back(this->chebyshevs[instr.aux]);
+                instr.aux = result.chebyshevs.size() - 1;
+            }
+            result.code.push_back(instr);
+            index[i] = result.code.size() - 1;
+        }
+        result.root = index[this->root];
+
+        size_t const m = result.code.size();
+        // Operations in the expression tree below each instruction; nested branches count as their own trees.
+        std::vector<size_t> tree(m, 0);
+        size_t operations = m - 1;
+        for (size_t i = 1; i < m; ++i) {
+            Instruction const &instr = result.code[i];
+            tree[i] = 1;
+            if (has_operand(instr.op)) tree[i] = saturating_add(tree[i], tree[instr.a]);
+            if (is_binary(instr.op)) tree[i] = saturating_add(tree[i], tree[instr.b]);
+            if (instr.op == OPCODE::IF) {
+                for (ptr const &branch : {result.branches[instr.aux]->then_, result.branches[instr.aux]->else_}) {
+                    tree[i] = saturating_add(tree[i], saturating_add(branch->deduplicated, branch->code.size() - 1));
+                    operations += branch->code.size() - 1;
+                }
+            }
+        }
+        result.deduplicated = tree[result.root] - std::min(tree[result.root], operations);
+
+        std::vector<uint32_t> last_use(m, 0);
+        for (size_t i = 1; i < m; ++i) {
+            if (has_operand(result.code[i].op)) last_use[result.code[i].a] = i;
+            if (is_binary(result.code[i].op)) last_use[result.code[i].b] = i;
+        }
+        last_use[result.root] = m;
+
+        std::vector<uint32_t> free_regs;
+        result.dst.resize(m);
+        for (size_t i = 0; i < m; ++i) {
+            if (free_regs.empty()) {
+                result.dst[i] = result.n_regs++;
+            } else {
+                result.dst[i] = free_regs.back();
+                free_regs.pop_back();
+            }
+            Instruction const &instr = result.code[i];
+            if (has_operand(instr.op) && last_use[instr.a] == i) free_regs.push_back(result.dst[instr.a]);
+            if (is_binary(instr.op) && instr.b != instr.a && last_use[instr.b] == i) free_regs.push_back(result.dst[instr.b]);
+        }
+        return std::make_shared<Tape const>(std::move(result));
+    }
+
+    Tape::ptr Tape::Variable(bool const dom_real, bool const ran_real) {
+        Tape result;
+        result.push({OPCODE::VAR, dom_real});
+        if (dom_real && !ran_real) result.push({OPCODE::WIDEN, false, 0});
+        return result.finalize();
+    }
+
+    Tape::ptr Tape::Constant(bool const dom_real, COMPLEX const c, bool const ran_real) {
+        Tape result;
+        result.push({OPCODE::VAR, dom_real});
+        result.push({OPCODE::CONST, ran_real, 0, 0, 0, c});
+        return result.finalize();
+    }
+
+    Tape::ptr Tape::Preset(OPCODE const op, bool const dom_real, bool const ran_real) {
+        Tape result;
+        result.push({OPCODE::VAR, dom_real});
+        uint32_t const value = result.push({op, dom_real, 0});
+        if (dom_real && !ran_real) result.push({OPCODE::WIDEN, false, value});
+        return result.finalize();
+    }
+
+    Tape::ptr Tape::Wrap(Opaque const &f, bool const dom_real, bool const ran_real) {
+        Tape result;
+        result.push({OPCODE::VAR, dom_real});
+        result.opaques.push_back(std::make_shared<Opaque const>(f));
+        result.push({OPCODE::OPAQUE, ran_real, 0, 0, 0});
+        return result.finalize();
+    }
+
+    Tape::ptr Tape::If(Branch const &branch) {
+        Tape result;
+        result.push({OPCODE::VAR, branch.then_->dom_real()});
+        result.branches.push_back(std::make_shared<Branch const>(branch));
+        result.push({OPCODE::IF, branch.then_->ran_real(), 0, 0, 0});
+        return result.finalize();
+    }
+
+    Tape::ptr Tape::Differentiate(ptr const &f, size_t const order) {
+        size_t const inner_order = f->code.size() == 2 && f->last() == OPCODE::DERIVATIVE ? f->diffs[f->code[1].aux]->order : 0;
+        if (order > DERIVATIVE_MAX_ORDER - inner_order) throw std::invalid_argument("derivatives are taken up to order " + std::to_string(DERIVATIVE_MAX_ORDER));
+        Tape result;
+        result.push({OPCODE::VAR, f->dom_real()});
+        // Derivatives of derivatives refer to the original function, so that its series is only computed once.
+        if (f->code.size() == 2 && f->last() == OPCODE::DERIVATIVE) {
+            Diff const &inner = *f->diffs[f->code[1].aux];
+            result.diffs.push_back(std::make_shared<Diff const>(Diff{inner.f, inner.order + order}));
+        } else {
+            result.diffs.push_back(std::make_shared<Diff const>(Diff{f, order}));
+        }
+        result.push({OPCODE::DERIVATIVE, f->ran_real(), 0, 0, 0});
+        return result.finalize();
+    }
+
+    Tape::ptr Tape::Trace(std::shared_ptr<Path const> const &path) {
+        Tape result;
+        result.push({OPCODE::VAR, true});
+        result.paths.push_back(path);
+        result.push({OPCODE::PATH, false, 0, 0, 0});
+        return result.finalize();
+    }
+
+    Tape::ptr Tape::Approximation(std::shared_ptr<Chebyshev const> const &chebyshev, bool const ran_real) {
+        Tape result;
+        result.push({OPCODE::VAR, true});
+        result.chebyshevs.push_back(chebyshev);
+        result.push({OPCODE::CHEBYSHEV, ran_real, 0, 0, 0});
+        return result.finalize();
+    }
+
+    Tape::ptr Tape::Unary(OPCODE const op, Tape const &x) {
+        Tape result = x;
+        result.push({op, x.ran_real() && op != OPCODE::WIDEN, x.root});
+        return result.finalize();
+    }
+
+    Tape::ptr Tape::Binary(OPCODE const op, Tape const &lhs, Tape const &rhs) {
+        Tape result = lhs;
+        uint32_t const rhs_root = result.append(rhs, 0);
+        result.push({op, lhs.ran_real(), lhs.root, rhs_root});
+        return result.finalize();
+    }
+
+    Tape::ptr Tape::WithConst(OPCODE const op, Tape const &x, COMPLEX const c) {
+        Tape result = x;
+        result.push({op, x.ran_real(), x.root, 0, 0, c});
+        return result.finalize();
+    }
+
+    Tape::ptr Tape::Compose(Tape const &lhs, Tape const &rhs) {
+        Tape result = rhs;
+        result.append(lhs, rhs.root);
+        return result.finalize();
+    }
+}
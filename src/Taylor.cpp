@@ -0,0 +1,333 @@
+#include "Tape.h"
+#include <cmath>
+#include <limits>
+
+namespace libcalculus {
+    /* Truncated power series in a real step h: s[k] is the coefficient of h^k. Every function of a series keeps its
+     * length, and the zeroth coefficient of a preset applied to a series is computed with the same standard library
+     * function as plain evaluation. */
+    namespace Series {
+        template<typename T> using Series = std::vector<T>;
+
+        template<typename T>
+        static Series<T> constant(T const c, size_t const n) {
+            Series<T> result(n, T{0});
+            result[0] = c;
+            return result;
+        }
+
+        template<typename T>
+        static Series<T> mul(Series<T> const &a, Series<T> const &b) {
+            Series<T> result(a.size(), T{0});
+            for (size_t k = 0; k < a.size(); ++k) {
+                for (size_t j = 0; j <= k; ++j) result[k] += a[j] * b[k - j];
+            }
+            return result;
+        }
+
+        template<typename T>
+        static Series<T> div(Series<T> const &a, Series<T> const &b) {
+            Series<T> result(a.size());
+            for (size_t k = 0; k < a.size(); ++k) {
+                T sum = a[k];
+                for (size_t j = 0; j < k; ++j) sum -= result[j] * b[k - j];
+                result[k] = sum / b[0];
+            }
+            return result;
+        }
+
+        template<typename T>
+        static Series<T> recip(Series<T> const &a) { return div(constant(T{1}, a.size()), a); }
+
+        /* The series f with f' = a' g and f(0) = f0. */
+        template<typename T>
+        static Series<T> integrate(Series<T> const &a, Series<T> const &g, T const f0) {
+            Series<T> result(a.size());
+            result[0] = f0;
+            for (size_t k = 1; k < a.size(); ++k) {
+                T sum = 0.;
+                for (size_t j = 1; j <= k; ++j) sum += static_cast<REAL>(j) * a[j] * g[k - j];
+                result[k] = sum / static_cast<REAL>(k);
+            }
+            return result;
+        }
+
+        /* exp(a), given exp(a[0]) as e0; the recurrence follows from exp(a)' = a' exp(a). */
+        template<typename T>
+        static Series<T> exp(Series<T> const &a, T const e0) {
+            Series<T> result(a.size());
+            result[0] = e0;
+            for (size_t k = 1; k < a.size(); ++k) {
+                T sum = 0.;
+                for (size_t j = 1; j <= k; ++j) sum += static_cast<REAL>(j) * a[j] * result[k - j];
+                result[k] = sum / static_cast<REAL>(k);
+            }
+            return result;
+        }
+
+        template<typename T>
+        static Series<T> log(Series<T> const &a) {
+            Series<T> result(a.size());
+            result[0] = std::log(a[0]);
+            for (size_t k = 1; k < a.size(); ++k) {
+                T sum = 0.;
+                for (size_t j = 1; j < k; ++j) sum += static_cast<REAL>(j) * result[j] * a[k - j];
+                result[k] = (a[k] - sum / static_cast<REAL>(k)) / a[0];
+            }
+            return result;
+        }
+
+        template<typename T>
+        static Series<T> sqrt(Series<T> const &a) {
+            Series<T> result(a.size());
+            result[0] = std::sqrt(a[0]);
+            for (size_t k = 1; k < a.size(); ++k) {
+                T sum = 0.;
+                for (size_t j = 1; j < k; ++j) sum += result[j] * result[k - j];
+                result[k] = (a[k] - sum) / (2. * result[0]);
+            }
+            return result;
+        }
+
+        /* a ^ r for a constant r; at a[0] = 0 the recurrence breaks down, so integer powers are multiplied out. */
+        template<typename T>
+        static Series<T> pow(Series<T> const &a, T const r) {
+            size_t const n = a.size();
+            if (a[0] == T{0}) {
+                REAL const r_real = std::real(r);
+                if (std::imag(r) != 0. || r_real < 0. || r_real != std::floor(r_real) || r_real > 1e9) {
+                    Series<T> result(n, T{std::numeric_limits<REAL>::quiet_NaN()});
+                    result[0] = std::pow(a[0], r);
+                    return result;
+                }
+                Series<T> result = constant(T{1}, n), base = a;
+                for (auto e = static_cast<unsigned long long>(r_real); e > 0; e >>= 1) {
+                    if (e & 1) result = mul(result, base);
+                    if (e > 1) base = mul(base, base);
+                }
+                return result;
+            }
+            Series<T> result(n);
+            result[0] = std::pow(a[0], r);
+            for (size_t k = 1; k < n; ++k) {
+                T sum = 0.;
+                for (size_t j = 0; j < k; ++j) sum += (r * static_cast<REAL>(k - j) - static_cast<REAL>(j)) * a[k - j] * result[j];
+                result[k] = sum / (static_cast<REAL>(k) * a[0]);
+            }
+            return result;
+        }
+
+        /* sin(a) and cos(a) together, or sinh(a) and cosh(a) if hyperbolic. */
+        template<typename T>
+        static void sincos(Series<T> const &a, Series<T> &s, Series<T> &c, bool const hyperbolic) {
+            s.resize(a.size());
+            c.resize(a.size());
+            s[0] = hyperbolic ? std::sinh(a[0]) : std::sin(a[0]);
+            c[0] = hyperbolic ? std::cosh(a[0]) : std::cos(a[0]);
+            for (size_t k = 1; k < a.size(); ++k) {
+                T s_sum = 0., c_sum = 0.;
+                for (size_t j = 1; j <= k; ++j) {
+                    s_sum += static_cast<REAL>(j) * a[j] * c[k - j];
+                    c_sum += static_cast<REAL>(j) * a[j] * s[k - j];
+                }
+                s[k] = s_sum / static_cast<REAL>(k);
+                c[k] = (hyperbolic ? c_sum : -c_sum) / static_cast<REAL>(k);
+            }
+        }
+
+        template<typename T>
+        static Series<T> add(Series<T> a, T const c) {
+            a[0] += c;
+            return a;
+        }
+
+        template<typename T>
+        static Series<T> scale(Series<T> a, T const c) {
+            for (T &x : a) x *= c;
+            return a;
+        }
+
+        /* Series of the opcodes that map one or two values of kind T to another. */
+        template<typename T>
+        static Series<T> apply(OPCODE const op, Series<T> const &a, Series<T> const &b, T const c) {
+            size_t const n = a.size();
+            Series<T> result(n), s, co;
+            switch (op) {
+                case OPCODE::ADD: for (size_t k = 0; k < n; ++k) result[k] = a[k] + b[k]; return result;
+                case OPCODE::SUB: for (size_t k = 0; k < n; ++k) result[k] = a[k] - b[k]; return result;
+                case OPCODE::MUL: return mul(a, b);
+                case OPCODE::DIV: return div(a, b);
+                case OPCODE::POW: return exp(mul(b, log(a)), std::pow(a[0], b[0]));
+                case OPCODE::ADDC: return add(a, c);
+                case OPCODE::SUBC: return add(a, -c);
+                case OPCODE::CSUB: return add(scale(a, T{-1}), c);
+                case OPCODE::MULC: return scale(a, c);
+                case OPCODE::DIVC: for (size_t k = 0; k < n; ++k) result[k] = a[k] / c; return result;
+                case OPCODE::CDIV: return div(constant(c, n), a);
+                case OPCODE::POWC: return pow(a, c);
+                case OPCODE::CPOW: return exp(scale(a, std::log(c)), std::pow(c, a[0]));
+                case OPCODE::NEG: return scale(a, T{-1});
+                case OPCODE::RE: for (size_t k = 0; k < n; ++k) result[k] = std::real(a[k]); return result;
+                case OPCODE::IM: for (size_t k = 0; k < n; ++k) result[k] = std::imag(a[k]); return result;
+                case OPCODE::CONJ:
+                    if constexpr (std::is_same<T, REAL>::value) return a;
+                    else for (size_t k = 0; k < n; ++k) result[k] = std::conj(a[k]);
+                    return result;
+                case OPCODE::ABS:
+                    if constexpr (std::is_same<T, REAL>::value) {
+                        return scale(a, std::copysign(1., a[0]));
+                    } else {
+                        // |a| = sqrt(a conj(a)), which is real along the real step.
+                        Series<T> conj_a(n);
+                        for (size_t k = 0; k < n; ++k) conj_a[k] = std::conj(a[k]);
+                        result = sqrt(mul(a, conj_a));
+                        for (T &x : result) x = std::real(x);
+                        result[0] = std::abs(a[0]);
+                        return result;
+                    }
+                case OPCODE::ARG:
+                    if constexpr (std::is_same<T, REAL>::value) {
+                        return constant(T{std::arg(a[0])}, n);
+                    } else {
+                        result = log(a);
+                        for (T &x : result) x = std::imag(x);
+                        return result;
+                    }
+                case OPCODE::EXP: return exp(a, std::exp(a[0]));
+                case OPCODE::LN: return log(a);
+                case OPCODE::SIN: case OPCODE::COS: case OPCODE::TAN: case OPCODE::SEC: case OPCODE::CSC: case OPCODE::COT:
+                case OPCODE::SINH: case OPCODE::COSH: case OPCODE::TANH: case OPCODE::SECH: case OPCODE::CSCH: case OPCODE::COTH:
+                    sincos(a, s, co, op >= OPCODE::SINH);
+                    switch (op) {
+                        case OPCODE::SIN: case OPCODE::SINH: return s;
+                        case OPCODE::COS: case OPCODE::COSH: return co;
+                        case OPCODE::TAN: case OPCODE::TANH: return div(s, co);
+                        case OPCODE::SEC: case OPCODE::SECH: return recip(co);
+                        case OPCODE::CSC: case OPCODE::CSCH: return recip(s);
+                        default: return div(co, s);
+                    }
+                default: break;
+            }
+
+            // Inverse functions, from their derivatives; the reciprocal ones apply to 1 / a.
+            Series<T> const &u = (op >= OPCODE::ARCCSC && op <= OPCODE::ARCCOT) || (op >= OPCODE::ARCSCH && op <= OPCODE::ARCOTH) ? recip(a) : a;
+            Series<T> const u2 = mul(u, u);
+            switch (op) {
+                case OPCODE::ARCSIN: case OPCODE::ARCCSC:
+                    return integrate(u, recip(sqrt(add(scale(u2, T{-1}), T{1}))), std::asin(u[0]));
+                case OPCODE::ARCCOS: case OPCODE::ARCSEC:
+                    return integrate(u, scale(recip(sqrt(add(scale(u2, T{-1}), T{1}))), T{-1}), std::acos(u[0]));
+                case OPCODE::ARCTAN: case OPCODE::ARCCOT:
+                    return integrate(u, recip(add(u2, T{1})), std::atan(u[0]));
+                case OPCODE::ARSINH: case OPCODE::ARCSCH:
+                    return integrate(u, recip(sqrt(add(u2, T{1}))), std::asinh(u[0]));
+                case OPCODE::ARCOSH: case OPCODE::ARSECH:
+                    return integrate(u, recip(mul(sqrt(add(u, T{-1})), sqrt(add(u, T{1})))), std::acosh(u[0]));
+                case OPCODE::ARTANH: case OPCODE::ARCOTH:
+                    return integrate(u, recip(add(scale(u2, T{-1}), T{1})), std::atanh(u[0]));
+                default:
+                    return Series<T>(n, T{std::numeric_limits<REAL>::quiet_NaN()});
+            }
+        }
+    }
+
+    bool Tape::differentiable() const noexcept {
+        for (Instruction const &instr : this->code) {
+            if (instr.op == OPCODE::OPAQUE) return false;
+            if (instr.op == OPCODE::IF && !(this->branches[instr.aux]->then_->differentiable() &&
+                                            this->branches[instr.aux]->else_->differentiable())) return false;
+        }
+        return true;
+    }
+
+    std::vector<COMPLEX> Tape::taylor(std::vector<COMPLEX> const &x) const {
+        size_t const n = x.size();
+        auto const to_real = [&](std::vector<COMPLEX> const &a) {
+            std::vector<REAL> result(n);
+            for (size_t k = 0; k < n; ++k) result[k] = std::real(a[k]);
+            return result;
+        };
+
+        std::vector<std::vector<COMPLEX>> series(this->code.size());
+        series[0] = x;
+        for (size_t i = 1; i < this->code.size(); ++i) {
+            Instruction const &instr = this->code[i];
+            std::vector<COMPLEX> const &a = series[instr.a];
+            std::vector<COMPLEX> &out = series[i];
+            switch (instr.op) {
+                case OPCODE::CONST:
+                    out = Series::constant(instr.real ? COMPLEX{std::real(instr.c)} : instr.c, n);
+                    break;
+                case OPCODE::WIDEN:
+                    out = a;
+                    break;
+                case OPCODE::IF: {
+                    Branch const &branch = *this->branches[instr.aux];
+                    out = (branch.cond(a[0]) ? branch.then_ : branch.else_)->taylor(a);
+                    break;
+                }
+                case OPCODE::DERIVATIVE: {
+                    // f^(order) at a[0] + d has the series sum_j f^(order + j)(a[0]) / j! d^j, evaluated at d = a - a[0].
+                    Diff const &diff = *this->diffs[instr.aux];
+                    std::vector<COMPLEX> point = Series::constant(a[0], diff.order + n);
+                    point[1] = 1.;
+                    std::vector<COMPLEX> const coeffs = diff.f->taylor(point);
+                    std::vector<COMPLEX> step = a;
+                    step[0] = 0.;
+                    out = std::vector<COMPLEX>(n, 0.);
+                    for (size_t j = n; j-- > 0;) {
+                        COMPLEX coeff = coeffs[diff.order + j];
+                        for (size_t l = j + 1; l <= j + diff.order; ++l) coeff *= static_cast<REAL>(l);
+                        out = Series::add(Series::mul(out, step), coeff);
+                    }
+                    if (instr.real) for (COMPLEX &value : out) value = std::real(value);
+                    break;
+                }
+                case OPCODE::PATH: {
+                    // The piece at a[0], as a + b s or a + b e^(i omega s) of the series s = a - start.
+                    Path::Piece const &piece = this->paths[instr.aux]->piece(std::real(a[0]));
+                    std::vector<COMPLEX> const s = Series::add(a, COMPLEX{-piece.start});
+                    if (piece.omega == 0.) out = Series::add(Series::scale(s, piece.b), piece.a);
+                    else out = Series::add(Series::scale(Series::exp(Series::scale(s, COMPLEX{0., piece.omega}), std::exp(COMPLEX{0., piece.omega} * s[0])), piece.b), piece.a);
+                    break;
+                }
+                case OPCODE::CHEBYSHEV: {
+                    // Clenshaw's recurrence on the piece at a[0], over the series s = (2a - start - end) / (end - start).
+                    Chebyshev::Piece const &piece = this->chebyshevs[instr.aux]->piece(std::real(a[0]));
+                    REAL const width = piece.end - piece.start;
+                    std::vector<COMPLEX> const s = Series::add(Series::scale(a, COMPLEX{2. / width}), COMPLEX{-(piece.start + piece.end) / width});
+                    std::vector<COMPLEX> b1(n, 0.), b2(n, 0.);
+                    for (size_t k = piece.coeffs.size(); k-- > 1;) {
+                        std::vector<COMPLEX> b = Series::add(Series::scale(Series::mul(s, b1), COMPLEX{2.}), piece.coeffs[k]);
+                        for (size_t j = 0; j < n; ++j) b[j] -= b2[j];
+                        b2 = std::move(b1);
+                        b1 = std::move(b);
+                    }
+                    out = Series::add(Series::mul(s, b1), piece.coeffs.empty() ? COMPLEX{0.} : piece.coeffs[0]);
+                    for (size_t j = 0; j < n; ++j) out[j] -= b2[j];
+                    if (instr.real) for (COMPLEX &value : out) value = std::real(value);
+                    break;
+                }
+                case OPCODE::OPAQUE:
+                    out = std::vector<COMPLEX>(n, std::numeric_limits<REAL>::quiet_NaN());
+                    break;
+                default:
+                    if (instr.real) {
+                        std::vector<REAL> const result = Series::apply<REAL>(instr.op, to_real(a), to_real(series[instr.b]), std::real(instr.c));
+                        out.assign(result.begin(), result.end());
+                    } else {
+                        out = Series::apply<COMPLEX>(instr.op, a, series[instr.b], instr.c);
+                    }
+            }
+        }
+        return series[this->root];
+    }
+
+    COMPLEX Tape::derivative(COMPLEX const z, size_t const order) const {
+        std::vector<COMPLEX> x = Series::constant(this->dom_real() ? COMPLEX{std::real(z)} : z, order + 1);
+        if (order > 0) x[1] = 1.;
+        COMPLEX result = this->taylor(x)[order];
+        for (size_t k = 2; k <= order; ++k) result *= static_cast<REAL>(k);
+        return result;
+    }
+}
@@ -0,0 +1,206 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdint>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace libcalculus {
+    static size_t constexpr OUTSIDE = SIZE_MAX;
+    static size_t constexpr SPINS = 64; // Attempts an idle worker makes to find work before it sleeps.
+    static thread_local size_t worker_index = OUTSIDE; // The index of the pool thread running, or OUTSIDE.
+    static thread_local size_t depth = 0; // Loops an outside thread is running, one inside another.
+
+    ThreadPool &ThreadPool::instance() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    ThreadPool::ThreadPool() {
+        this->start(std::max<size_t>(NUM_THREADS, 1));
+    }
+
+    ThreadPool::~ThreadPool() {
+        this->stop();
+    }
+
+    size_t ThreadPool::size() const noexcept {
+        return this->workers.size() + 1;
+    }
+
+    void ThreadPool::resize(size_t const threads) {
+        std::unique_lock<std::shared_mutex> lock(this->resize_mutex);
+        if (std::max<size_t>(threads, 1) == this->size()) return;
+        this->stop();
+        this->start(std::max<size_t>(threads, 1));
+    }
+
+    bool ThreadPool::pinned() const noexcept {
+        return this->pinned_;
+    }
+
+    void ThreadPool::pin(bool const flag) {
+        std::unique_lock<std::shared_mutex> lock(this->resize_mutex);
+        this->pinned_ = flag;
+        for (size_t i = 0; i < this->workers.size(); ++i) this->apply_pinning(i);
+    }
+
+#if defined(__linux__)
+    /* The CPUs the process may run on, as it started. */
+    static std::vector<int> const &allowed_cpus() {
+        static std::vector<int> const cpus = [] {
+            std::vector<int> result;
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                    if (CPU_ISSET(cpu, &set)) result.push_back(cpu);
+                }
+            }
+            return result;
+        }();
+        return cpus;
+    }
+#endif
+
+    void ThreadPool::apply_pinning(size_t const index) {
+#if defined(__linux__)
+        // Worker i gets the (i + 1)-th allowed CPU, leaving the first one to the calling thread; unpinned workers may
+        // run on any of them.
+        std::vector<int> const &cpus = allowed_cpus();
+        if (cpus.empty()) return;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (this->pinned_) CPU_SET(cpus[(index + 1) % cpus.size()], &set);
+        else for (int const cpu : cpus) CPU_SET(cpu, &set);
+        pthread_setaffinity_np(this->workers[index].native_handle(), sizeof(set), &set);
+#endif
+    }
+
+    void ThreadPool::start(size_t const threads) {
+        this->stopping = false;
+        this->queues.clear();
+        for (size_t i = 0; i < threads; ++i) this->queues.push_back(std::make_unique<Queue>());
+        for (size_t i = 0; i + 1 < threads; ++i) this->workers.emplace_back(&ThreadPool::work, this, i);
+        if (this->pinned_) {
+            for (size_t i = 0; i < this->workers.size(); ++i) this->apply_pinning(i);
+        }
+    }
+
+    void ThreadPool::stop() {
+        {
+            std::lock_guard<std::mutex> lock(this->sleep_mutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        for (std::thread &worker : this->workers) worker.join();
+        this->workers.clear();
+    }
+
+    void ThreadPool::work(size_t const index) {
+        worker_index = index;
+        Range range;
+        while (true) {
+            bool found = false;
+            for (size_t spin = 0; spin < SPINS && !found; ++spin) {
+                if (!(found = this->find(index, range))) std::this_thread::yield();
+            }
+            if (found) {
+                this->execute(range, index);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(this->sleep_mutex);
+            this->sleeping.fetch_add(1);
+            this->wake.wait(lock, [this] { return this->queued.load() > 0 || this->stopping; });
+            this->sleeping.fetch_sub(1);
+            if (this->stopping) return;
+        }
+    }
+
+    bool ThreadPool::run(Job &job) {
+        // Loops started outside the pool keep it from being resized until they are done; those nested in them, and
+        // those of its own threads, already run under such a loop.
+        bool const outside = worker_index == OUTSIDE;
+        std::shared_lock<std::shared_mutex> lock;
+        if (outside && depth == 0) lock = std::shared_lock<std::shared_mutex>(this->resize_mutex);
+        if (this->workers.empty()) return false;
+
+        size_t const self = outside ? this->queues.size() - 1 : worker_index;
+        depth += outside;
+        this->execute({&job, 0, job.remaining.load()}, self);
+        // While the other threads finish their ranges of the loop, this one helps with whatever else is queued.
+        Range range;
+        while (job.remaining.load(std::memory_order_acquire) > 0) {
+            if (this->find(self, range)) this->execute(range, self);
+            else std::this_thread::yield();
+        }
+        depth -= outside;
+        return true;
+    }
+
+    void ThreadPool::execute(Range range, size_t const self) {
+        Job &job = *range.job;
+        while (range.end - range.begin > job.grain && !job.failed.load(std::memory_order_relaxed)) {
+            if (this->queues[self]->size.load(std::memory_order_relaxed) == 0) {
+                // Nothing left for other threads to take: offer them half of the range.
+                size_t const middle = range.begin + (range.end - range.begin) / 2;
+                this->push(*this->queues[self], {&job, middle, range.end});
+                range.end = middle;
+            } else {
+                this->call(job, range.begin, range.begin + job.grain);
+                range.begin += job.grain;
+            }
+        }
+        this->call(job, range.begin, range.end);
+    }
+
+    void ThreadPool::call(Job &job, size_t const begin, size_t const end) {
+        if (!job.failed.load(std::memory_order_relaxed)) {
+            try {
+                job.call(job.body, begin, end);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(job.error_mutex);
+                if (!job.error) job.error = std::current_exception();
+                job.failed = true;
+            }
+        }
+        // The job may be gone as soon as its last range is counted.
+        job.remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+    }
+
+    void ThreadPool::push(Queue &queue, Range const &range) {
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.ranges.push_back(range);
+            queue.size.fetch_add(1, std::memory_order_relaxed);
+            this->queued.fetch_add(1);
+        }
+        if (this->sleeping.load() > 0) {
+            std::lock_guard<std::mutex> lock(this->sleep_mutex);
+            this->wake.notify_one();
+        }
+    }
+
+    bool ThreadPool::find(size_t const self, Range &range) {
+        // The newest range of the thread's own queue, or else the oldest of another one.
+        size_t const n = this->queues.size();
+        for (size_t k = 0; k < n; ++k) {
+            Queue &queue = *this->queues[(self + k) % n];
+            if (queue.size.load(std::memory_order_relaxed) == 0) continue;
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.ranges.empty()) continue;
+            if (k == 0) {
+                range = queue.ranges.back();
+                queue.ranges.pop_back();
+            } else {
+                range = queue.ranges.front();
+                queue.ranges.pop_front();
+            }
+            queue.size.fetch_sub(1, std::memory_order_relaxed);
+            this->queued.fetch_sub(1);
+            return true;
+        }
+        return false;
+    }
+}
@@ -1,7 +1,11 @@
 # distutils: language = c++
 from Definitions cimport *
-import sys, os
-cimport openmp
+from ThreadPool cimport ThreadPool
+from Serial cimport *
+import sys, os, mmap
+cimport numpy as np
+
+np.import_array()
 
 cdef class _Globals:
   cdef size_t NUM_THREADS
@@ -11,15 +15,106 @@ cdef class _Globals:
 
 cdef _Globals Globals = _Globals()
 
-def threads(const size_t n=0):
-  """Get or set the number of threads available for the library to use."""
+cdef extern from "Definitions.h" namespace "libcalculus":
+  size_t NUM_THREADS
+  cbool PRESERVE_NAN
+
+NUM_THREADS = Globals.NUM_THREADS
+
+def threads(const size_t n=0, pin=None):
+  """Get or set the number of threads available for the library to use, and optionally whether each of them is bound
+  to a CPU of its own. The threads persist between calls, and share out the work by stealing it from each other."""
+  cdef cbool flag
+  if pin is not None:
+    flag = pin
+    with nogil:
+      ThreadPool.instance().pin(flag)
   if n == 0:
     return Globals.NUM_THREADS
   else:
-    Globals.NUM_THREADS = n
-    openmp.omp_set_num_threads(n)
+    global NUM_THREADS
+    Globals.NUM_THREADS = NUM_THREADS = n
+    with nogil:
+      ThreadPool.instance().resize(n)
     return n
 
+def preserve_nan(flag=None):
+  """Get or set whether functions are built exactly as they are written, keeping the NaNs, infinities and signs of zeros
+  they may produce, by skipping simplifications such as f * 0 -> 0, f * -1 -> -f and (2 f) * 3 -> 6 f. Only operations
+  on constants alone are still folded."""
+  global PRESERVE_NAN
+  if flag is not None:
+    PRESERVE_NAN = flag
+  return PRESERVE_NAN
+
+cdef inline const char *_data(const unsigned char[::1] data) noexcept nogil:
+  return <const char *>&data[0] if data.shape[0] > 0 else NULL
+
+from libc.stdint cimport uint8_t
+from libc.stddef cimport ptrdiff_t
+from libcpp.vector cimport vector
+
+cdef class _Operands:
+  """The arrays that an evaluation on an np.ndarray reads and writes, laid out as CFunction's strided operator() takes
+  them: z in the dtype dom, converted only if it is of another, and where, both broadcast to the shape of out, which
+  is a new array of the dtype ran if None is given. z is copied if it overlaps out other than point for point. As with
+  NumPy's ufuncs, an out of another dtype that ran casts to under the 'same_kind' rule is written through an array of
+  the dtype ran, which result() casts into it."""
+  cdef readonly np.ndarray z, out, where
+  cdef object cast_out
+  cdef cbool scalar
+  cdef size_t ndim
+  cdef vector[size_t] shape
+  cdef vector[ptrdiff_t] strides
+  cdef void *z_data
+  cdef void *out_data
+  cdef uint8_t *where_data
+
+  def __cinit__(_Operands self, z, out, where, dom, ran):
+    if z.dtype != dom:
+      z = z.astype(dom)
+    if where is True:
+      where = None
+    elif where is not None:
+      where = np.asarray(where, dtype=bool)
+    # The common cases, of arrays of one shape and of no out, are spared the broadcasting and the test for overlap.
+    shape = z.shape if where is None or where.shape == z.shape else np.broadcast_shapes(z.shape, where.shape)
+    self.scalar = out is None and len(shape) == 0
+    if out is None:
+      out = np.empty(shape, dtype=ran)
+    elif not isinstance(out, np.ndarray):
+      raise TypeError(f"out must be an np.ndarray, not {type(out)}")
+    elif not np.can_cast(ran, out.dtype, casting="same_kind"):
+      raise TypeError(f"cannot cast values of dtype {np.dtype(ran)} into out of dtype {out.dtype} with casting rule 'same_kind'")
+    elif not out.flags.writeable:
+      raise ValueError("out is read-only")
+    elif out.shape != shape and np.broadcast_shapes(shape, out.shape) != out.shape:
+      raise ValueError(f"the input of shape {shape} cannot be broadcast to out of shape {out.shape}")
+    elif out.dtype != ran:
+      self.cast_out, out = out, np.empty(out.shape, dtype=ran)
+    elif np.may_share_memory(z, out) and not (z.shape == out.shape and z.strides == out.strides
+                                              and z.itemsize == out.itemsize and z.ctypes.data == out.ctypes.data):
+      z = z.copy()
+    if z.shape != out.shape:
+      z = np.broadcast_to(z, out.shape)
+    if where is not None and where.shape != out.shape:
+      where = np.broadcast_to(where, out.shape)
+    self.z, self.out, self.where = z, out, where
+    self.ndim = out.ndim
+    self.shape = out.shape
+    self.strides = z.strides + out.strides + ((0,) * out.ndim if where is None else where.strides)
+    self.z_data, self.out_data = np.PyArray_DATA(self.z), np.PyArray_DATA(self.out)
+    if where is not None:
+      self.where_data = <uint8_t *>np.PyArray_DATA(self.where)
+
+  cdef result(_Operands self):
+    """What the evaluation returns once out is written: out as it was given, with the values cast into it if need be,
+    or, as from NumPy's ufuncs, a scalar for a 0-d array without out."""
+    if self.cast_out is not None:
+      np.copyto(self.cast_out, self.out, casting="same_kind", where=True if self.where is None else self.where)
+      return self.cast_out
+    return self.out[()] if self.scalar else self.out
+
 include "RealComparison.pyx"
 include "ComplexComparison.pyx"
 include "Comparison.pyx"
@@ -30,6 +125,8 @@ include "RealFunction.pyx"
 include "Function.pyx"
 
 include "CAnalysis.pyx"
+include "Profile.pyx"
+include "Stream.pyx"
 
 
 def constant(c):
@@ -40,6 +137,20 @@ def constant(c):
   else:
     raise NotImplementedError(f"Type {type(c)} not supported.")
 
+def loads(const unsigned char[::1] data not None):
+  """Load a function or comparison from what its to_bytes() returned, in bytes or any other buffer."""
+  cdef Object kind
+  with nogil:
+    kind = data_object(_data(data), data.shape[0])
+  return {COMPLEX_FUNCTION: ComplexFunction, CONTOUR: Contour, REAL_FUNCTION: RealFunction,
+          COMPLEX_COMPARISON: ComplexComparison, REAL_COMPARISON: RealComparison}[kind].from_bytes(data)
+
+def load(path):
+  """Load a function or comparison from a file holding what its to_bytes() returned. The file is memory-mapped, and
+  its records are read in place."""
+  with open(path, "rb") as file, mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ) as data:
+    return loads(data)
+
 def __setattr__(name):
   raise AttributeError(f"cannot set attribute {name} in module {__name__}")
 
@@ -146,5 +257,25 @@ def line(const COMPLEX z1, const COMPLEX z2):
 
 def sphere(const COMPLEX center=0., const REAL radius=1.):
   return Function(None,
-                  center + radius * (ComplexFunction.Exp() @ (2j * Contour.Pi() * Contour.Identity())),
+                  Contour.Sphere(center, radius),
+                  None)
+
+def arc(const COMPLEX center, const REAL radius, const REAL start_angle, const REAL end_angle):
+  return Function(None,
+                  Contour.Arc(center, radius, start_angle, end_angle),
+                  None)
+
+def polyline(points, const cbool closed=False):
+  return Function(None,
+                  Contour.Polyline(points, closed),
+                  None)
+
+def rectangle(const COMPLEX z1, const COMPLEX z2):
+  return Function(None,
+                  Contour.Rectangle(z1, z2),
+                  None)
+
+def concat(*contours):
+  return Function(None,
+                  Contour.Concat(*contours),
                   None)
@@ -3,13 +3,28 @@ import libcalculus
 from libcalculus import ComplexFunction, RealFunction, Contour, integrate
 
 import numpy as np
-import scipy.misc, scipy.integrate
+import scipy.integrate, scipy.special
 import operator
 import argparse
-import pqdm.processes
+try:
+    import pqdm.processes
+except ImportError:
+    pqdm = None
 import multiprocessing as mp
 import requests
 import warnings
+import pickle
+import os
+import tempfile
+
+def _parallel(function, args, n_jobs, **kwargs):
+    """Call function on each list of arguments in args across n_jobs processes, with pqdm's progress bar if it is
+    installed and a plain pool otherwise."""
+    if pqdm is not None:
+        return pqdm.processes.pqdm(args, function, n_jobs=n_jobs, argument_type="args", exception_behaviour="immediate",
+                                   bounded=True, **kwargs)
+    with mp.Pool(n_jobs) as pool:
+        return pool.starmap(function, args)
 
 class Tester:
     def run(self):
@@ -21,11 +36,11 @@ class Tester:
 class FunctionTester(Tester):
     BASE_FUNCTIONS = {libcalculus.constant: None,
                       libcalculus.identity: lambda z: z,
-                      libcalculus.real: lambda z: np.real(z),
-                      libcalculus.imag: lambda z: np.imag(z),
+                      libcalculus.real: lambda z: complex(np.real(z)),
+                      libcalculus.imag: lambda z: complex(np.imag(z)),
                       libcalculus.conj: lambda z: np.conj(z),
-                      libcalculus.abs: lambda z: np.abs(z),
-                      libcalculus.arg: lambda z: np.angle(z),
+                      libcalculus.abs: lambda z: complex(np.abs(z)),
+                      libcalculus.arg: lambda z: complex(np.angle(z)),
                       libcalculus.exp: lambda z: complex(np.exp(z)),
                       libcalculus.ln: lambda z: complex(np.log(z)),
                       libcalculus.sin: lambda z: complex(np.sin(z)),
@@ -140,24 +155,21 @@ class FunctionTester(Tester):
         super().run()
         # First try with an increasing number of operations; that way an error in a basic operator will pop up with a simple function
         # and not a convoluted one
-        pqdm.processes.pqdm([[n_vals, i] for i in range(self.MAX_OPS)],
-                            self._run_func, n_jobs=self.N_JOBS, argument_type="args", exception_behaviour="immediate", bounded=True,
-                            disable=True)
+        _parallel(self._run_func, [[n_vals, i] for i in range(self.MAX_OPS)], self.N_JOBS, disable=True)
 
         # Now try with a random number of operations.
-        pqdm.processes.pqdm([[n_vals, None] for _ in range(n_funcs - self.MAX_OPS)],
-                            self._run_func, n_jobs=self.N_JOBS, argument_type="args", exception_behaviour="immediate", bounded=True)
+        _parallel(self._run_func, [[n_vals, None] for _ in range(n_funcs - self.MAX_OPS)], self.N_JOBS)
 
         super()._done()
 
 class ComplexFunctionTester(FunctionTester):
     BASE_FUNCTIONS = {ComplexFunction.Constant: None,
                       ComplexFunction.Identity: lambda z: z,
-                      ComplexFunction.Re: lambda z: np.real(z),
-                      ComplexFunction.Im: lambda z: np.imag(z),
+                      ComplexFunction.Re: lambda z: complex(np.real(z)),
+                      ComplexFunction.Im: lambda z: complex(np.imag(z)),
                       ComplexFunction.Conj: lambda z: np.conj(z),
-                      ComplexFunction.Abs: lambda z: np.abs(z),
-                      ComplexFunction.Arg: lambda z: np.angle(z),
+                      ComplexFunction.Abs: lambda z: complex(np.abs(z)),
+                      ComplexFunction.Arg: lambda z: complex(np.angle(z)),
                       ComplexFunction.Exp: lambda z: complex(np.exp(z)),
                       ComplexFunction.Ln: lambda z: complex(np.log(z)),
                       ComplexFunction.Sin: lambda z: complex(np.sin(z)),
@@ -262,10 +274,882 @@ class ContourTester(ComplexFunctionTester):
         c, cc = super()._gen_function(n_ops)
         return c, cc
 
+class KernelTester(Tester):
+    """Array evaluation of every preset against scalar evaluation, at zeros of either sign and on the axes, where the
+    signs of the zeros in the results decide the side of later branch cuts."""
+    VALUES = [0., 1e-200, .3, 1., 2.42, 3., 1e200, np.inf]
+
+    def _points(self, real):
+        values = [sign * v for v in self.VALUES for sign in (1., -1.)]
+        if real:
+            return np.array(values * 8)
+        return np.array([complex(a, b) for a in values for b in values if a == 0. or b == 0.] * 4)
+
+    def _same(self, x, y):
+        return (np.isnan(x) and np.isnan(y)) or (x == y and np.signbit(x) == np.signbit(y)) or \
+               (x != 0. and np.isclose(x, y, rtol=1e-13, atol=0.))
+
+    def run(self):
+        super().run()
+        np.seterr(all="ignore")
+        for tester, real in ((ComplexFunctionTester, False), (RealFunctionTester, True), (ContourTester, True)):
+            points = self._points(real)
+            for base in tester.BASE_FUNCTIONS:
+                if tester.BASE_FUNCTIONS[base] is None:
+                    continue
+                f = base()
+                for x, value in zip(points, f(points)):
+                    scalar = complex(f(x))
+                    value = complex(value)
+                    if not (self._same(value.real, scalar.real) and self._same(value.imag, scalar.imag)):
+                        raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()}\n\t "
+                                         f"at {x!r}: {value} in an array vs {scalar} alone")
+        super()._done()
+
+class ArrayTester(Tester):
+    """Evaluation of random functions of every kind on arrays, on one thread and on several, against evaluation at each
+    point alone. The kernels are accurate to a few ulps rather than correctly rounded, so a function that sits on the edge
+    of a branch cut, such as (-0.5) ** (cot(t) tan(t)), may disagree at some points; only disagreement on many functions
+    is an error."""
+    TESTERS = [ComplexFunctionTester, RealFunctionTester, ContourTester, FunctionTester]
+    THREADS = [1, 3]
+    BOUND = 5. # Far out, compositions such as arcoth(coth(z)) amplify the last bits that the kernels may differ in.
+    RTOL = 1e-9
+    MAX_ERRORS = 10
+
+    def _run_array(self, tester, n_vals):
+        """Returns a description of the first disagreement of a random function on MAX_ERRORS points or more, if any."""
+        np.seterr(all="ignore")
+        f, _ = tester._gen_function()
+        x = tester._rand(n_vals)
+        scalars = np.array([f(v) for v in x])
+        try:
+            for n_threads in self.THREADS:
+                libcalculus.threads(n_threads)
+                values = f(x)
+                close = np.isclose(values, scalars, rtol=self.RTOL, atol=self.RTOL, equal_nan=True) | \
+                        (~np.isfinite(values) & ~np.isfinite(scalars))
+                if np.count_nonzero(~close) >= self.MAX_ERRORS:
+                    i = np.argmin(close)
+                    return f"{f.latex()}\n\t at {x[i]} on {n_threads} threads: {values[i]} in an array vs {scalars[i]} alone"
+        finally:
+            libcalculus.threads(1)
+        if isinstance(f, libcalculus.Function):
+            # Functions that keep a real part take real points to it, and it must agree with the complex part.
+            t = x.real
+            values, complex_values = f(t), f(t.astype(complex))
+            close = ~np.isfinite(values) | np.isclose(values, complex_values, rtol=self.RTOL, atol=self.RTOL)
+            if np.isrealobj(values) and np.count_nonzero(~close) >= self.MAX_ERRORS:
+                i = np.argmin(close)
+                return f"{f.latex()}\n\t at {t[i]}: {values[i]} for a real point vs {complex_values[i]} for a complex one"
+
+    def run(self, n_funcs, n_vals):
+        """Generate n_funcs random functions of each kind and check them on arrays of n_vals values."""
+        super().run()
+        for tester in self.TESTERS:
+            tester = tester()
+            tester.BOUND = self.BOUND
+            errors = [error for error in (self._run_array(tester, n_vals) for _ in range(n_funcs)) if error is not None]
+            if len(errors) >= self.MAX_ERRORS:
+                raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {len(errors)} of {n_funcs} functions "
+                                 f"disagree, such as {errors[0]}")
+        super()._done()
+
+class RewriteTester(Tester):
+    """Each rewrite that functions go through as they are built, against the function built as written under
+    preserve_nan(True), on every preset. The LaTeX must be that of the simplified form, and the values those of the form
+    as written but for rounding and the changes the rewrite is known to make: DROPS_NAN rewrites may give a finite value
+    where the form as written overflows or is NaN, and FLIPS_ZERO ones may change the signs of zeros."""
+    DROPS_NAN, FLIPS_ZERO = 1, 2
+    REWRITES = [(lambda cls, f: f + 0, lambda cls, f: f, FLIPS_ZERO),
+                (lambda cls, f: f - 0, lambda cls, f: f, 0),
+                (lambda cls, f: f * 1, lambda cls, f: f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: f / 1, lambda cls, f: f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: f ** 1, lambda cls, f: f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: f * 0, lambda cls, f: cls.Constant(0), DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: 0 / f, lambda cls, f: cls.Constant(0), DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: f ** 0, lambda cls, f: cls.Constant(1), DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: 1 ** f, lambda cls, f: cls.Constant(1), DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: f * -1, lambda cls, f: -f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: 0 - f, lambda cls, f: -f, FLIPS_ZERO),
+                (lambda cls, f: -(-f), lambda cls, f: f, 0),
+                (lambda cls, f: -(2 * f), lambda cls, f: f * -2, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: -(2 - f), lambda cls, f: f - 2, FLIPS_ZERO),
+                (lambda cls, f: (-f) * 3, lambda cls, f: f * -3, FLIPS_ZERO),
+                (lambda cls, f: 3 - (-f), lambda cls, f: f + 3, FLIPS_ZERO),
+                (lambda cls, f: (f + 2) + 3, lambda cls, f: f + 5, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: (f - 2) + 3, lambda cls, f: f + 1, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: (f + 2) - 5, lambda cls, f: f - 3, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: (2 - f) + 3, lambda cls, f: 5 - f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: 3 - (f + 2), lambda cls, f: 1 - f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: 3 - (2 - f), lambda cls, f: f + 1, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: (2 * f) * 3, lambda cls, f: 6 * f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: (f / 2) * 3, lambda cls, f: 1.5 * f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: (2 / f) * 3, lambda cls, f: 6 / f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: (2 * f) / 4, lambda cls, f: .5 * f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: (f / 2) / 4, lambda cls, f: f / 8, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: (2 / f) / 4, lambda cls, f: .5 / f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: 3 / (2 * f), lambda cls, f: 1.5 / f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: 3 / (f / 2), lambda cls, f: 6 / f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: 3 / (2 / f), lambda cls, f: 1.5 * f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: cls.Exp() @ (cls.Ln() @ f), lambda cls, f: f, DROPS_NAN | FLIPS_ZERO),
+                (lambda cls, f: cls.Conj() @ (cls.Conj() @ f), lambda cls, f: f, 0),
+                (lambda cls, f: f @ cls.Identity(), lambda cls, f: f, 0),
+                (lambda cls, f: cls.Identity() @ f, lambda cls, f: f, 0)]
+    RTOL = 1e-12
+    N_VALS = 200
+
+    def _same(self, simplified, written, changes):
+        if np.isnan(simplified) and np.isnan(written):
+            return True
+        if changes & self.DROPS_NAN and not np.isfinite(written):
+            return True
+        if simplified == written:
+            return np.signbit(simplified) == np.signbit(written) or changes & self.FLIPS_ZERO
+        return np.isclose(simplified, written, rtol=self.RTOL, atol=self.RTOL)
+
+    def run(self):
+        super().run()
+        np.seterr(all="ignore")
+        preserve_nan = libcalculus.preserve_nan()
+        for tester, real in ((ComplexFunctionTester, False), (RealFunctionTester, True)):
+            cls = ComplexFunction if not real else RealFunction
+            x = np.concatenate([tester()._rand(self.N_VALS), KernelTester()._points(real)])
+            for base in tester.BASE_FUNCTIONS:
+                if tester.BASE_FUNCTIONS[base] is None:
+                    continue
+                for build, build_expected, changes in self.REWRITES:
+                    try:
+                        libcalculus.preserve_nan(False)
+                        f, expected = build(cls, base()), build_expected(cls, base())
+                        libcalculus.preserve_nan(True)
+                        g = build(cls, base())
+                    finally:
+                        libcalculus.preserve_nan(preserve_nan)
+                    if f.latex() != expected.latex():
+                        raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {g.latex()} simplified to "
+                                         f"{f.latex()} rather than {expected.latex()}")
+                    # The sum of the parts, which any rewrite of f + a may round at, is the scale to which both agree.
+                    scale = np.maximum(np.abs(base()(x)), 1.)
+                    for z, simplified, written, s in zip(x, f(x), g(x), scale):
+                        simplified, written = complex(simplified), complex(written)
+                        if not (self._same(simplified.real / s, written.real / s, changes) and
+                                self._same(simplified.imag / s, written.imag / s, changes)):
+                            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()}\n\t "
+                                             f"at {z!r}: {simplified} vs {written} for {g.latex()}")
+        try:
+            libcalculus.preserve_nan(True)
+            if not np.isnan((ComplexFunction.Ln() * 0)(0.)) or np.signbit((ComplexFunction.Sin() * -1)(0j).imag):
+                raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m preserve_nan(True) still simplifies")
+        finally:
+            libcalculus.preserve_nan(preserve_nan)
+        super()._done()
+
+class DerivativeTester(Tester):
+    """Derivatives of the analytic presets and of random functions built from them, both by Taylor series and
+    symbolically, against Cauchy's integral formula on small circles around each point. A point is skipped where circles of two radii disagree, which is where a pole or
+    a branch cut is too close for the formula."""
+    NON_ANALYTIC = {ComplexFunction.Constant, ComplexFunction.Re, ComplexFunction.Im, ComplexFunction.Conj,
+                    ComplexFunction.Abs, ComplexFunction.Arg}
+    ORDERS = [1, 2, 3]
+    RADII = [.05, .025]
+    N_NODES = 64
+    RTOL = 1e-6
+    N_VALS = 20
+
+    def _cauchy(self, f, z, order, radius):
+        """The order-th derivative of f at z, by the trapezoidal rule on the circle of the radius around it."""
+        w = radius * np.exp(2j * np.pi * np.arange(self.N_NODES) / self.N_NODES)
+        return scipy.special.factorial(order) * np.mean(f(z + w) / w ** order), np.max(np.abs(f(z + w)))
+
+    def _check(self, f, derivatives, z):
+        for order, derivative in zip(self.ORDERS, derivatives):
+            (reference, scale), (other, _) = (self._cauchy(f, z, order, radius) for radius in self.RADII)
+            tol = self.RTOL * max(scale, 1.) / self.RADII[0] ** order
+            if not (np.isfinite(reference) and abs(reference - other) <= tol):
+                continue
+            value = derivative(z)
+            if not abs(value - reference) <= tol:
+                raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m derivative of order {order} of "
+                                 f"{f.latex()}\n\t at {z}: {value} vs actual {reference}")
+
+    def run(self, n_funcs):
+        """Check the presets, and n_funcs random functions of analytic presets."""
+        super().run()
+        np.seterr(all="ignore")
+        tester = ComplexFunctionTester()
+        tester.BOUND = 3.
+        tester.BASE_FUNCTIONS = {base: value for base, value in ComplexFunctionTester.BASE_FUNCTIONS.items()
+                                 if base not in self.NON_ANALYTIC}
+        functions = [base() for base in tester.BASE_FUNCTIONS] + [tester._gen_function(2)[0] for _ in range(n_funcs)]
+        for f in functions:
+            for symbolic in (False, True):
+                derivatives = [libcalculus.derivative(f, order, symbolic=symbolic) for order in self.ORDERS]
+                if symbolic and "\\frac{\\text{d}}" in derivatives[0].latex():
+                    raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m symbolic derivative of "
+                                     f"{f.latex()} left unevaluated: {derivatives[0].latex()}")
+                for z in tester._rand(self.N_VALS):
+                    self._check(f, derivatives, z)
+        # Functions of a real variable, including piecewise Chebyshev interpolants, against their complex counterparts.
+        for name in ("Exp", "Sin", "Tanh", "Arctan", "Arsinh"):
+            f, g = getattr(RealFunction, name)(), getattr(ComplexFunction, name)()
+            for f in (f, f.approximate(-3., 3., 1e-14)):
+                for order in self.ORDERS[:2]:
+                    for x in np.linspace(-2.5, 2.5, 11):
+                        value, (reference, scale) = libcalculus.derivative(f, order)(x), self._cauchy(g, x, order, self.RADII[0])
+                        if not abs(value - reference) <= 1e-4 * max(scale, 1.):
+                            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m derivative of order "
+                                             f"{order} of {f.latex()}\n\t at {x}: {value} vs actual {reference}")
+        super()._done()
+
+class CoefficientTester(Tester):
+    """Taylor and Laurent coefficients and residues of functions whose expansions are known in closed form, at single
+    centers and at arrays of them; each coefficient must be within the error estimate returned with it."""
+    N_VALS = 20
+    BOUND = 3.
+
+    def _compare(self, name, coeffs, error, exact, radius, offset=0):
+        scaled = np.abs(coeffs - exact) * radius ** (np.arange(len(exact)) + offset)
+        if not np.all(scaled <= 10. * error + 1e-12):
+            k = np.argmax(scaled)
+            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {name}: coefficient {k + offset} is "
+                             f"{coeffs[k]} vs actual {exact[k]}, beyond the estimate {error}")
+
+    def run(self):
+        super().run()
+        centers = ComplexFunctionTester()._rand(self.N_VALS) * self.BOUND / ComplexFunctionTester.BOUND
+        factorials = scipy.special.factorial(np.arange(32))
+        # exp(z) = sum exp(z0) / k! (z - z0)^k
+        rows, errors = libcalculus.coefficients(libcalculus.exp, centers, 1., 32)
+        for z0, row, error in zip(centers, rows, errors):
+            self._compare(f"e^z around {z0}", row, error, np.exp(z0) / factorials, 1.)
+            scalar_row, scalar_error = libcalculus.coefficients(libcalculus.exp, z0, 1., 32)
+            if not np.allclose(scalar_row, row, rtol=1e-12, atol=1e-15):
+                raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m e^z around {z0}: "
+                                 f"{scalar_row} alone vs {row} in an array")
+        # 1 / (z (z - 3)) = -sum z^m / 3^(m + 2) for m >= -1 around 0, inside the circle of radius 3.
+        f = 1 / (libcalculus.identity * (libcalculus.identity - 3))
+        coeffs, error = libcalculus.coefficients(f, 0., 1., 64, laurent=True)
+        exact = np.array([-3. ** -(m + 2) if m >= -1 else 0. for m in range(-32, 32)])
+        self._compare(f.latex(), coeffs, error, exact, 1., -32)
+        # Residues of csc at k pi, and of 1 / (z^2 + 1) at i.
+        poles = np.pi * np.arange(-3, 4)
+        residues = libcalculus.residue(libcalculus.csc, poles, tol=1e-9)
+        if not np.allclose(residues, (-1.) ** np.arange(-3, 4), rtol=1e-9, atol=1e-9):
+            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m residues of csc at {poles}: {residues}")
+        residue = libcalculus.residue(1 / (libcalculus.identity ** 2 + 1), 1j, radius=.5, tol=1e-9)
+        if not np.isclose(residue, -.5j, rtol=1e-9, atol=1e-9):
+            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m residue of 1 / (z^2 + 1) at i: {residue}")
+        super()._done()
+
+class QuadratureTester(Tester):
+    """Integrals with closed forms, along contours and over intervals, to tight tolerances; each must be within its
+    tolerance and within the error estimate returned with it, and the same to the bit on any number of threads."""
+    TOL = 1e-10
+    THREADS = [1, 2, 3]
+
+    def _integrals(self):
+        """Yields the integrals, as tuples of the arguments of integrate() and the exact value."""
+        z, t = libcalculus.identity, RealFunction.Identity()
+        for k in range(-3, 4): # The integral of z^k around the unit circle is 2 pi i for k = -1 and 0 otherwise.
+            yield z ** k if k != 0 else libcalculus.constant(1.), libcalculus.sphere(0., 1.), 2j * np.pi * (k == -1)
+        yield z ** 2, libcalculus.line(0., 1. + 1j), (1. + 1j) ** 3 / 3.
+        yield libcalculus.exp, libcalculus.rectangle(-1. - 1j, 1. + 1j), 0.
+        yield libcalculus.cos / z, libcalculus.polyline([1., 1j, -1., -1j], closed=True), 2j * np.pi
+        yield libcalculus.cosh, [1., 2.], np.sinh(2.) - np.sinh(1.)
+        yield RealFunction.Exp(), [0., 1.], np.e - 1.
+        yield RealFunction.Sin() * RealFunction.Sin(), [0., 10. * np.pi], 5. * np.pi
+        yield 1. / (1. + 25. * t * t), [-1., 1.], .4 * np.arctan(5.)
+
+    def run(self):
+        super().run()
+        for f, contour, exact in self._integrals():
+            for extended in (False, True):
+                value, error, evaluations = libcalculus.integrate(f, contour, tol=self.TOL, full_output=True, extended=extended)
+                if not (abs(value - exact) <= 10. * self.TOL and abs(value - exact) <= 10. * error + 1e-14 and evaluations > 0):
+                    raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} along "
+                                     f"{contour.latex() if hasattr(contour, 'latex') else contour}"
+                                     f"{' in extended precision' if extended else ''}: {value} vs actual {exact}, with "
+                                     f"an estimated error of {error} after {evaluations} evaluations")
+        # The intervals are summed in the same order however many threads evaluate them, so the results are identical.
+        try:
+            for f, contour, _ in self._integrals():
+                results = []
+                for n_threads in self.THREADS:
+                    libcalculus.threads(n_threads)
+                    results.append(libcalculus.integrate(f, contour, tol=self.TOL, full_output=True))
+                if any(result != results[0] for result in results):
+                    raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} on "
+                                     f"{self.THREADS} threads: {results}")
+        finally:
+            libcalculus.threads(1)
+        # A batch, mixing contour and interval integrals, gives what each integral gives alone.
+        fs, contours, _ = zip(*self._integrals())
+        values, errors, evaluations = libcalculus.integrate_many(fs, contours, tol=self.TOL)
+        for f, contour, value, error, n_evaluations in zip(fs, contours, values, errors, evaluations):
+            alone = libcalculus.integrate(f, contour, tol=self.TOL, full_output=True)
+            if alone != (value, error, n_evaluations):
+                raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} in a batch: "
+                                 f"{(value, error, n_evaluations)} vs {alone} alone")
+        super()._done()
+
+class RootTester(Tester):
+    """Roots of random polynomials with known roots, some of them double or triple and some close together, and the
+    poles of their reciprocals, inside circles and rectangles that hold all of them."""
+    N_ROOTS = 5
+    BOUND = 2.
+    MIN_DISTANCE = .05
+    TOL = 1e-6
+
+    def _random_roots(self):
+        roots = []
+        while len(roots) < self.N_ROOTS:
+            root = ComplexFunctionTester()._rand() * self.BOUND / ComplexFunctionTester.BOUND
+            if all(abs(root - other) >= self.MIN_DISTANCE for other in roots):
+                roots.append(root)
+        return np.array(roots), np.random.randint(1, 4, size=self.N_ROOTS)
+
+    def _check(self, name, found, multiplicities, roots, expected_multiplicities):
+        found_order, order = np.argsort(found.real), np.argsort(roots.real)
+        if len(found) != len(roots) or not (np.allclose(found[found_order], roots[order], rtol=0., atol=self.TOL) and
+                                            np.all(multiplicities[found_order] == expected_multiplicities[order])):
+            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {name}: {found} with multiplicities "
+                             f"{multiplicities} vs actual {roots} with {expected_multiplicities}")
+
+    def run(self, n_funcs):
+        super().run()
+        for _ in range(n_funcs):
+            roots, expected_multiplicities = self._random_roots()
+            p = libcalculus.constant(1.)
+            for root, multiplicity in zip(roots, expected_multiplicities):
+                p *= (libcalculus.identity - root) ** int(multiplicity)
+            for contour in (libcalculus.sphere(0., 1.5 * self.BOUND), libcalculus.rectangle(-3. - 3.1j, 3.2 + 3j)):
+                self._check(f"roots of {p.latex()}", *libcalculus.roots(p, contour), roots, expected_multiplicities)
+                self._check(f"poles of {(1 / p).latex()}", *libcalculus.poles(1 / p, contour), roots, expected_multiplicities)
+        super()._done()
+
+class ComparisonTester(Tester):
+    """Random comparisons of random functions, combined with ~, & and |, and the piecewise functions they choose
+    between, on arrays, which are evaluated into bitmasks and over the compacted points of each branch, against
+    evaluation at each point alone. The bitmasks must be the same, except where the sides of a comparison are within
+    the few ulps the kernels are accurate to; the values, as in ArrayTester, close, since a branch may be
+    ill-conditioned enough to amplify those ulps."""
+    REAL_OPERATIONS = [operator.gt, operator.lt, operator.ge, operator.le, operator.eq, operator.ne]
+    COMPLEX_OPERATIONS = [operator.eq, operator.ne]
+    MAX_COMBINATIONS = 4
+    N_VALS = 300
+
+    def _gen_comparison(self, tester, operations):
+        """A random comparison of random functions of the tester's kind, or of one with a constant it takes often, and
+        the pairs of sides it compares."""
+        sides = []
+        def compare():
+            f, _ = tester._gen_function(1)
+            # Constants are taken from f's own values, so that == and != are not trivially all False or all True.
+            rhs = tester._gen_function(1)[0] if np.random.rand() < .5 else f(tester._rand())
+            sides.append((f, rhs))
+            return np.random.choice(operations)(f, rhs)
+        comparison = compare()
+        for _ in range(np.random.randint(0, self.MAX_COMBINATIONS)):
+            combination = np.random.randint(3)
+            if combination == 0:
+                comparison = ~comparison
+            else:
+                comparison = (operator.and_ if combination == 1 else operator.or_)(comparison, compare())
+        return comparison, sides
+
+    def _check(self, name, values, scalars, x, edges, rtol=0.):
+        close = np.isclose(values, scalars, rtol=rtol, atol=rtol, equal_nan=True) | (values == scalars) | edges
+        if not np.all(close):
+            i = np.argmin(close)
+            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {name}\n\t at {x[i]}: {values[i]} in "
+                             f"an array vs {scalars[i]} alone")
+
+    def run(self, n_comparisons):
+        super().run()
+        np.seterr(all="ignore")
+        kinds = ((RealFunctionTester(), self.REAL_OPERATIONS, (RealFunction, Contour)),
+                 (ComplexFunctionTester(), self.COMPLEX_OPERATIONS, (ComplexFunction,)))
+        for tester, operations, classes in kinds:
+            tester.BOUND = ArrayTester.BOUND
+            for _ in range(n_comparisons):
+                comparison, sides = self._gen_comparison(tester, operations)
+                x = tester._rand(self.N_VALS)
+                # Points where the comparison's functions are equal, for == and !=.
+                x[::10] = 0.
+                edges = np.zeros(x.shape, dtype=bool)
+                for lhs, rhs in sides:
+                    edges |= np.isclose(lhs(x), rhs(x) if callable(rhs) else rhs, rtol=ArrayTester.RTOL, atol=ArrayTester.RTOL)
+                functions = [cls.If(comparison, tester._gen_function(1)[0] if cls is not Contour else Contour.Exp(), cls.Cos())
+                             for cls in classes]
+                # Comparisons have no LaTeX of their own; that of the piecewise functions shows them.
+                self._check(f"the condition of {functions[0].latex()}", comparison(x),
+                            np.array([comparison(v) for v in x]), x, edges)
+                for f in functions:
+                    self._check(f.latex(), f(x), np.array([f(v) for v in x]), x, edges, ArrayTester.RTOL)
+        super()._done()
+
+class DeduplicationTester(Tester):
+    """deduplicated() of functions of every kind with known repeats, which counts the operations of the expression
+    written out as a tree beyond those evaluated: f f + f repeats the operations of f twice, and an expression without
+    repeats none. Random functions with repeats must evaluate as their repeated parts do."""
+    # The kinds, with the operations each preset is evaluated by: those of contours widen their values to complex ones.
+    KINDS = [(ComplexFunction, ComplexFunctionTester, 1), (RealFunction, RealFunctionTester, 1), (Contour, ContourTester, 2),
+             (None, FunctionTester, 1)]
+    BOUND = 5.
+    N_VALS = 100
+
+    def _check(self, f, expected):
+        if f.deduplicated() != expected:
+            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} shares {f.deduplicated()} "
+                             f"operations, not {expected}")
+
+    def run(self, n_funcs):
+        super().run()
+        np.seterr(all="ignore")
+        for cls, tester, p in self.KINDS:
+            exp, sin, cos, identity = (cls.Exp(), cls.Sin(), cls.Cos(), cls.Identity()) if cls is not None else \
+                                      (libcalculus.exp, libcalculus.sin, libcalculus.cos, libcalculus.identity)
+            # f has 2 p + 1 operations, none repeated; as a tree, f f + f has 3 times as many and 2 more, and its square
+            # twice that and 1 more, of which only 2 and 3 more are evaluated. exp + exp repeats the p of exp.
+            f, repeated = exp * sin, exp + exp
+            self._check(identity, 0)
+            self._check(exp * sin * cos, 0)
+            self._check(f * f + f, 4 * p + 2)
+            self._check((f * f + f) * (f * f + f), 10 * p + 7)
+            self._check(repeated, p)
+            self._check(repeated * repeated + repeated, 5 * p + 2)
+
+            tester = tester()
+            tester.BOUND = self.BOUND
+            for _ in range(n_funcs):
+                f = tester._gen_function()[0]
+                x = tester._rand(self.N_VALS)
+                g, values = f * f + f, f(x)
+                # Where the values overflow, NumPy's complex arithmetic does not give the infinities and NaNs C++'s does.
+                expected = values * values + values
+                close = ~np.isfinite(expected) | np.isclose(g(x), expected, rtol=ArrayTester.RTOL, atol=ArrayTester.RTOL)
+                if g.deduplicated() < f.deduplicated() or not np.all(close):
+                    raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {g.latex()}, sharing "
+                                     f"{g.deduplicated()} operations: {g(x)} vs {expected}")
+        super()._done()
+
+class MemoryTester(Tester):
+    """memory_usage() of functions of every kind, which counts the parts a function shares once: a copy and a product
+    with a copy must hold no more than the original and the product with itself, a product less than its factors apart,
+    a composition as much more than what it composes with whatever that is, and repeatedly squaring a function, which
+    doubles its expression written out as a tree, must add about as much each time. Larger expressions must hold more."""
+    KINDS = [ComplexFunction, RealFunction, Contour, None]
+    N_SQUARINGS = 12
+
+    def _check(self, condition, description):
+        if not condition:
+            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {description}")
+
+    def run(self):
+        super().run()
+        for cls in self.KINDS:
+            exp, sin, cos, identity = (cls.Exp(), cls.Sin(), cls.Cos(), cls.Identity()) if cls is not None else \
+                                      (libcalculus.exp, libcalculus.sin, libcalculus.cos, libcalculus.identity)
+            f = exp * sin
+            copy = f.copy()
+            self._check(copy.memory_usage() == f.memory_usage(), f"a copy of {f.latex()} holds {copy.memory_usage()} "
+                                                                 f"bytes, vs {f.memory_usage()}")
+            self._check((f * copy).memory_usage() == (f * f).memory_usage(),
+                        f"{f.latex()} times a copy holds {(f * copy).memory_usage()} bytes, vs {(f * f).memory_usage()}")
+            self._check((f * f).memory_usage() < 2 * f.memory_usage(),
+                        f"{(f * f).latex()} holds {(f * f).memory_usage()} bytes, vs {f.memory_usage()} for each factor")
+            # Composing adds the same whatever is composed with, and the composition shares it with its factors.
+            outer = cos if cls is not Contour else ComplexFunction.Cos()
+            composed, overhead = outer @ f, (outer @ exp).memory_usage() - exp.memory_usage()
+            self._check(composed.memory_usage() - f.memory_usage() == overhead,
+                        f"{composed.latex()} holds {composed.memory_usage()} bytes, vs {f.memory_usage()} for "
+                        f"{f.latex()} and {overhead} more for composing")
+            self._check((composed * f).memory_usage() - composed.memory_usage() < f.memory_usage(),
+                        f"{(composed * f).latex()} holds {(composed * f).memory_usage()} bytes, vs "
+                        f"{composed.memory_usage()} and {f.memory_usage()} for its factors")
+            self._check(f.memory_usage() > exp.memory_usage() and (f * cos).memory_usage() > f.memory_usage(),
+                        f"{(f * cos).latex()} holds {(f * cos).memory_usage()} bytes, {f.latex()} {f.memory_usage()} "
+                        f"and {exp.latex()} {exp.memory_usage()}")
+            squares = [f]
+            for _ in range(self.N_SQUARINGS):
+                squares.append(squares[-1] * squares[-1] + identity)
+            growth = np.diff([square.memory_usage() for square in squares])
+            self._check(np.all(growth > 0) and np.all(growth <= 2 * growth[0]),
+                        f"squaring {f.latex()} {self.N_SQUARINGS} times adds {growth} bytes")
+        super()._done()
+
+class ProfileTester(Tester):
+    """profile_report() of functions of every kind evaluated at arrays of several sizes and at a scalar while profiling:
+    every instruction must count a call per block of the tape and per scalar, and every point, in the order the
+    expression is built; piecewise functions a single instruction; integrate() its integral and the evaluations it
+    reports. Nothing must be recorded while profiling is off, and profile_reset() must clear what was."""
+    BLOCK_SIZE = 256
+    SIZES = [1000, 10, 300]
+    OPS = ["exp", "sin", "mul", "mulc", "add"]
+
+    def _check(self, condition, description):
+        if not condition:
+            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {description}")
+
+    def _counts(self, nodes):
+        return [(node["calls"], node["points"]) for node in nodes]
+
+    def run(self):
+        super().run()
+        libcalculus.profile_reset()
+        libcalculus.profile(True)
+        try:
+            calls, points = sum(-(-n // self.BLOCK_SIZE) for n in self.SIZES) + 1, sum(self.SIZES) + 1
+            for cls, x in ((ComplexFunction, 1 + 1j), (RealFunction, 1.)):
+                product = cls.Exp() * cls.Sin()
+                f = product + product * 2.
+                for n in self.SIZES:
+                    f(np.linspace(-x, x, n))
+                f(x / 2)
+                nodes = libcalculus.profile_report(f)["nodes"]
+                self._check([node["op"] for node in nodes] == self.OPS and nodes[-1]["latex"] == f.latex(),
+                            f"{f.latex()} is run by {[(node['op'], node['latex']) for node in nodes]}")
+                self._check(all(count == (calls, points) for count in self._counts(nodes)),
+                            f"{f.latex()} at {self.SIZES} points and a scalar counted {self._counts(nodes)} calls and "
+                            f"points, vs {calls} and {points}")
+
+                libcalculus.profile(False)
+                f(np.linspace(-x, x, self.SIZES[0]))
+                self._check(self._counts(libcalculus.profile_report(f)["nodes"]) == self._counts(nodes),
+                            f"{f.latex()} counted {self._counts(libcalculus.profile_report(f)['nodes'])} with profiling "
+                            f"off, vs {self._counts(nodes)}")
+                libcalculus.profile_reset()
+                self._check(all(count == (0, 0) for count in self._counts(libcalculus.profile_report(f)["nodes"])),
+                            f"{f.latex()} counted {self._counts(libcalculus.profile_report(f)['nodes'])} once reset")
+                libcalculus.profile(True)
+
+            piecewise = RealFunction.If(RealFunction.Sin() > 0, RealFunction.Exp(), 2. * RealFunction.Cos())
+            piecewise(np.linspace(-3, 3, self.SIZES[0]))
+            nodes = libcalculus.profile_report(piecewise)["nodes"]
+            self._check(len(nodes) == 1 and nodes[0]["op"] == "if" and nodes[0]["points"] == self.SIZES[0],
+                        f"{piecewise.latex()} is run by {nodes}")
+
+            f = libcalculus.exp * libcalculus.sin
+            f(np.linspace(-1., 1., self.SIZES[0]))
+            nodes = libcalculus.profile_report(f)["nodes"]
+            self._check(sorted(nodes) == ["complex", "contour", "real"] and
+                        all(node["points"] == self.SIZES[0] for node in nodes["real"]) and
+                        all(node["points"] == 0 for node in nodes["complex"] + nodes["contour"]),
+                        f"{f.latex()} at {self.SIZES[0]} real points is run by {nodes}")
+
+            libcalculus.profile_reset()
+            _, _, evaluations = integrate(ComplexFunction.Exp(), libcalculus.sphere(), full_output=True)
+            integration = libcalculus.profile_report()["integration"]
+            self._check(integration["integrals"] == 1 and integration["evaluations"] == evaluations and
+                        integration["passes"] > 0, f"integrating e^z over the unit circle in {evaluations} evaluations "
+                                                   f"recorded {integration}")
+        finally:
+            libcalculus.profile(False)
+            libcalculus.profile_reset()
+        super()._done()
+
+class CompileTester(Tester):
+    """Functions of every kind compiled to native code, random ones and ones whose instructions the compiled code calls
+    back for: presets with kernels, branches, derivatives, paths and approximations. Arrays must evaluate to the same
+    values as interpreted, and points alone to within the ulps that scalar evaluation differs from array evaluation in.
+    Compiling again, or loading the compiled function, must find it in the cache, which is a temporary directory."""
+    TESTERS = [ComplexFunctionTester, RealFunctionTester, ContourTester, FunctionTester]
+    BOUND = 5.
+    N_VALS = 1000
+
+    def _functions(self, n_funcs):
+        """Yields the functions to compile, with points to evaluate them at."""
+        for tester in self.TESTERS:
+            tester = tester()
+            tester.BOUND = self.BOUND
+            for _ in range(n_funcs):
+                yield tester._gen_function()[0], tester._rand(self.N_VALS)
+        t = RealFunctionTester()._rand(self.N_VALS) / 4.
+        z = ComplexFunctionTester()._rand(self.N_VALS) / 4.
+        yield ComplexFunction.Exp() * ComplexFunction.Sin() + ComplexFunction.Arctan() - ComplexFunction.Identity(), z
+        yield RealFunction.If(RealFunction.Sin() > 0, RealFunction.Exp(), 2. * RealFunction.Cos()) + RealFunction.Identity(), t
+        yield ComplexFunction.If(ComplexFunction.Re() != 0, ComplexFunction.Exp()) * ComplexFunction.Identity(), z
+        yield libcalculus.derivative(ComplexFunction.Tan() * ComplexFunction.Exp(), 2) + ComplexFunction.Identity(), z
+        yield Contour.Polyline([0., 1j, 2. + 1j], closed=True) * Contour.Exp() + Contour.Identity(), t
+        yield RealFunction.Tanh().approximate(-5., 5.) * RealFunction.Identity(), t
+
+    def _check(self, f, g, x, description):
+        values, compiled = f(x), g(x)
+        scalars, compiled_scalars = np.array([f(v) for v in x[:10]]), np.array([g(v) for v in x[:10]])
+        if g.latex() != f.latex() or not np.array_equal(compiled, values, equal_nan=True) or \
+           not np.allclose(compiled_scalars, scalars, rtol=ArrayTester.RTOL, atol=ArrayTester.RTOL, equal_nan=True):
+            i = np.argmin(np.isclose(compiled, values, rtol=0., atol=0., equal_nan=True))
+            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} {description}\n\t at {x[i]}: "
+                             f"{compiled[i]} vs {values[i]} interpreted")
+
+    def run(self, n_funcs):
+        super().run()
+        np.seterr(all="ignore")
+        cache_dir = os.environ.get("LIBCALCULUS_CACHE_DIR")
+        try:
+            with tempfile.TemporaryDirectory() as directory:
+                os.environ["LIBCALCULUS_CACHE_DIR"] = directory
+                for f, x in self._functions(n_funcs):
+                    self._check(f, f.compile(), x, "compiled")
+                    cached = {name: os.stat(os.path.join(directory, name)).st_mtime_ns for name in os.listdir(directory)}
+                    self._check(f, f.compile(), x, "compiled again")
+                    self._check(f, pickle.loads(pickle.dumps(f.compile())), x, "compiled and loaded")
+                    if {name: os.stat(os.path.join(directory, name)).st_mtime_ns for name in os.listdir(directory)} != cached:
+                        raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} was compiled "
+                                         f"again rather than found in the cache")
+                if not any(name.endswith(".so") for name in os.listdir(directory)):
+                    raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m nothing was compiled into "
+                                     f"LIBCALCULUS_CACHE_DIR")
+        finally:
+            if cache_dir is None:
+                del os.environ["LIBCALCULUS_CACHE_DIR"]
+            else:
+                os.environ["LIBCALCULUS_CACHE_DIR"] = cache_dir
+        super()._done()
+
+class OutputTester(Tester):
+    """Evaluation of random functions of every kind into out and where where holds, on arrays and views of them and in
+    place, against np.where of the values and what out held; out of another dtype must be cast into under the
+    'same_kind' rule or refused, and a 0-d array without out must give a scalar."""
+    TESTERS = [ComplexFunctionTester, RealFunctionTester, ContourTester, FunctionTester]
+    BOUND = 5.
+    SHAPE = (6, 5)
+
+    def _check(self, f, x, expected, out, where, description):
+        previous = out.copy()
+        result = f(x, out=out, where=where)
+        if result is not out or not np.array_equal(out, np.where(where, expected.astype(out.dtype), previous), equal_nan=True):
+            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} {description}: {out} vs "
+                             f"{np.where(where, expected, previous)}")
+
+    def run(self, n_funcs):
+        super().run()
+        np.seterr(all="ignore")
+        for i in range(n_funcs):
+            tester = self.TESTERS[i % len(self.TESTERS)]()
+            tester.BOUND = self.BOUND
+            f = tester._gen_function()[0]
+            x = tester._rand(np.prod(self.SHAPE)).reshape(self.SHAPE)
+            values = f(x)
+            where = np.random.rand(*self.SHAPE) < .5
+            out = np.random.rand(*self.SHAPE).astype(values.dtype)
+            self._check(f, x, values, out, where, "into out")
+            # Views are read and written with their strides, and where and x are broadcast to out.
+            self._check(f, x.T[::-2], values.T[::-2], out.T[::2], where.T[::2], "between strided views")
+            self._check(f, x[0], np.broadcast_to(values[0], self.SHAPE), out, where[:, :1], "broadcast")
+            self._check(f, x, values, out, True, "everywhere")
+            if values.dtype == x.dtype:
+                in_place = x.copy()
+                self._check(f, in_place, values, in_place, where, "in place")
+            # Values are cast into out of another dtype of the same kind, and of a kind they can be cast to.
+            for dtype in (np.complex64, np.complex128, np.float32, np.float64):
+                out = np.random.rand(*self.SHAPE).astype(dtype)
+                if np.can_cast(values.dtype, dtype, casting="same_kind"):
+                    self._check(f, x, values, out, where, f"into out of dtype {np.dtype(dtype)}")
+                    continue
+                try:
+                    f(x, out=out, where=where)
+                except TypeError:
+                    continue
+                raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} cast values of dtype "
+                                 f"{values.dtype} into out of dtype {np.dtype(dtype)}")
+            scalar = f(x[0, 0].reshape(()))
+            if isinstance(scalar, np.ndarray) or \
+               not np.isclose(scalar, values[0, 0], rtol=ArrayTester.RTOL, atol=ArrayTester.RTOL, equal_nan=True):
+                raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} at a 0-d array: "
+                                 f"{scalar!r} vs {values[0, 0]}")
+        super()._done()
+
+class GridTester(Tester):
+    """evaluate_grid() of random complex functions over random grids, on one thread and on several, against evaluation
+    on the points of np.meshgrid: the values must be the same, their moduli and arguments the same to the ulps the
+    kernels differ from NumPy's in, and the moduli over blocks the largest in each block."""
+    THREADS = [1, 3]
+    BOUND = 5.
+    MAX_SIZE = 300
+    RTOL = 1e-15
+
+    def run(self, n_funcs):
+        super().run()
+        np.seterr(all="ignore")
+        tester = ComplexFunctionTester()
+        tester.BOUND = self.BOUND
+        try:
+            for i in range(n_funcs):
+                f = tester._gen_function()[0] if i % 2 else FunctionTester()._gen_function()[0]
+                nx, ny = np.random.randint(1, self.MAX_SIZE, size=2)
+                re_range, im_range = np.random.uniform(-self.BOUND, self.BOUND, size=(2, 2))
+                X, Y = np.meshgrid(np.linspace(*re_range, nx), np.linspace(*im_range, ny))
+                values = f(X + 1j * Y)
+                for n_threads in self.THREADS:
+                    libcalculus.threads(n_threads)
+                    grid = f.evaluate_grid(re_range, im_range, nx, ny)
+                    moduli = f.evaluate_grid(re_range, im_range, nx, ny, output="abs")
+                    arguments = f.evaluate_grid(re_range, im_range, nx, ny, output="arg")
+                    if not np.array_equal(grid, values, equal_nan=True) or \
+                       not np.allclose(moduli, np.abs(values), rtol=self.RTOL, atol=0., equal_nan=True) or \
+                       not np.allclose(arguments, np.angle(values), rtol=self.RTOL, atol=self.RTOL, equal_nan=True):
+                        raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} over "
+                                         f"{re_range} x {im_range} in {nx} x {ny} points on {n_threads} threads")
+                    # The blocks at the edges are partial; NaNs are skipped unless a block has nothing else.
+                    d = np.random.randint(2, 9)
+                    padded = np.full((-(-ny // d) * d, -(-nx // d) * d), np.nan)
+                    padded[:ny, :nx] = moduli
+                    maxima = np.fmax.reduce(np.fmax.reduce(padded.reshape(padded.shape[0] // d, d, -1, d), axis=3), axis=1)
+                    downsampled = f.evaluate_grid(re_range, im_range, nx, ny, output="abs", downsample=d)
+                    if not np.array_equal(downsampled, maxima, equal_nan=True):
+                        raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} over "
+                                         f"{re_range} x {im_range} in {nx} x {ny} points downsampled by {d} on "
+                                         f"{n_threads} threads")
+        finally:
+            libcalculus.threads(1)
+        super()._done()
+
+class StreamTester(Tester):
+    """stream() of random functions of every kind through arrays, memory-mapped arrays and .npy files, in chunks that
+    divide the points evenly and that do not, against calling the function on the whole array."""
+    TESTERS = [ComplexFunctionTester, RealFunctionTester, ContourTester, FunctionTester]
+    MAX_SIZE = 5000
+
+    def run(self, n_funcs):
+        super().run()
+        np.seterr(all="ignore")
+        with tempfile.TemporaryDirectory() as directory:
+            input_path, output_path = os.path.join(directory, "input.npy"), os.path.join(directory, "output.npy")
+            for i in range(n_funcs):
+                tester = self.TESTERS[i % len(self.TESTERS)]()
+                f = tester._gen_function()[0]
+                n = np.random.randint(0, self.MAX_SIZE)
+                x = tester._rand(n) if n > 1 else np.array([tester._rand()] * n)
+                if i % 3 == 0: # Higher dimensions, and single precision, go through as they are.
+                    x = x[:n // 2 * 2].reshape(-1, 2)
+                elif i % 3 == 1:
+                    x = x.astype(np.complex64 if np.iscomplexobj(x) else np.float32)
+                expected = f(x)
+                np.save(input_path, x)
+                chunk_size = np.random.choice([1, 7, 1000, max(x.size, 1)])
+                for input, output in ((x, None), (np.load(input_path, mmap_mode="r"), np.empty_like(expected)),
+                                      (input_path, output_path)):
+                    result = libcalculus.stream(f, input, output, chunk_size=chunk_size)
+                    if isinstance(output, str):
+                        result = np.load(output_path)
+                    if result.dtype != expected.dtype or not np.array_equal(result, expected, equal_nan=True):
+                        raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} streamed from "
+                                         f"{type(input).__name__} to {type(output).__name__} in chunks of {chunk_size}: "
+                                         f"{result} vs {expected} directly")
+                    del result
+        for chunk_size, output in ((0, None), (1, np.empty(3, dtype=complex))):
+            try:
+                libcalculus.stream(libcalculus.exp, np.zeros(2, dtype=complex), output, chunk_size=chunk_size)
+            except ValueError:
+                continue
+            raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m stream() took chunks of {chunk_size} "
+                             f"into {output}")
+        super()._done()
+
+class PrecisionTester(Tester):
+    """Evaluation of random functions of every kind on arrays of single and extended precision, which must come back in
+    the precision they went in and agree with evaluation in double precision at the same points to the precision of
+    their type, where they are within its range. As in ArrayTester, only disagreement on many functions is an error,
+    since a composition may be ill-conditioned enough to amplify the rounding of single precision past any tolerance."""
+    TESTERS = [ComplexFunctionTester, RealFunctionTester, ContourTester, FunctionTester]
+    # The dtypes evaluated in, by the dtype of the values in double precision, and the tolerance they are checked to.
+    PRECISIONS = [({np.dtype(np.float64): np.dtype(np.float32), np.dtype(np.complex128): np.dtype(np.complex64)}, 1e-3),
+                  ({np.dtype(np.float64): np.dtype(np.longdouble), np.dtype(np.complex128): np.dtype(np.clongdouble)}, 1e-9)]
+    BOUND = 5.
+    MAX_OPS = 3
+    MAX_ERRORS = 10
+
+    def _run_precision(self, tester, n_vals):
+        """Returns a description of the first disagreement of a random function on MAX_ERRORS points or more, if any."""
+        np.seterr(all="ignore")
+        f, _ = tester._gen_function(np.random.randint(0, self.MAX_OPS))
+        # The points are rounded to single precision, so that every precision evaluates the function at the same ones.
+        x = tester._rand(n_vals)
+        x = x.astype(np.complex64 if np.iscomplexobj(x) else np.float32).astype(x.dtype)
+        reference = f(x)
+        for dtypes, rtol in self.PRECISIONS:
+            values = f(x.astype(dtypes[x.dtype]))
+            if values.dtype != dtypes[reference.dtype]:
+                raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} on {dtypes[x.dtype]}: "
+                                 f"values of dtype {values.dtype}, not {dtypes[reference.dtype]}")
+            close = np.isclose(values.astype(reference.dtype), reference, rtol=rtol, atol=rtol, equal_nan=True) | \
+                    ~np.isfinite(reference) | (np.abs(reference) > np.finfo(values.dtype).max)
+            if np.count_nonzero(~close) >= self.MAX_ERRORS:
+                i = np.argmin(close)
+                return f"{f.latex()}\n\t at {x[i]} in {values.dtype}: {values[i]} vs {reference[i]} in double precision"
+
+    def run(self, n_funcs, n_vals):
+        """Generate n_funcs random functions of each kind and check them on arrays of n_vals values."""
+        super().run()
+        for tester in self.TESTERS:
+            tester = tester()
+            tester.BOUND = self.BOUND
+            errors = [error for error in (self._run_precision(tester, n_vals) for _ in range(n_funcs)) if error is not None]
+            if len(errors) >= self.MAX_ERRORS:
+                raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {len(errors)} of {n_funcs} functions "
+                                 f"disagree, such as {errors[0]}")
+        super()._done()
+
+class SerialTester(Tester):
+    """Functions and comparisons of every kind through to_bytes() and loads(), pickle and a file, which must give them
+    back as they were; and their data truncated and with bits flipped, which loads() must either reject with a
+    ValueError or load into something that evaluates."""
+    N_FLIPS = 1000
+    N_VALS = 16
+
+    def _functions(self, n_funcs):
+        """Yields random functions, and ones with every kind of record, with points to evaluate them at."""
+        real, contour, complex_ = RealFunctionTester(), ContourTester(), ComplexFunctionTester()
+        for tester in (real, contour, complex_):
+            for _ in range(n_funcs):
+                yield tester._gen_function()[0], tester._rand(self.N_VALS)
+        t, z = real._rand(self.N_VALS), complex_._rand(self.N_VALS)
+        yield RealFunction.If((RealFunction.Sin() > 0) & ~(RealFunction.Identity() == 1.), RealFunction.Exp(), RealFunction.Cos()), t
+        yield ComplexFunction.If(ComplexFunction.Sin() != 0, ComplexFunction.Exp()), z
+        yield Contour.Polyline([0., 1j, 2. + 1j], closed=True) * Contour.Arc(1j, 2., 0., 1.), t
+        yield RealFunction.Tanh().approximate(-5., 5.), t
+        yield libcalculus.derivative(ComplexFunction.Tan() * ComplexFunction.Exp(), 2), z
+
+    def _same(self, f, g, x):
+        return f.latex() == g.latex() and np.array_equal(f(x), g(x), equal_nan=True)
+
+    def run(self, n_funcs):
+        super().run()
+        np.seterr(all="ignore")
+        for f, x in self._functions(n_funcs):
+            data = f.to_bytes()
+            path = "serial_test.bin"
+            with open(path, "wb") as wfd:
+                wfd.write(data)
+            try:
+                loaded = [libcalculus.loads(data), libcalculus.loads(bytearray(data)), pickle.loads(pickle.dumps(f)),
+                          libcalculus.load(path)]
+            finally:
+                os.remove(path)
+            for g in loaded:
+                if type(g) is not type(f) or not self._same(f, g, x):
+                    raise ValueError(f"\033[1;41mERROR IN {type(self).__name__}:\033[0m {f.latex()} came back as "
+                                     f"{g.latex()}: {g(x)} vs {f(x)}")
+            corrupted = [data[:k] for k in range(len(data))]
+            for _ in range(self.N_FLIPS):
+                flipped = bytearray(data)
+                flipped[np.random.randint(len(data))] ^= 1 << np.random.randint(8)
+                corrupted.append(bytes(flipped))
+            for c in corrupted:
+                try:
+                    g = libcalculus.loads(c)
+                except ValueError:
+                    continue
+                g(x), g(x[0])
+        super()._done()
+
 class IntegralTester(FunctionTester):
     MAX_OPS = 1
     BOUND = 1.
     TOL = 1e-3
+    QUAD_LIMIT = 1000 # Contours may wind around many times between the bounds.
 
     def __init__(self):
         self.cft = ComplexFunctionTester()
@@ -274,14 +1158,14 @@ class IntegralTester(FunctionTester):
     def _scipy_integrate(self, integrand, start, end, tol=1e-3):
         integrand_real = lambda t: np.real(integrand(t))
         integrand_imag = lambda t: np.imag(integrand(t))
-        return scipy.integrate.quad(integrand_real, start, end, epsabs=tol)[0] + \
-               1j * scipy.integrate.quad(integrand_imag, start, end, epsabs=tol)[0]
+        return scipy.integrate.quad(integrand_real, start, end, epsabs=tol, limit=self.QUAD_LIMIT)[0] + \
+               1j * scipy.integrate.quad(integrand_imag, start, end, epsabs=tol, limit=self.QUAD_LIMIT)[0]
 
     def _random_contour(self):
         radius = abs(self.ct._rand())
         center = self.cft._rand()
         c = Contour.Sphere(radius=radius, center=center)
-        cc = lambda t: center + radius * np.exp(1j * t)
+        cc = lambda t: center + radius * np.exp(2j * np.pi * t)
         return c, cc
 
     def _run_integral(self, n_integrals):
@@ -291,7 +1175,7 @@ class IntegralTester(FunctionTester):
                 warnings.simplefilter("always")
                 c, cc = self._random_contour()
                 start, end = self.ct._rand(2)
-                dcc = lambda t: scipy.misc.derivative(cc, t, dx=self.TOL)
+                dcc = lambda t: (cc(t + self.TOL) - cc(t - self.TOL)) / (2. * self.TOL)
 
                 integral = integrate(f, c, start, end, tol=self.TOL)
                 cintegral = self._scipy_integrate(lambda t: cf(cc(t)) * dcc(t), start, end, tol=self.TOL)
@@ -304,7 +1188,7 @@ class IntegralTester(FunctionTester):
     def run(self, n_funcs, n_integrals):
         """Generate n_funcs random functions and check n_integrals random integrals on each function."""
         print(f"\033[1mStarting {type(self).__name__}:\033[0m")
-        pqdm.processes.pqdm([[n_integrals]] * n_funcs, self._run_integral, n_jobs=self.N_JOBS, argument_type="args", exception_behaviour="immediate", bounded=True)
+        _parallel(self._run_integral, [[n_integrals]] * n_funcs, self.N_JOBS)
         super()._done()
 
 class LatexTester(Tester):
@@ -337,6 +1221,23 @@ if __name__ == "__main__":
     parser.add_argument("--ComplexFunction", action="store_true")
     parser.add_argument("--RealFunction", action="store_true")
     parser.add_argument("--Contour", action="store_true")
+    parser.add_argument("--Kernel", action="store_true")
+    parser.add_argument("--Array", action="store_true")
+    parser.add_argument("--Rewrite", action="store_true")
+    parser.add_argument("--Derivative", action="store_true")
+    parser.add_argument("--Coefficient", action="store_true")
+    parser.add_argument("--Quadrature", action="store_true")
+    parser.add_argument("--Root", action="store_true")
+    parser.add_argument("--Comparison", action="store_true")
+    parser.add_argument("--Deduplication", action="store_true")
+    parser.add_argument("--Memory", action="store_true")
+    parser.add_argument("--Profile", action="store_true")
+    parser.add_argument("--Compile", action="store_true")
+    parser.add_argument("--Output", action="store_true")
+    parser.add_argument("--Grid", action="store_true")
+    parser.add_argument("--Stream", action="store_true")
+    parser.add_argument("--Precision", action="store_true")
+    parser.add_argument("--Serial", action="store_true")
     parser.add_argument("--Integral", action="store_true")
     parser.add_argument("--Latex", action="store_true")
     args = parser.parse_args()
@@ -357,6 +1258,74 @@ if __name__ == "__main__":
         tester = ContourTester()
         tester.run(500, 10)
 
+    if args.Kernel or args.all:
+        tester = KernelTester()
+        tester.run()
+
+    if args.Array or args.all:
+        tester = ArrayTester()
+        tester.run(100, 200)
+
+    if args.Rewrite or args.all:
+        tester = RewriteTester()
+        tester.run()
+
+    if args.Derivative or args.all:
+        tester = DerivativeTester()
+        tester.run(50)
+
+    if args.Coefficient or args.all:
+        tester = CoefficientTester()
+        tester.run()
+
+    if args.Quadrature or args.all:
+        tester = QuadratureTester()
+        tester.run()
+
+    if args.Root or args.all:
+        tester = RootTester()
+        tester.run(20)
+
+    if args.Comparison or args.all:
+        tester = ComparisonTester()
+        tester.run(100)
+
+    if args.Deduplication or args.all:
+        tester = DeduplicationTester()
+        tester.run(50)
+
+    if args.Memory or args.all:
+        tester = MemoryTester()
+        tester.run()
+
+    if args.Profile or args.all:
+        tester = ProfileTester()
+        tester.run()
+
+    if args.Compile or args.all:
+        tester = CompileTester()
+        tester.run(3)
+
+    if args.Output or args.all:
+        tester = OutputTester()
+        tester.run(100)
+
+    if args.Grid or args.all:
+        tester = GridTester()
+        tester.run(50)
+
+    if args.Stream or args.all:
+        tester = StreamTester()
+        tester.run(40)
+
+    if args.Precision or args.all:
+        tester = PrecisionTester()
+        tester.run(200, 1000)
+
+    if args.Serial or args.all:
+        tester = SerialTester()
+        tester.run(20)
+
     if args.Integral or args.all:
         tester = IntegralTester()
         tester.run(2, 2)